@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <fmt/format.h>
+#include <jobs/job_system.hpp>
+#include <math/trs_kernel.hpp>
+#include <scene/bvh.hpp>
+#include <scene/hashed_grid.hpp>
+#include <scene/object_store.hpp>
+#include <string_view>
+#include <vector>
+
+using engine::math::SimdLevel, engine::math::RotationMode, engine::math::TrsBenchmark;
+using std::string_view, std::vector;
+
+/// Runs the engine's benchmarks without a window, as the runtime's information window does.
+///
+/// Usage: `bench [--quick] [transform] [spatial] [store]`. Every benchmark runs if none is named, and `--quick` runs
+/// them on a sixteenth of the items. Exits with 1 if the transform kernel strays from the scalar transforms by more
+/// than `TRS_EPSILON`, and with 2 on invalid arguments.
+
+/// Number of transforms composed by the transform kernel benchmark
+static constexpr size_t TRS_BENCHMARK_COUNT = 1 << 20;
+/// Item counts indexed by the spatial index benchmark
+static constexpr size_t SPATIAL_BENCHMARK_COUNTS[] = {10'000, 100'000, 1'000'000};
+/// Objects drawn by the object store benchmark
+static constexpr size_t STORE_BENCHMARK_COUNT = 1'000'000;
+/// Divides the item counts of `--quick` runs
+static constexpr size_t QUICK_DIVISOR = 16;
+
+/// Returns `false` if a level exceeds the kernel's epsilon
+static bool transform_kernel(size_t divisor)
+{
+    bool within = true;
+
+    fmt::print("Transform kernel: {}\n", engine::math::to_string(engine::math::detect_simd_level()));
+
+    for (RotationMode mode : {RotationMode::Euler, RotationMode::Quaternion})
+        for (int level = 0; level <= (int)engine::math::detect_simd_level(); ++level) {
+            TrsBenchmark result =
+                engine::math::benchmark_compose_transforms(TRS_BENCHMARK_COUNT / divisor, SimdLevel(level), mode);
+
+            double speedup = result.baseline_per_second > 0.0
+                               ? result.matrices_per_second / result.baseline_per_second
+                               : 0.0;
+
+            fmt::print("    {:<10} {:<8} {:7.1f} M/s ({:.2f}x), error {:.2e}{}\n", engine::math::to_string(result.mode),
+                       engine::math::to_string(result.level), result.matrices_per_second / 1e6, speedup,
+                       result.max_error, result.within_epsilon ? "" : " (exceeds epsilon)");
+
+            within = within && result.within_epsilon;
+        }
+
+    return within;
+}
+
+static void spatial_index(size_t divisor, engine::JobSystem &jobs)
+{
+    fmt::print("Spatial index\n");
+
+    for (size_t count : SPATIAL_BENCHMARK_COUNTS) {
+        engine::Bvh        bvh;
+        engine::HashedGrid grid;
+
+        for (const engine::SpatialBenchmark &result : {engine::benchmark_spatial_index(bvh, count / divisor, jobs),
+                                                       engine::benchmark_spatial_index(grid, count / divisor, jobs)}) {
+            fmt::print("    {:<12} {:8} items: build {:.1f} ms, update {:.2f} ms\n", result.index, result.count,
+                       result.build_ms, result.update_ms);
+            fmt::print("        frustum {:.1f} us ({} hits), box {:.1f} us, ray {:.1f} us, nearest {:.1f} us\n",
+                       result.frustum_us, result.frustum_hits, result.aabb_us, result.raycast_us, result.nearest_us);
+        }
+    }
+}
+
+static void object_store(size_t divisor)
+{
+    engine::ObjectStoreBenchmark result = engine::benchmark_object_store(STORE_BENCHMARK_COUNT / divisor);
+
+    fmt::print("Object storage: {} objects\n", result.count);
+    fmt::print("    shared_ptr {:.2f} ms, copying pointers {:.2f} ms\n", result.pointer_ms, result.copy_ms);
+    fmt::print("    store {:.2f} ms ({:.2f}x), by index {:.2f} ms\n", result.store_ms,
+               result.store_ms > 0.0 ? result.pointer_ms / result.store_ms : 0.0, result.store_set_ms);
+}
+
+int main(int argc, char **argv)
+{
+    constexpr string_view BENCHMARKS[] = {"transform", "spatial", "store"};
+
+    size_t              divisor  = 1;
+    vector<string_view> selected = {};
+
+    for (int i = 1; i < argc; ++i) {
+        string_view arg = argv[i];
+
+        if (arg == "--quick")
+            divisor = QUICK_DIVISOR;
+        else if (std::find(std::begin(BENCHMARKS), std::end(BENCHMARKS), arg) != std::end(BENCHMARKS))
+            selected.push_back(arg);
+        else {
+            fmt::print(stderr, "Unknown benchmark \"{}\"\nUsage: {} [--quick] [transform] [spatial] [store]\n", arg,
+                       argv[0]);
+            return 2;
+        }
+    }
+
+    if (selected.empty())
+        selected.assign(std::begin(BENCHMARKS), std::end(BENCHMARKS));
+
+    auto jobs   = engine::JobSystem::new_shared();
+    bool within = true;
+
+    for (string_view benchmark : selected) {
+        if (benchmark == "transform")
+            within = transform_kernel(divisor) && within;
+        else if (benchmark == "spatial")
+            spatial_index(divisor, *jobs);
+        else if (benchmark == "store")
+            object_store(divisor);
+    }
+
+    return within ? 0 : 1;
+}
@@ -15,4 +15,20 @@ ${FRAG_SHADER}
 
 constexpr size_t fragment_shader_len = sizeof(fragment_shader_data) / sizeof(uint32_t);
 
-constexpr std::span<const uint32_t, fragment_shader_len> fragment_shader(fragment_shader_data);
\ No newline at end of file
+constexpr std::span<const uint32_t, fragment_shader_len> fragment_shader(fragment_shader_data);
+
+constexpr uint32_t hiz_downsample_shader_data[] = {
+${HIZ_DOWNSAMPLE_SHADER}
+};
+
+constexpr size_t hiz_downsample_shader_len = sizeof(hiz_downsample_shader_data) / sizeof(uint32_t);
+
+constexpr std::span<const uint32_t, hiz_downsample_shader_len> hiz_downsample_shader(hiz_downsample_shader_data);
+
+constexpr uint32_t hiz_cull_shader_data[] = {
+${HIZ_CULL_SHADER}
+};
+
+constexpr size_t hiz_cull_shader_len = sizeof(hiz_cull_shader_data) / sizeof(uint32_t);
+
+constexpr std::span<const uint32_t, hiz_cull_shader_len> hiz_cull_shader(hiz_cull_shader_data);
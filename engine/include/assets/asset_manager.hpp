@@ -0,0 +1,189 @@
+#pragma once
+#include "assets/mesh_lod.hpp"
+#include "backend/allocation.hpp"
+#include "jobs/job_system.hpp"
+#include "scene/bounds.hpp"
+#include "vertex.hpp"
+#include <atomic>
+#include <functional>
+#include <glm/glm.hpp>
+#include <list>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace engine
+{
+    /// Lifecycle of an asset request.
+    enum class AssetState : uint8_t
+    {
+        /// Waiting to be picked up by a worker
+        Queued,
+        /// Being read and decoded by a worker
+        Loading,
+        /// Decoded and waiting for a GPU upload slot
+        Decoded,
+        /// Part of an upload batch which has not yet completed
+        Uploading,
+        /// On the GPU and ready to draw
+        Resident,
+        /// Cancelled before becoming resident
+        Cancelled,
+        /// Failed to load; the error is logged
+        Failed,
+    };
+
+    /// CPU-side mesh data produced by decoding an asset.
+    struct MeshData
+    {
+        std::vector<primitives::GouraudVertex> vertices = {};
+        std::vector<uint32_t>                  indices  = {};
+        /// Index ranges of each level of detail, finest first. Generated at load time if empty.
+        std::vector<MeshLod>                   lods     = {};
+        /// Bounds of the vertices; computed at load time
+        Aabb                                   bounds   = {};
+    };
+
+    /// Produces mesh data on a worker thread.
+    using MeshLoader = std::function<MeshData()>;
+
+    namespace detail
+    {
+        struct MeshRequest
+        {
+            std::string                        source   = {};
+            MeshLoader                         loader   = {};
+            std::atomic<AssetState>            state    = AssetState::Queued;
+            std::atomic<float>                 priority = 0.0;
+            std::atomic<bool>                  cancel   = false;
+            /// Size of the vertices and indices, once decoded
+            std::atomic<size_t>                bytes    = 0;
+            MeshData                           data     = {};
+            std::shared_ptr<class GouraudMesh> mesh     = {};
+        };
+    } // namespace detail
+
+    /// Handle to a mesh loaded by the asset manager.
+    ///
+    /// Resolves to the mesh once it is resident on the GPU. Copies of a handle refer to the same request.
+    class MeshHandle
+    {
+        friend class AssetManager;
+
+      public:
+        MeshHandle() = default;
+
+        AssetState state() const;
+        bool       resident() const;
+        /// Size of the mesh's vertices and indices, or zero until it is decoded
+        size_t     bytes() const;
+
+        /// Get the mesh, or `nullptr` if it is not yet resident.
+        std::shared_ptr<class GouraudMesh> get() const;
+
+        /// Change the priority of the request. Higher values are loaded and uploaded first.
+        ///
+        /// Has no effect once the mesh is being uploaded.
+        void set_priority(float priority);
+        /// Cancel the request. A mesh which is already resident is kept.
+        void cancel();
+
+        inline explicit operator bool() const { return resident(); }
+
+      private:
+        MeshHandle(std::shared_ptr<detail::MeshRequest> request);
+
+        std::shared_ptr<detail::MeshRequest> m_request = {};
+    };
+
+    /// Loads assets asynchronously.
+    ///
+    /// File I/O and decoding run on the job system; GPU uploads are batched into a single submission per call to
+    /// `update`, which must be made once per frame from the thread owning the backend.
+    class AssetManager final
+    {
+      public:
+        /// Name of procedural meshes which are never shared
+        static constexpr std::string_view UNNAMED_MESH = "<procedural>";
+
+        AssetManager(class VulkanBackend &backend, JobSystem::Shared job_system);
+        ~AssetManager();
+
+        /// Queue a Wavefront OBJ file for loading.
+        ///
+        /// If the file is already loading or resident, its request is shared, and its priority raised to `priority`.
+        MeshHandle load_mesh(std::string_view path, float priority = 0.0);
+        /// Queue a mesh produced by `loader` for loading.
+        ///
+        /// Unless `name` is `UNNAMED_MESH`, the request is shared like that of a file: later calls with the same name
+        /// reuse it and ignore their loader, raising its priority to `priority`.
+        MeshHandle load_mesh(MeshLoader loader, float priority = 0.0, std::string_view name = UNNAMED_MESH);
+
+        /// Dispatch queued requests, start this frame's upload batch and retire finished uploads.
+        void update();
+
+        /// Number of requests which are not yet resident, failed or cancelled
+        size_t pending() const noexcept;
+
+        /// Priority for an asset `distance` units from the camera; closer assets load first.
+        static float distance_priority(float distance);
+        static float distance_priority(const glm::vec3 &camera, const glm::vec3 &location);
+
+        /// Maximum number of requests being decoded at any time
+        uint32_t       max_concurrent_loads = 4;
+        /// Maximum number of bytes uploaded per frame. A single larger mesh is still uploaded alone.
+        vk::DeviceSize upload_budget        = 4 * 1024 * 1024;
+        /// Most levels of detail generated for meshes which do not provide their own, including the full detail one
+        uint32_t       max_lods             = 4;
+
+        AssetManager(const AssetManager &)            = delete;
+        AssetManager(AssetManager &&)                 = delete;
+        AssetManager &operator=(const AssetManager &) = delete;
+        AssetManager &operator=(AssetManager &&)      = delete;
+
+      private:
+        using Request = std::shared_ptr<detail::MeshRequest>;
+
+        struct PendingUpload
+        {
+            Request              request;
+            BufferAllocation     allocation;
+            vk::DeviceSize       vertex_bytes;
+            std::vector<MeshLod> lods;
+            Aabb                 bounds;
+        };
+
+        struct UploadBatch
+        {
+            vk::CommandBuffer           cmd;
+            /// Timeline value signalled once the batch's copies have finished
+            uint64_t                    value;
+            HostVisibleBufferAllocation staging;
+            std::vector<PendingUpload>  uploads;
+        };
+
+        MeshHandle enqueue(Request request);
+        /// The request of `shared`, with its priority raised to `priority`, if it is still loading or resident
+        static Request reuse(const std::weak_ptr<detail::MeshRequest> &shared, float priority);
+        void       dispatch_loads();
+        void       submit_uploads();
+        void       retire_uploads(bool wait);
+
+        static MeshData decode_obj(const std::string &path);
+
+        std::shared_ptr<spdlog::logger>                                     m_logger     = {};
+        class VulkanBackend                                                *m_backend    = {};
+        JobSystem::Shared                                                   m_job_system = {};
+        std::vector<Request>                                                m_requests   = {};
+        /// Requests of files, shared while anyone holds a handle to them
+        std::unordered_map<std::string, std::weak_ptr<detail::MeshRequest>> m_files      = {};
+        /// Requests of named procedural meshes, shared in the same way
+        std::unordered_map<std::string, std::weak_ptr<detail::MeshRequest>> m_procedural = {};
+        std::list<UploadBatch>                                              m_batches    = {};
+        std::atomic<uint32_t>                                               m_loading    = 0;
+    };
+} // namespace engine
@@ -0,0 +1,43 @@
+#pragma once
+#include "vertex.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace engine
+{
+    /// Range of a mesh's index buffer drawing one level of detail
+    struct MeshLod
+    {
+        uint32_t first = 0;
+        uint32_t count = 0;
+        /// Largest distance of the simplified surface from the full detail one, relative to the mesh's bounding radius
+        float    error = 0.0f;
+    };
+
+    /// Simplify a triangle list by quadric edge collapse, keeping the vertices in place.
+    ///
+    /// Vertices are only merged into vertices already in the mesh, so the result indexes the same vertex buffer.
+    /// Vertices sharing a position are treated as one, and each merged corner keeps the vertex of the target position
+    /// with the closest color. Collapses stop once `target_index_count` is reached, or when the next collapse would
+    /// move the surface further than `max_error`. `error` receives the largest distance the surface was moved.
+    std::vector<uint32_t> simplify_mesh(std::span<const primitives::GouraudVertex> vertices,
+                                        std::span<const uint32_t> indices, size_t target_index_count, float max_error,
+                                        float &error);
+
+    /// Append coarser levels of detail to `indices`, which initially holds the full detail mesh.
+    ///
+    /// Each level targets half the triangles of the previous one; levels are generated until `max_lods` are made or a
+    /// level would no longer be meaningfully smaller, and never move the surface further than `max_error` times the
+    /// mesh's bounding radius. Returns every level, including the full detail one.
+    std::vector<MeshLod> generate_lods(std::span<const primitives::GouraudVertex> vertices,
+                                       std::vector<uint32_t> &indices, uint32_t max_lods, float max_error = 0.25f);
+
+    /// Pick the level of detail to draw for a mesh whose bounding sphere covers a radius of `radius_pixels` on screen.
+    ///
+    /// Picks the coarsest level whose error projects to at most `tolerance_pixels`. To avoid popping when the size
+    /// hovers around a threshold, moving to a coarser level than `current` requires the error to be within the
+    /// tolerance scaled down by `1 + hysteresis`.
+    uint32_t select_lod(std::span<const MeshLod> lods, float radius_pixels, uint32_t current, float tolerance_pixels,
+                        float hysteresis);
+} // namespace engine
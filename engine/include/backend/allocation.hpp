@@ -154,21 +154,16 @@ namespace engine
             other.p_mapping = nullptr;
         }
 
+        /// Swaps with `other`, which then releases the buffer previously held by this allocation
         inline HostVisibleBufferAllocation &operator=(HostVisibleBufferAllocation &&other) noexcept
         {
-            allocator  = other.allocator;
-            allocation = other.allocation;
-            buffer     = other.buffer;
-            size       = other.size;
-            coherent   = other.coherent;
-            p_mapping  = other.p_mapping;
-
-            other.allocator  = nullptr;
-            other.allocation = nullptr;
-            other.buffer     = nullptr;
-            other.size       = 0;
-            other.coherent   = false;
-            other.p_mapping  = nullptr;
+            std::swap(allocator, other.allocator);
+            std::swap(allocation, other.allocation);
+            std::swap(buffer, other.buffer);
+            std::swap(size, other.size);
+            std::swap(coherent, other.coherent);
+            std::swap(random_access, other.random_access);
+            std::swap(p_mapping, other.p_mapping);
 
             return *this;
         }
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace engine
+{
+    /// Destroys objects once the GPU has finished every submission which may still use them.
+    ///
+    /// Submissions are identified by the value they signal on the device's `Timeline`, and since values are reached in
+    /// order, a submission is known to have finished once one submitted after it has.
+    class DeletionQueue final
+    {
+      public:
+        /// Value standing for the next submission given to `stamp`, whose value is not known yet
+        static constexpr uint64_t NEXT = UINT64_MAX;
+
+        /// Run `destroy` once the submission signalling `value`, and so every submission before it, has finished
+        void push(uint64_t value, std::function<void()> destroy);
+        /// Give the destructions waiting on `NEXT` the value of a submission which has just been made
+        void stamp(uint64_t value);
+        /// Run the destructions waiting on values up to `finished`
+        void collect(uint64_t finished);
+        /// Run every destruction. The device must be idle.
+        void flush();
+
+        size_t size() const noexcept;
+
+        DeletionQueue();
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue &)            = delete;
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+      private:
+        struct Entry
+        {
+            uint64_t              value   = 0;
+            std::function<void()> destroy = {};
+        };
+
+        /// In the order pushed, which is also the order of their values
+        std::deque<Entry> m_entries = {};
+    };
+} // namespace engine
@@ -1,4 +1,5 @@
 #pragma once
+#include "timeline.hpp"
 #include <memory>
 #include <span>
 #include <spdlog/spdlog.h>
@@ -58,6 +59,8 @@ namespace engine
         Queue                                        graphics_queue   = {};
         Queue                                        present_queue    = {};
         vk::CommandPool                              command_pool     = {};
+        /// Signalled by every submission to the graphics queue
+        Timeline                                     timeline         = {};
 
         SingleTimeCommandBuffer single_time_command();
 
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace engine
+{
+    /// Picks the fraction of the swapchain's resolution the scene is rendered at, so that the GPU time of frames
+    /// stays within a budget.
+    ///
+    /// The GPU time of a frame is taken to grow with the number of pixels drawn, so the scale moves towards the square
+    /// root of the ratio of the budget to the measured time. It only grows once the time is comfortably under the
+    /// budget, so that it does not oscillate around it.
+    class DynamicResolution final
+    {
+      public:
+        struct Statistics
+        {
+            /// GPU time of recent frames, smoothed
+            double   gpu_ms  = 0.0;
+            float    scale   = 1.0f;
+            /// Times the scale has changed
+            uint32_t changes = 0;
+        };
+
+        /// Account for a frame which took `gpu_ms` on the GPU, updating the scale unless disabled
+        void update(double gpu_ms);
+        /// Return to full resolution and forget earlier measurements
+        void reset();
+
+        /// Scale of each side of the render target, between `min_scale` and `max_scale`, or 1 when disabled
+        float        scale() const noexcept;
+        /// Size of the render target for a swapchain of size `extent`
+        vk::Extent2D extent(vk::Extent2D full) const noexcept;
+        Statistics   statistics() const noexcept;
+
+        bool   enabled   = true;
+        /// GPU time per frame to stay within. The default leaves some headroom at 60 Hz.
+        double budget_ms = 15.0;
+        float  min_scale = 0.5f;
+        float  max_scale = 1.0f;
+
+      private:
+        float      m_scale      = 1.0f;
+        /// Updates left before the scale may change again
+        uint32_t   m_cooldown   = 0;
+        Statistics m_statistics = {};
+    };
+} // namespace engine
@@ -0,0 +1,151 @@
+#pragma once
+#include "allocation.hpp"
+#include "constants.hpp"
+#include "image_allocation.hpp"
+#include "scene/bounds.hpp"
+#include <array>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace engine
+{
+    /// Bindings of an indexed draw, kept by the `OcclusionCuller` to record it in both of its phases
+    struct IndexedDraw
+    {
+        vk::Pipeline      pipeline      = {};
+        vk::DescriptorSet descriptor    = {};
+        /// Holds both the vertices and the indices
+        vk::Buffer        buffer        = {};
+        vk::DeviceSize    vertex_offset = 0;
+        vk::DeviceSize    index_offset  = 0;
+        uint32_t          index_count   = 0;
+        uint32_t          first_index   = 0;
+    };
+
+    /// Culls the draws of objects hidden behind what was drawn before them, using a hierarchical depth buffer.
+    ///
+    /// Draws issued between `begin` and `end` become indirect draws, whose instance counts are written by a compute
+    /// shader testing each object's bounds against a pyramid of the farthest depths of the frame. Culling takes two
+    /// phases, so that objects uncovered since the last frame are not missing for a frame:
+    ///
+    /// 1. Before rendering, objects are tested against the pyramid built in the previous frame, and those that
+    ///    pass are drawn.
+    /// 2. The pyramid is rebuilt from the depth drawn by the first phase. The objects rejected by the first phase are
+    ///    tested against it, and those that pass are drawn once rendering resumes.
+    class OcclusionCuller final
+    {
+      public:
+        struct Statistics
+        {
+            /// Objects with at least one draw
+            uint32_t tested   = 0;
+            /// Objects rejected by both phases
+            uint32_t occluded = 0;
+            /// Objects rejected by the first phase and drawn by the second
+            uint32_t revealed = 0;
+        };
+
+        void init(class VulkanBackend &backend);
+        void destroy();
+        /// Retire the resources sized after the swapchain, to be destroyed once the submission signalling `value` has
+        /// finished
+        void resize(class DeletionQueue &retired, uint64_t value);
+
+        /// Start culling the draws of the objects whose world space bounds are `bounds`.
+        ///
+        /// Set `context.occlusion_item` to the index of an object in `bounds` before drawing it. Must be called before
+        /// anything else is drawn in the frame, and followed by `end`.
+        void begin(struct DrawingContext &context, std::span<const Aabb> bounds);
+        /// Queue an indexed draw of the current object, which is only issued by the GPU if the object is visible
+        void draw_indexed(struct DrawingContext &context, const IndexedDraw &draw);
+        /// Test the queued draws and record both phases. Anything drawn afterwards is not culled.
+        void end(struct DrawingContext &context);
+
+        /// Counts of the last frame read back, which is as old as the backend has frames in flight
+        Statistics statistics() const noexcept;
+
+        OcclusionCuller();
+        ~OcclusionCuller();
+
+        OcclusionCuller(const OcclusionCuller &)            = delete;
+        OcclusionCuller(OcclusionCuller &&)                 = delete;
+        OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+        OcclusionCuller &operator=(OcclusionCuller &&)      = delete;
+
+      private:
+        /// Matches the layout of `Draw` in the culling shader
+        struct GpuDraw
+        {
+            vk::DrawIndexedIndirectCommand early   = {};
+            vk::DrawIndexedIndirectCommand late    = {};
+            uint32_t                       item    = 0;
+            uint32_t                       padding = 0;
+        };
+
+        struct Frame
+        {
+            vk::CommandBuffer early_cmd = {};
+            vk::DescriptorSet cull_set  = {};
+
+            /// Minimum and maximum corners of each object
+            TypedHostVisibleBufferAllocation<glm::vec4[]> bounds     = {};
+            TypedHostVisibleBufferAllocation<GpuDraw[]>   draws      = {};
+            TypedHostVisibleBufferAllocation<uint32_t[]>  visibility = {};
+
+            std::vector<IndexedDraw> queued  = {};
+            /// Object of each queued draw
+            std::vector<uint32_t>    items   = {};
+            /// Objects passed to `begin`
+            uint32_t                 objects = 0;
+            /// Objects in `visibility`; zero if it holds no results
+            uint32_t                 tested  = 0;
+        };
+
+        void create_pipelines();
+        /// Create the pyramid for the current swapchain if it does not exist
+        void create_pyramid();
+        void destroy_pyramid();
+        /// Grow the frame's buffers to fit `objects` objects and `draws` draws
+        void reserve(Frame &frame, size_t objects, size_t draws);
+        /// Read back the results of the last use of the frame
+        void read_back(Frame &frame);
+
+        void record_early_phase(Frame &frame, const struct DrawingContext &context);
+        /// Record building the pyramid from the top left `extent` of the depth buffer of frame `frame` in flight
+        void record_pyramid(vk::CommandBuffer cmd, uint32_t frame, vk::Extent2D extent);
+        /// Record the queued draws, using the early or late commands
+        void record_draws(struct DrawingContext &context, const Frame &frame, bool late);
+
+        class VulkanBackend *m_backend = nullptr;
+        vk::Device           m_device  = {};
+
+        vk::Sampler             m_sampler                 = {};
+        vk::DescriptorSetLayout m_pyramid_layout          = {};
+        vk::DescriptorSetLayout m_cull_layout             = {};
+        vk::PipelineLayout      m_pyramid_pipeline_layout = {};
+        vk::PipelineLayout      m_cull_pipeline_layout    = {};
+        vk::Pipeline            m_pyramid_pipeline        = {};
+        vk::Pipeline            m_cull_pipeline           = {};
+        vk::DescriptorPool      m_frame_pool              = {};
+
+        std::array<Frame, MAX_IN_FLIGHT> m_frames = {};
+
+        /// Farthest depth of blocks of the depth buffer, half its size at the first level
+        ImageAllocation                m_pyramid       = {};
+        std::vector<vk::ImageView>     m_level_views   = {};
+        uint32_t                       m_levels        = 0;
+        vk::DescriptorPool             m_pyramid_pool  = {};
+        /// Sets reducing each frame's depth buffer into the first level, then each level into the next
+        std::vector<vk::DescriptorSet> m_pyramid_sets  = {};
+        /// Depth buffer each frame's first set reduces, written when the frame first builds the pyramid
+        std::array<vk::ImageView, MAX_IN_FLIGHT> m_depth_views = {};
+        /// `false` until the pyramid has been built for the current swapchain
+        bool                           m_pyramid_valid = false;
+        /// Size of the scene the pyramid was last built from, which the early phase only tests against if it is drawn
+        /// at the same size
+        vk::Extent2D                   m_pyramid_scene = {};
+
+        Statistics m_statistics = {};
+    };
+} // namespace engine
@@ -3,6 +3,14 @@
 
 namespace engine
 {
+    /// Formats of the attachments a pipeline draws to. Pipelines are compatible with any rendering to attachments of
+    /// the same formats.
+    struct AttachmentFormats
+    {
+        vk::Format color = {};
+        vk::Format depth = {};
+    };
+
     struct ColorBlending
     {
         using Attachment = vk::PipelineColorBlendAttachmentState;
@@ -31,13 +39,17 @@ namespace engine
         ColorBlending               color_blending                = {};
 
         struct PreparedPipelineConfiguration prepare(vk::PipelineLayout pipeline_layout,
-                                                     vk::RenderPass     render_pass) const;
+                                                     AttachmentFormats  formats) const;
     };
 
     struct PreparedPipelineConfiguration
     {
         PreparedPipelineConfiguration(const PipelineConfiguration &config, vk::PipelineLayout pipeline_layout,
-                                      vk::RenderPass render_pass);
+                                      AttachmentFormats formats);
+
+        /// Holds pointers to its own members, so it cannot be copied
+        PreparedPipelineConfiguration(const PreparedPipelineConfiguration &)            = delete;
+        PreparedPipelineConfiguration &operator=(const PreparedPipelineConfiguration &) = delete;
 
         vk::PipelineDynamicStateCreateInfo             dynamic_state;
         std::vector<vk::PipelineShaderStageCreateInfo> shader_stages;
@@ -49,25 +61,32 @@ namespace engine
         vk::PipelineDepthStencilStateCreateInfo        depth_stencil;
         vk::PipelineColorBlendStateCreateInfo          color_blending;
         vk::PipelineLayout                             pipeline_layout;
-        vk::RenderPass                                 render_pass;
+        AttachmentFormats                              formats;
+        vk::PipelineRenderingCreateInfo                rendering;
 
         operator vk::GraphicsPipelineCreateInfo() const;
     };
 
     inline PreparedPipelineConfiguration PipelineConfiguration::prepare(vk::PipelineLayout pipeline_layout,
-                                                                        vk::RenderPass     render_pass) const
+                                                                        AttachmentFormats  formats) const
     {
-        return PreparedPipelineConfiguration(*this, pipeline_layout, render_pass);
+        return PreparedPipelineConfiguration(*this, pipeline_layout, formats);
     }
 
     inline PreparedPipelineConfiguration::PreparedPipelineConfiguration(const PipelineConfiguration &config,
                                                                         vk::PipelineLayout           pipeline_layout,
-                                                                        vk::RenderPass               render_pass)
+                                                                        AttachmentFormats            formats)
         : rasterizer(config.rasterizer)
         , multisampling(config.multisampling)
         , pipeline_layout(pipeline_layout)
-        , render_pass(render_pass)
+        , formats(formats)
     {
+        rendering = {
+            .colorAttachmentCount    = 1,
+            .pColorAttachmentFormats = &this->formats.color,
+            .depthAttachmentFormat   = formats.depth,
+        };
+
         dynamic_state = {
             .dynamicStateCount = (uint32_t)config.dynamic_states.size(),
             .pDynamicStates    = config.dynamic_states.data(),
@@ -127,6 +146,7 @@ namespace engine
     inline PreparedPipelineConfiguration::operator vk::GraphicsPipelineCreateInfo() const
     {
         return {
+            .pNext               = &rendering,
             .stageCount          = (uint32_t)shader_stages.size(),
             .pStages             = shader_stages.data(),
             .pVertexInputState   = &vertex_input,
@@ -138,7 +158,7 @@ namespace engine
             .pColorBlendState    = &color_blending,
             .pDynamicState       = &dynamic_state,
             .layout              = pipeline_layout,
-            .renderPass          = render_pass,
+            .renderPass          = nullptr,
             .subpass             = 0,
             .basePipelineHandle  = nullptr,
             .basePipelineIndex   = -1,
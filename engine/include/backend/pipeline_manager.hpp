@@ -0,0 +1,113 @@
+#pragma once
+#include "jobs/job_system.hpp"
+#include "pipeline_configuration.hpp"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vulkan/vulkan.hpp>
+
+namespace engine
+{
+    /// Identifies a pipeline registered with a `PipelineManager`.
+    using PipelineId = uint32_t;
+
+    /// Owns graphics pipelines and compiles new variants on worker threads.
+    ///
+    /// Until a variant has compiled, requests for it resolve to its fallback pipeline, or to nothing if it has none, in
+    /// which case the draw should be skipped. Either way, the frame does not stall on compilation.
+    class PipelineManager final
+    {
+      public:
+        static constexpr PipelineId NO_FALLBACK = ~PipelineId(0);
+
+        struct Statistics
+        {
+            /// Variants which finished compiling on a worker
+            uint32_t compiled             = 0;
+            /// Variants still being compiled
+            uint32_t pending              = 0;
+            /// Variants which failed to compile
+            uint32_t failed               = 0;
+            /// Compile time of the most recent variant
+            double   last_compile_ms      = 0.0;
+            /// Longest compile time of any variant
+            double   max_compile_ms       = 0.0;
+            /// Sum of the compile times of every variant
+            double   total_compile_ms     = 0.0;
+            /// Frames in which a draw used a fallback or was skipped instead of waiting for a compilation
+            uint64_t hitch_frames_avoided = 0;
+            /// Draws which used a fallback pipeline
+            uint64_t fallback_draws       = 0;
+            /// Draws which were skipped for lack of a pipeline
+            uint64_t skipped_draws        = 0;
+        };
+
+        void init(vk::Device device, JobSystem::Shared job_system);
+        /// Wait for outstanding compilations and destroy every pipeline
+        void destroy();
+
+        /// Pipeline cache shared by every compilation
+        vk::PipelineCache cache() const noexcept;
+
+        /// Register an already created pipeline, which the manager takes ownership of.
+        PipelineId add(std::string_view name, vk::Pipeline pipeline);
+
+        /// Register a pipeline variant and start compiling it on a worker.
+        ///
+        /// If a pipeline has already been registered under `name`, its ID is returned instead. The layout must outlive
+        /// the manager.
+        PipelineId request(std::string_view name, PipelineConfiguration config, vk::PipelineLayout layout,
+                           AttachmentFormats formats, PipelineId fallback = NO_FALLBACK);
+
+        /// Find a pipeline by name
+        std::optional<PipelineId> find(std::string_view name) const;
+
+        /// `true` if the pipeline has compiled
+        bool ready(PipelineId id) const;
+
+        /// Get the pipeline to bind for `id`: the pipeline itself if it has compiled, otherwise its fallback.
+        ///
+        /// Returns `nullptr` if the draw should be skipped.
+        vk::Pipeline get(PipelineId id);
+
+        /// Mark the end of a frame for the hitch statistics.
+        void end_frame();
+
+        Statistics statistics() const;
+
+        PipelineManager();
+        ~PipelineManager();
+
+        PipelineManager(const PipelineManager &)            = delete;
+        PipelineManager(PipelineManager &&)                 = delete;
+        PipelineManager &operator=(const PipelineManager &) = delete;
+        PipelineManager &operator=(PipelineManager &&)      = delete;
+
+      private:
+        struct Variant
+        {
+            std::string  name     = {};
+            PipelineId   fallback = NO_FALLBACK;
+            vk::Pipeline pipeline = {};
+            bool         ready    = false;
+            bool         failed   = false;
+        };
+
+        void compile(Variant &variant, PipelineConfiguration config, vk::PipelineLayout layout,
+                     AttachmentFormats formats);
+
+        std::shared_ptr<spdlog::logger> m_logger       = {};
+        vk::Device                      m_device       = {};
+        vk::PipelineCache               m_cache        = {};
+        JobSystem::Shared               m_job_system   = {};
+        std::deque<Variant>             m_variants     = {};
+        mutable std::mutex              m_mutex        = {};
+        Statistics                      m_statistics   = {};
+        std::atomic<uint32_t>           m_compiling    = 0;
+        bool                            m_frame_missed = false;
+    };
+} // namespace engine
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vulkan/vulkan.hpp>
+
+namespace engine
+{
+    /// Trade-off between input latency, smoothness and power made when presenting frames
+    enum class PresentPolicy : uint8_t
+    {
+        /// Immediate or mailbox presentation, with one frame in flight
+        LowLatency,
+        /// FIFO presentation, with two or three frames in flight
+        Smooth,
+        /// Relaxed FIFO presentation, with two frames in flight and a capped frame rate
+        PowerSaving,
+        /// Immediate presentation, with as many frames in flight as keep the GPU busy and no cap
+        Benchmark,
+    };
+
+    constexpr size_t PRESENT_POLICY_COUNT = 4;
+
+    /// How a policy presents frames
+    struct PresentSettings
+    {
+        /// Present modes by preference. FIFO, which every device supports, is used if none of them is.
+        std::span<const vk::PresentModeKHR> modes      = {};
+        /// Bounds of the frames in flight picked from the measured frame balance
+        uint32_t                            min_frames = 1;
+        uint32_t                            max_frames = 1;
+        /// Frames per second at most, or 0 for no cap
+        double                              frame_cap  = 0.0;
+    };
+
+    PresentSettings  present_settings(PresentPolicy policy) noexcept;
+    std::string_view to_string(PresentPolicy policy);
+} // namespace engine
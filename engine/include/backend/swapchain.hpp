@@ -1,6 +1,11 @@
 #pragma once
+#include "backend/deletion_queue.hpp"
 #include "backend/image_allocation.hpp"
+#include "backend/pipeline_configuration.hpp"
+#include "constants.hpp"
 #include <GLFW/glfw3.h>
+#include <array>
+#include <memory>
 #include <vulkan/vulkan.hpp>
 
 namespace engine
@@ -36,49 +41,99 @@ namespace engine
         inline operator vk::ImageView() { return view; }
     };
 
-    struct Framebuffer
+    struct SwapchainImage
     {
-        Image           color  = {};
-        ImageAllocation depth  = {};
-        vk::Framebuffer handle = nullptr;
+        Image         color           = {};
+        /// Signalled when rendering to the image ends, and waited on by its presentation. Belongs to the image rather
+        /// than to a frame, since the presentation engine may still hold it after the frame's submission has finished.
+        vk::Semaphore render_finished = nullptr;
+    };
 
-        inline operator vk::Framebuffer() { return handle; }
+    /// Attachments the scene of a frame in flight is drawn to, as large as the swapchain. Scenes drawn at a lower
+    /// resolution use their top left corner.
+    struct SceneTargets
+    {
+        ImageAllocation color = {};
+        ImageAllocation depth = {};
     };
 
+    using FrameTargets = std::array<SceneTargets, MAX_IN_FLIGHT>;
+
     class SwapchainManager final
     {
         using SharedDeviceManager = std::shared_ptr<class RenderDeviceManager>;
 
       public:
         SwapchainManager();
-        SwapchainManager(SharedDeviceManager device_manager, vk::SurfaceKHR surface, SwapchainConfiguration config);
+        SwapchainManager(SharedDeviceManager device_manager, vk::SurfaceKHR surface, SwapchainConfiguration config,
+                         std::shared_ptr<VulkanAllocator> allocator);
         ~SwapchainManager();
 
-        /// Returns `true` if the swapchain is valid
-        bool recreate_swapchain(SwapchainConfiguration config);
-
-        void init(SharedDeviceManager device_manager, vk::SurfaceKHR surface, SwapchainConfiguration config);
+        /// Create a new swapchain from the old one, returning `true` if it is valid.
+        ///
+        /// The old swapchain and its images are retired into `retired`, to be destroyed once the submission signalling
+        /// `value` has finished, so that frames still using them need not be waited for.
+        bool recreate_swapchain(SwapchainConfiguration config, DeletionQueue &retired, uint64_t value);
+
+        void init(SharedDeviceManager device_manager, vk::SurfaceKHR surface, SwapchainConfiguration config,
+                  std::shared_ptr<VulkanAllocator> allocator);
+        /// First half of `init`: selects the depth format and how the scene is upscaled.
+        ///
+        /// Pipelines may be created against `formats()` before `init_swapchain` is called.
+        void init_formats(SharedDeviceManager device_manager, vk::SurfaceKHR surface, SwapchainConfiguration config);
+        /// Second half of `init`: creates the swapchain and its images. Depth buffers are created on use, from
+        /// `allocator`.
+        void init_swapchain(std::shared_ptr<VulkanAllocator> allocator);
         void destroy();
 
         operator bool() const noexcept;
         operator vk::SwapchainKHR() const noexcept;
 
-        Framebuffer &operator[](size_t i);
+        SwapchainImage &operator[](size_t i);
+
+        /// Formats of the scene's attachments, which scene pipelines are created against
+        AttachmentFormats formats() const noexcept;
+        /// Formats of the overlay drawn on the swapchain image at full resolution, which has no depth
+        AttachmentFormats overlay_formats() const noexcept;
+
+        /// Begin rendering the scene of frame `frame`, to the top left `extent` of its targets.
+        ///
+        /// Unless `resume` is set, the attachments are cleared. Otherwise they keep what was drawn before the last
+        /// `end_rendering`.
+        void begin_rendering(vk::CommandBuffer cmd, uint32_t frame, vk::Extent2D extent, bool resume);
+        /// End rendering the scene, leaving its color ready to be upscaled and its depth readable by compute shaders
+        void end_rendering(vk::CommandBuffer cmd, uint32_t frame);
+        /// Upscale the top left `extent` of the scene of frame `frame` to swapchain image `image`, then begin
+        /// rendering the overlay to the image
+        void begin_overlay(vk::CommandBuffer cmd, uint32_t image, uint32_t frame, vk::Extent2D extent);
+        /// End rendering the overlay, leaving the image ready to present
+        void end_overlay(vk::CommandBuffer cmd, uint32_t image);
+
+        /// Depth buffer of frame `frame` in flight, created on first use.
+        ///
+        /// Depth only lives within a frame, so rather than one per swapchain image, there is one per frame in flight.
+        ImageAllocation &depth(uint32_t frame);
 
       private:
         void create_swapchain();
         void get_swapchain_images();
         void destroy_swapchain();
-
-        SharedDeviceManager m_device_manager = nullptr;
-        vk::Device          m_device         = nullptr;
-        vk::SurfaceKHR      m_surface        = nullptr;
+        static void destroy_images(vk::Device device, std::vector<SwapchainImage> &images);
+        /// Targets of frame `frame` in flight, created on first use
+        SceneTargets &targets(uint32_t frame);
+
+        SharedDeviceManager              m_device_manager = nullptr;
+        vk::Device                       m_device         = nullptr;
+        vk::SurfaceKHR                   m_surface        = nullptr;
+        std::shared_ptr<VulkanAllocator> m_allocator      = nullptr;
+        FrameTargets                     m_targets        = {};
+        /// Linear if the color format supports it
+        vk::Filter                       m_upscale_filter = vk::Filter::eNearest;
 
       public:
-        vk::RenderPass           render_pass   = nullptr;
-        vk::SwapchainKHR         swapchain     = nullptr;
-        std::vector<Framebuffer> images        = {};
-        SwapchainConfiguration   configuration = {};
-        vk::Format               depth_format  = {};
+        vk::SwapchainKHR            swapchain     = nullptr;
+        std::vector<SwapchainImage> images        = {};
+        SwapchainConfiguration      configuration = {};
+        vk::Format                  depth_format  = {};
     };
 } // namespace engine
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <vulkan/vulkan.hpp>
+
+namespace engine
+{
+    /// Tracks the work submitted to a device with a single timeline semaphore.
+    ///
+    /// Every batch submitted through `submit` signals the next value, so a value is reached once its batch, and every
+    /// batch submitted before it, has finished. Anything used by the GPU is stamped with the value of the last batch
+    /// using it, and whether it is still in use is a comparison with the last value read from the semaphore.
+    ///
+    /// Values must be signalled in increasing order, so every batch goes to the same queue.
+    class Timeline final
+    {
+      public:
+        void init(vk::Device device);
+        void destroy();
+
+        /// Submit `batches` to `queue`, each also signalling the next value, returning the value of the last one.
+        ///
+        /// Batch `i` of `n` signals the returned value minus `n - 1 - i`. The batches must not chain their own
+        /// `vk::TimelineSemaphoreSubmitInfo`. Safe to call from any thread.
+        uint64_t submit(vk::Queue queue, std::span<const vk::SubmitInfo> batches);
+
+        /// Value signalled by the last batch submitted
+        uint64_t submitted() const noexcept;
+        /// Last value read from the semaphore
+        uint64_t completed() const noexcept;
+        /// Read the semaphore, returning the last value reached
+        uint64_t poll();
+        /// `value` has been reached. Only reads the semaphore if the last value read is not enough.
+        bool     reached(uint64_t value);
+        /// Wait until `value` has been reached
+        void     wait(uint64_t value);
+
+        vk::Semaphore semaphore() const noexcept;
+
+      private:
+        /// Record that `value` has been reached
+        void complete(uint64_t value) noexcept;
+
+        vk::Device    m_device    = nullptr;
+        vk::Semaphore m_semaphore = nullptr;
+        /// Held while values are handed out and submitted, so that they are signalled in order
+        std::mutex    m_submit    = {};
+
+        std::atomic<uint64_t> m_submitted = 0;
+        std::atomic<uint64_t> m_completed = 0;
+    };
+} // namespace engine
@@ -5,14 +5,25 @@
 #include "allocation.hpp"
 #include "allocator.hpp"
 #include "command_pool.hpp"
+#include "deletion_queue.hpp"
 #include "constants.hpp"
 #include "descriptor_pool.hpp"
+#include "dynamic_resolution.hpp"
 #include "drawables/GouraudMesh.hpp"
 #include "drawables/drawing_context.hpp"
+#include "jobs/job_system.hpp"
+#include "occlusion_culler.hpp"
+#include "pipeline_configuration.hpp"
+#include "pipeline_manager.hpp"
+#include "present_policy.hpp"
 #include "swapchain.hpp"
+#include "timeline.hpp"
 #include "version.hpp"
 #include "vertex.hpp"
 #include <GLFW/glfw3.h>
+#include <array>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <span>
@@ -24,8 +35,6 @@ namespace engine
     struct GpuSync
     {
         vk::Semaphore image_available = {};
-        vk::Semaphore render_finished = {};
-        vk::Fence     in_flight       = {};
 
         void init(vk::Device device);
         void destroy(vk::Device device);
@@ -37,6 +46,21 @@ namespace engine
         glm::mat4 projection = {};
     };
 
+    /// How a backend's frames divide between the CPU and waiting on the GPU, averaged over recent frames
+    struct FrameBalance
+    {
+        /// Time from one frame's start to the next
+        double   frame_ms    = 0.0;
+        /// Time spent waiting for a frame set and a swapchain image at the start of a frame
+        double   wait_ms     = 0.0;
+        /// Time the CPU spends on a frame outside of that wait
+        double   cpu_ms      = 0.0;
+        /// Standard deviation of the CPU time, relative to the frame time
+        double   cpu_jitter  = 0.0;
+        /// Frames in flight suited to this balance, within the bounds of the present policy
+        uint32_t recommended = DEFAULT_IN_FLIGHT;
+    };
+
     /// Manages the data pertaining to a rendering pipeline.
     ///
     /// Must be owned by the window using it.
@@ -56,17 +80,18 @@ namespace engine
             VmaAllocation     alloc;
             vk::Buffer        buffer;
             vk::CommandBuffer cmd;
-            vk::Fence         transfer_fence;
+            /// Timeline value signalled by the last transfer, after which the buffer may be reused
+            uint64_t          last_use;
             bool              is_coherent;
             void             *p_mapping;
 
             operator uint8_t *();
 
-            void init(VmaAllocator allocator, vk::CommandBuffer cmd, vk::Fence fence);
+            void init(VmaAllocator allocator, vk::CommandBuffer cmd);
             void flush(VmaAllocator allocator, vk::DeviceSize offset = 0, vk::DeviceSize length = SIZE);
-            void transfer(vk::Buffer dst, vk::Queue queue, uint32_t src_offset, uint32_t dst_offset, uint32_t size);
-            void reset(vk::Device device);
-            void wait(vk::Device device);
+            void transfer(vk::Buffer dst, Timeline &timeline, vk::Queue queue, uint32_t src_offset, uint32_t dst_offset,
+                          uint32_t size);
+            void wait(Timeline &timeline);
             void deinit(vk::Device device, vk::CommandPool cmd_pool, VmaAllocator allocator);
         };
 
@@ -75,31 +100,102 @@ namespace engine
             vk::CommandBuffer                              command_buffer;
             GpuSync                                        sync;
             std::array<vk::DescriptorSet, MAX_DESCRIPTORS> descriptors;
+            /// Timeline value signalled by the last submission of this frame set, or 0
+            uint64_t                                       submitted;
+            /// Start of the frame last submitted from this set
+            std::chrono::steady_clock::time_point          started;
+            PresentPolicy                                  started_policy;
+            /// The frame last submitted from this set has not been seen to finish
+            bool                                           pending;
+            /// The frame last submitted from this set wrote its timestamps, which have not been read
+            bool                                           timed;
         };
 
       public:
+        /// Extra step of the backend's startup, run on the job system once the attachment formats are selected
+        using StartupTask = std::function<void(VulkanBackend &)>;
+
+        /// ID of the default pipeline, which is the fallback for every variant
+        static constexpr PipelineId GOURAUD_PIPELINE = 0;
+
         void update_fov(float fov);
         void update_view(const glm::mat4 &transformation);
 
         std::shared_ptr<class GouraudMesh> load(std::span<primitives::GouraudVertex> vertices,
                                                 std::span<uint32_t>                  indices);
 
+        /// Request a variant of the default pipeline, compiled asynchronously.
+        ///
+        /// Draws using the variant fall back to the default pipeline until it has compiled.
+        PipelineId request_pipeline(std::string_view name, const PipelineConfiguration &config);
+        /// Bind the pipeline to draw with, returning `false` if the draw should be skipped
+        bool       bind_pipeline(DrawingContext &context, PipelineId pipeline);
+        /// Take the next of the frame's descriptor sets, or a null handle once all `MAX_DESCRIPTORS` are used, in
+        /// which case the draw should be skipped
+        vk::DescriptorSet next_descriptor(DrawingContext &context);
+
         std::optional<DrawingContext> begin_draw();
         void                          end_draw(DrawingContext &context);
+        /// Upscale the scene to the swapchain image, so that what is drawn next is drawn at full resolution. Called
+        /// before drawing the interface; does nothing if it has already been called for the frame.
+        void                          begin_overlay(DrawingContext &context);
+        /// Finish recording a frame without submitting it, so that it can be submitted with `submit_frames`
+        void                          finish_draw(DrawingContext &context);
+
+        /// Submit and present frames from several backends on the same device.
+        ///
+        /// All frames go into a single queue submission and are presented with a single present call. Each frame must
+        /// have been finished with `finish_draw`.
+        static void submit_frames(std::span<VulkanBackend *const> backends, std::span<DrawingContext> contexts);
+
+        uint32_t     frames_in_flight() const noexcept;
+        /// Set how many frames may be in flight, between 1 and `MAX_IN_FLIGHT`.
+        ///
+        /// Takes effect once the current frame is submitted, which waits for the device to be idle.
+        void         set_frames_in_flight(uint32_t count);
+        FrameBalance frame_balance() const noexcept;
+
+        PresentPolicy      present_policy() const noexcept;
+        /// Switch the present policy, recreating the swapchain once the current frame is submitted
+        void               set_present_policy(PresentPolicy policy);
+        vk::PresentModeKHR present_mode() const noexcept;
+        /// Time from the start of a frame until the GPU has finished it, averaged over the frames presented under
+        /// `policy`, or 0 if it has never been used.
+        ///
+        /// Frames are only seen to finish at the start of a later frame, unless that frame waits for them, so the
+        /// latency is overestimated by up to a frame with more than one frame in flight. The time the presentation
+        /// engine holds the image before it is displayed is not included.
+        double             present_latency(PresentPolicy policy) const noexcept;
+
+        /// Pick the number of frames in flight from the measured frame balance, within the bounds of the present
+        /// policy.
+        ///
+        /// Each frame in flight adds a frame period to the input latency, so the CPU only runs ahead of the GPU when
+        /// that hides something: one frame in flight when the CPU is nearly idle, and three or four when the CPU time
+        /// varies so much that a shallow queue would leave the GPU idle after a slow frame.
+        bool auto_frames_in_flight = true;
+
+        /// Scales the resolution the scene is drawn at to keep the GPU time of frames within its budget. GPU times are
+        /// only measured if the graphics queue supports timestamps.
+        DynamicResolution dynamic_resolution = {};
 
         ~VulkanBackend();
 
         /// Make a new shared pointer to a RenderManager
-        static Unique new_unique(std::string_view application_name, Version application_version, GLFWwindow *window);
-        /// Clone the instance/device managers to create a new RenderManager
+        ///
+        /// Independent initialization steps are run concurrently on `job_system`, along with `overlay`, which sets up
+        /// whatever draws over the scene, such as the interface.
+        static Unique new_unique(std::string_view application_name, Version application_version, GLFWwindow *window,
+                                 JobSystem::Shared job_system, StartupTask overlay = {});
+        /// Clone the instance/device managers and the job system to create a new RenderManager
         ///
         /// The device from `other` must be compatible with the surface created with the window
-        static Unique new_from(const VulkanBackend &other, GLFWwindow *window);
+        static Unique new_from(const VulkanBackend &other, GLFWwindow *window, StartupTask overlay = {});
 
-        /// Wait until the device is idle
+        /// Wait until the device is idle, and destroy every retired object
         void wait_idle();
 
-        /// Recreate the swapchain
+        /// Recreate the swapchain. The old one is destroyed once the frames using it have finished.
         bool recreate_swapchain();
 
         // No copying
@@ -113,8 +209,11 @@ namespace engine
         std::shared_ptr<spdlog::logger> m_logger           = {};
         SharedInstanceManager           m_instance_manager = {};
         SharedDeviceManager             m_device_manager   = {};
+        JobSystem::Shared               m_job_system       = {};
 
         uint32_t                         m_frame_index               = 0;
+        uint32_t                         m_frames_in_flight          = DEFAULT_IN_FLIGHT;
+        uint32_t                         m_requested_frames          = DEFAULT_IN_FLIGHT;
         GLFWwindow                      *m_window                    = {};
         vk::Device                       m_device                    = {};
         std::shared_ptr<VulkanAllocator> m_allocator                 = {};
@@ -124,6 +223,8 @@ namespace engine
         SwapchainManager                 m_swapchain                 = {};
         vk::PipelineLayout               m_pipeline_layout           = {};
         vk::Pipeline                     m_gouraud_pipeline          = {};
+        PipelineConfiguration            m_gouraud_configuration     = {};
+        PipelineManager                  m_pipelines                 = {};
         CommandPoolManager               m_command_pool              = {};
         DescriptorPoolManager            m_descriptor_pool           = {};
         std::vector<FrameSet>            m_frame_sets                = {};
@@ -131,21 +232,30 @@ namespace engine
         vk::ShaderModule                 m_fragment_shader           = {};
         vk::DescriptorSetLayout          m_uniform_descriptor_layout = {};
         StagingBuffer                    m_staging_buffer            = {};
+        OcclusionCuller                  m_occlusion                 = {};
+        /// Objects replaced while frames in flight may still use them
+        DeletionQueue                    m_retired                   = {};
 
-        float                                                            m_fov        = DEFAULT_FOV;
-        glm::mat4                                                        m_camera     = {1.0};
-        TypedHostVisibleBufferAllocation<ViewProjectionUniform[MAX_IN_FLIGHT]> m_vp_uniform = {};
+        float                                                     m_fov        = DEFAULT_FOV;
+        glm::mat4                                                 m_camera     = {1.0};
+        /// One uniform per frame in flight
+        TypedHostVisibleBufferAllocation<ViewProjectionUniform[]> m_vp_uniform = {};
 
         bool m_framebuffer_resized = false;
 
       private:
-        VulkanBackend(std::string_view application_name, Version application_version, GLFWwindow *window);
-        VulkanBackend(const VulkanBackend &other, GLFWwindow *window);
+        VulkanBackend(std::string_view application_name, Version application_version, GLFWwindow *window,
+                      JobSystem::Shared job_system, const StartupTask &overlay);
+        VulkanBackend(const VulkanBackend &other, GLFWwindow *window, const StartupTask &overlay);
 
         // Pipeline initialization functions
 
-        /// Create the pipeline
-        void create_pipeline();
+        /// Create the pipeline, running independent steps and `overlay` concurrently
+        void create_pipeline(const StartupTask &overlay);
+        /// Query the surface and pick a swapchain configuration. Must be called from the main thread.
+        SwapchainConfiguration select_swapchain_configuration();
+        /// Select the formats of the swapchain's attachments
+        void select_formats(const SwapchainConfiguration &config);
         /// Create a new swapchain
         void create_swapchain();
         /// Load the shaders
@@ -162,9 +272,59 @@ namespace engine
         void initialize_frame_sets();
         /// Initialize the allocator
         void initialize_device_memory_allocator();
+        /// Initialize the staging buffer
+        void initialize_staging_buffer();
         /// Initialize other data
         void finalize_init();
 
-        void initialize_command_buffer(vk::CommandBuffer buffer, uint32_t image_index);
+        /// Create the pool of the timestamps bracketing each frame's commands, if the graphics queue supports them
+        void create_timestamp_queries();
+        /// Begin recording the frame set `frame`, drawing the scene at `extent`
+        void initialize_command_buffer(vk::CommandBuffer buffer, uint32_t frame, vk::Extent2D extent);
+        /// Recreate the swapchain if required and move on to the next frame set
+        void advance_frame(bool out_of_date);
+        /// Create frame sets until there are `count`. Frame sets are never destroyed before the backend.
+        void grow_frame_sets(size_t count);
+        /// Resize the per-frame resources for `count` frames in flight. Must be called between frames.
+        void resize_frames_in_flight(uint32_t count);
+        /// Account for the frame last submitted from `set` having finished by `now`, collecting the objects retired
+        /// until then and recording its latency and GPU time
+        void finish_frame(FrameSet &set, std::chrono::steady_clock::time_point now);
+        /// Account for the start of a frame, which waited `wait` for its frame set and image
+        void measure_frame(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration wait);
+
+        /// Frames averaged by a frame balance measurement
+        static constexpr uint32_t BALANCE_WINDOW = 120;
+
+        struct BalanceWindow
+        {
+            uint32_t frames    = 0;
+            double   frame_ms  = 0.0;
+            double   wait_ms   = 0.0;
+            double   cpu_ms    = 0.0;
+            double   cpu_ms_sq = 0.0;
+        };
+
+        std::chrono::steady_clock::time_point m_frame_start   = {};
+        std::chrono::steady_clock::duration   m_frame_wait    = {};
+        BalanceWindow                         m_window_sums   = {};
+        FrameBalance                          m_balance       = {};
+        /// A measurement has completed since the last frame was submitted
+        bool                                  m_balance_ready = false;
+
+        PresentPolicy                            m_present_policy = PresentPolicy::Smooth;
+        /// The swapchain must be recreated for a new present policy
+        bool                                     m_policy_changed = false;
+        std::array<double, PRESENT_POLICY_COUNT> m_latency_ms     = {};
+
+        /// A frame has run out of descriptor sets, which has been warned about
+        bool m_descriptors_exhausted = false;
+
+        /// Two timestamps per frame set, or empty if the graphics queue does not support them
+        vk::QueryPool m_timestamps       = {};
+        /// Nanoseconds per timestamp tick
+        double        m_timestamp_period = 0.0;
+        /// Bits of the timestamps which are valid
+        uint64_t      m_timestamp_mask   = 0;
     };
 } // namespace engine
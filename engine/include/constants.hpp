@@ -3,9 +3,14 @@
 
 namespace engine
 {
-    constexpr size_t MAX_IN_FLIGHT   = 2;
-    constexpr size_t MAX_DESCRIPTORS = 128;
-    constexpr float  DEFAULT_FOV     = 70.0;
+    /// Most frames a backend can have in flight; per-frame resources of fixed size are sized for this many
+    constexpr size_t MAX_IN_FLIGHT     = 4;
+    /// Frames in flight until a backend has measured its CPU/GPU balance
+    constexpr size_t DEFAULT_IN_FLIGHT = 2;
+    /// Most meshes a frame can draw, each taking one descriptor set; enough for the cubes a streamed world keeps
+    /// loaded around the camera
+    constexpr size_t MAX_DESCRIPTORS   = 1024;
+    constexpr float  DEFAULT_FOV       = 70.0;
 
     constexpr glm::vec3 X_AXIS = {1.0, 0.0, 0.0};
     constexpr glm::vec3 Y_AXIS = {0.0, 1.0, 0.0};
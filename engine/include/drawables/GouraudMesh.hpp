@@ -1,22 +1,56 @@
 #pragma once
+#include "assets/mesh_lod.hpp"
 #include "backend/allocation.hpp"
+#include "backend/pipeline_manager.hpp"
 #include "constants.hpp"
-#include "object.hpp"
+#include "scene/bounds.hpp"
+#include "transform.hpp"
+#include <array>
+#include <glm/glm.hpp>
+#include <vector>
 
 namespace engine
 {
-    class GouraudMesh : public Object
+    /// State of one drawn copy of a mesh, kept by its owner, since meshes loaded from the same path are shared
+    struct MeshInstance
+    {
+        /// Model matrix of each frame in flight, allocated when the instance is first drawn
+        TypedHostVisibleBufferAllocation<glm::mat4[MAX_IN_FLIGHT]> model_matrix   = {};
+        /// Version of the model matrix uploaded for each frame in flight
+        std::array<uint64_t, MAX_IN_FLIGHT>                        model_versions = {};
+        /// Level of detail drawn last, which the next pick starts from
+        uint32_t                                                   lod            = 0;
+    };
+
+    /// Vertex and index data on the GPU, drawn with a model matrix supplied by its owner
+    class GouraudMesh
     {
       public:
-        BufferAllocation                                           allocation;
-        TypedHostVisibleBufferAllocation<glm::mat4[MAX_IN_FLIGHT]> model_matrix;
-        vk::DeviceSize                                             vtx_offset;
-        vk::DeviceSize                                             idx_offset;
-        uint32_t                                                   count;
+        BufferAllocation     allocation;
+        vk::DeviceSize       vtx_offset;
+        vk::DeviceSize       idx_offset;
+        /// Index ranges of each level of detail, finest first
+        std::vector<MeshLod> lods;
+        /// Bounds of the vertices, used to estimate the mesh's size on screen
+        Aabb                 bounds;
+        /// Placement of the vertices relative to the model matrix they are drawn with. Set it before the mesh is
+        /// first drawn, since model matrices uploaded with a version are not uploaded again when it changes.
+        QuatTransform        transform;
+        /// Largest error in pixels tolerated on screen when picking a level of detail
+        float                lod_tolerance;
+        /// How much the error must drop below the tolerance before a coarser level is picked
+        float                lod_hysteresis;
 
-        GouraudMesh(BufferAllocation allocation, vk::DeviceSize vtx_off, vk::DeviceSize idx_off, uint32_t count);
+        GouraudMesh(BufferAllocation allocation, vk::DeviceSize vtx_off, vk::DeviceSize idx_off,
+                    std::vector<MeshLod> lods, Aabb bounds);
 
-        void draw(struct DrawingContext &context, const glm::mat4 &parent_transform = {1.0}) override;
+        /// Draw `instance` of the mesh with `pipeline`, placed by `transform` within `model`, at the level of detail
+        /// suiting its size on screen. The level is picked from the one the instance drew last.
+        ///
+        /// The upload of `model` is skipped if `version` matches the version the instance uploaded for this frame in
+        /// flight. A version of zero is always uploaded.
+        void draw(struct DrawingContext &context, MeshInstance &instance, PipelineId pipeline, const glm::mat4 &model,
+                  uint64_t version = 0);
         ~GouraudMesh();
     };
 } // namespace engine
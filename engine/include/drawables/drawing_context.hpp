@@ -13,7 +13,22 @@ namespace engine
         size_t                                        used_descriptors;
         size_t                                        frame_index;
         uint32_t                                      swapchain_image_index;
+        /// Size the scene is drawn at, which dynamic resolution may make smaller than the swapchain
+        vk::Extent2D                                  render_extent;
         vk::DescriptorBufferInfo                      vp_buffer_info;
+        /// Projection and view matrices of the frame, combined
+        glm::mat4                                     view_projection;
+        /// Location of the camera in world space
+        glm::vec3                                     camera_position;
         vk::CommandBuffer                             cmd;
+        vk::Pipeline                                  bound_pipeline;
+        /// Recorded by the backend's occlusion culler, and submitted before `cmd` if set
+        vk::CommandBuffer                             early_cmd;
+        /// Set between `OcclusionCuller::begin` and `OcclusionCuller::end`, during which draws go through the culler
+        class OcclusionCuller                        *occlusion;
+        /// Index of the object being drawn in the bounds passed to `OcclusionCuller::begin`
+        uint32_t                                      occlusion_item;
+        /// The scene has been upscaled, and draws go to the overlay at full resolution
+        bool                                          overlay;
     };
 } // namespace engine
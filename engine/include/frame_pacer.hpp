@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace engine
+{
+    /// Paces a render loop to a frame rate on `steady_clock`, and measures how regularly its frames end.
+    ///
+    /// Waits sleep until shortly before their deadline, then spin, since sleeping may overshoot by up to the
+    /// scheduler's granularity. How long to spin is learnt from how late recent sleeps woke.
+    class FramePacer final
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        /// Measured over the last complete window of frames
+        struct Statistics
+        {
+            uint32_t frames         = 0;
+            /// Mean time from the end of a frame to the end of the next
+            double   frame_ms       = 0.0;
+            /// Variance of the time between frame ends, in ms²
+            double   frame_variance = 0.0;
+            double   min_frame_ms   = 0.0;
+            double   max_frame_ms   = 0.0;
+            /// Time spent waiting per frame, of which some is spent spinning
+            double   wait_ms        = 0.0;
+            double   spin_ms        = 0.0;
+            /// How late sleeps wake, on average
+            double   oversleep_ms   = 0.0;
+        };
+
+        /// Start a frame, before it samples input. Waits first if latency reduction is on.
+        void begin_frame(Clock::duration period);
+        /// End a frame, after it is presented. Waits until the frame's deadline unless latency reduction is on.
+        ///
+        /// Frames end `period` apart, or as fast as they can if `period` is zero.
+        void end_frame(Clock::duration period);
+        /// Forget the deadline and measurements of earlier frames, before entering a loop
+        void reset();
+        /// Forget the deadline and the end of the last frame, before the loop idles. The idle time is not measured as a
+        /// frame, and the next frame does not wait for a deadline set before it.
+        void pause();
+
+        Statistics statistics() const noexcept;
+
+        /// Frames per second at most, or 0 for no limit. The present policy of the window may cap them further.
+        double frame_rate_limit = 0.0;
+        /// Wait before a frame samples input rather than after it is presented, starting it as late as its measured
+        /// duration allows to meet its deadline, so that the input it shows is more recent. A `WindowGroup` reduces
+        /// latency when any of its windows' pacers does.
+        bool   reduce_latency   = false;
+
+      private:
+        struct Sums
+        {
+            uint32_t frames       = 0;
+            double   frame_ms     = 0.0;
+            double   frame_ms_sq  = 0.0;
+            double   min_frame_ms = 0.0;
+            double   max_frame_ms = 0.0;
+            double   wait_ms      = 0.0;
+            double   spin_ms      = 0.0;
+        };
+
+        /// Sleep until shortly before `deadline`, then spin until it
+        void wait_until(Clock::time_point deadline);
+        void measure(Clock::time_point end);
+
+        /// Deadline of the next frame to end, or empty before the first paced frame
+        Clock::time_point m_deadline     = {};
+        Clock::time_point m_frame_start  = {};
+        Clock::time_point m_last_end     = {};
+        /// Typical time from a frame's start to its end
+        double            m_work_ms      = 0.0;
+        double            m_oversleep_ms = 0.0;
+        Sums              m_sums         = {};
+        Statistics        m_statistics   = {};
+    };
+} // namespace engine
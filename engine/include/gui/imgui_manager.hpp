@@ -14,6 +14,11 @@ namespace engine
         ~ImGuiManager();
 
         void init(VulkanBackend &backend, GLFWwindow *p_window);
+        /// First half of `init`: creates the context and hooks it to the window. Must be called from the main thread.
+        void init_context(GLFWwindow *p_window);
+        /// Second half of `init`: creates the renderer's Vulkan objects. May run on any thread, once the backend's
+        /// attachment formats are selected.
+        void init_renderer(VulkanBackend &backend);
         void destroy();
 
         void make_current();
@@ -21,11 +26,15 @@ namespace engine
         void new_frame();
         void end_frame();
         void update_platform_windows();
+        /// An item is being interacted with, so the interface may change without input, such as a blinking cursor
+        bool active();
         void render(struct DrawingContext &render_context);
 
       private:
         std::shared_ptr<RenderDeviceManager> m_device_manager;
         DescriptorPoolManager                m_descriptor_pool;
         ImGuiContext                        *mp_context;
+        /// Read by the Vulkan backend whenever it creates its pipeline
+        AttachmentFormats                    m_formats;
     };
 } // namespace engine
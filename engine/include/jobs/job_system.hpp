@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace engine
+{
+    /// Ordering of queued jobs. Jobs with a higher priority are taken first.
+    using JobPriority = int32_t;
+
+    /// A fixed pool of worker threads consuming a priority-ordered job queue.
+    ///
+    /// May be shared.
+    class JobSystem final
+    {
+        class Deleter;
+
+      public:
+        using Shared = std::shared_ptr<JobSystem>;
+        using Job    = std::function<void()>;
+
+        /// Create a job system with `worker_count` threads.
+        ///
+        /// Zero picks one thread per hardware thread, minus the calling thread.
+        static Shared new_shared(uint32_t worker_count = 0);
+
+        /// Queue a job to be run by a worker.
+        ///
+        /// Exceptions escaping the job are logged and discarded.
+        void submit(Job job, JobPriority priority = 0);
+
+        /// Queue a job, returning a future for its result.
+        ///
+        /// Exceptions escaping the job are rethrown by the future.
+        template<class F>
+        std::future<std::invoke_result_t<F>> async(F &&function, JobPriority priority = 0);
+
+        /// Split `[0, count)` into batches of at most `batch` elements and run `function(begin, end)` for each batch.
+        ///
+        /// The calling thread takes part in the work and only returns once every batch is done. If a batch throws,
+        /// the batches not yet started are skipped and the first exception is rethrown on the calling thread.
+        void parallel_for(size_t count, size_t batch, const std::function<void(size_t, size_t)> &function);
+
+        /// Run one queued job on the calling thread, if any are available.
+        ///
+        /// Returns `true` if a job was run.
+        bool try_run_one();
+
+        /// Number of worker threads
+        uint32_t worker_count() const noexcept;
+
+        JobSystem(const JobSystem &)            = delete;
+        JobSystem(JobSystem &&)                 = delete;
+        JobSystem &operator=(const JobSystem &) = delete;
+        JobSystem &operator=(JobSystem &&)      = delete;
+
+      private:
+        JobSystem(uint32_t worker_count);
+        ~JobSystem();
+
+        struct QueuedJob
+        {
+            JobPriority priority;
+            uint64_t    sequence;
+            Job         job;
+
+            /// Orders by priority, then by submission order
+            inline bool operator<(const QueuedJob &other) const
+            {
+                if (priority != other.priority)
+                    return priority < other.priority;
+                return sequence > other.sequence;
+            }
+        };
+
+        void worker_main();
+        void run(Job &job);
+
+        std::shared_ptr<spdlog::logger> m_logger   = {};
+        std::vector<std::thread>        m_workers  = {};
+        std::priority_queue<QueuedJob>  m_queue    = {};
+        std::mutex                      m_mutex    = {};
+        std::condition_variable         m_wake     = {};
+        uint64_t                        m_sequence = 0;
+        bool                            m_stopping = false;
+    };
+
+    template<class F>
+    std::future<std::invoke_result_t<F>> JobSystem::async(F &&function, JobPriority priority)
+    {
+        using Result = std::invoke_result_t<F>;
+
+        auto task   = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+        auto future = task->get_future();
+
+        submit([task]() { (*task)(); }, priority);
+
+        return future;
+    }
+} // namespace engine
@@ -0,0 +1,61 @@
+#pragma once
+#include "job_system.hpp"
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace engine
+{
+    /// A set of named tasks with dependencies between them, run on a job system.
+    ///
+    /// Tasks whose dependencies are complete run concurrently. Each task's start and end times are recorded so that
+    /// the run can be logged as a timeline.
+    class TaskGraph final
+    {
+      public:
+        using Task     = std::function<void()>;
+        using Node     = size_t;
+        using Duration = std::chrono::duration<double, std::milli>;
+
+        struct Timing
+        {
+            Duration start = {};
+            Duration end   = {};
+        };
+
+        /// Add a task which runs once all of `dependencies` have finished.
+        Node add(std::string_view name, Task task, std::initializer_list<Node> dependencies = {});
+
+        /// Run every task, returning once all of them have finished. The calling thread runs tasks as well.
+        ///
+        /// If a task throws, the tasks depending on it are skipped and the first exception is rethrown.
+        void run(JobSystem &jobs);
+
+        /// Get the timing of a task relative to the start of the last run
+        const Timing &timing(Node node) const;
+        /// Wall time of the last run
+        Duration      elapsed() const noexcept;
+
+        /// Log each task's start and end time relative to the start of the last run.
+        void log_timeline(spdlog::logger &logger, std::string_view title) const;
+
+      private:
+        struct TaskNode
+        {
+            std::string       name         = {};
+            Task              task         = {};
+            std::vector<Node> dependents   = {};
+            size_t            dependencies = 0;
+            Timing            timing       = {};
+            bool              skipped      = false;
+        };
+
+        std::vector<TaskNode> m_nodes   = {};
+        Duration              m_elapsed = {};
+    };
+} // namespace engine
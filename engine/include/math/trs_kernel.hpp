@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <span>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define ENGINE_TRS_X86 1
+#else
+#    define ENGINE_TRS_X86 0
+#endif
+
+namespace engine::math
+{
+    /// Instruction sets the transform kernel is compiled for, in increasing order of width
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE41,
+        AVX2,
+        AVX512,
+    };
+
+    /// Representation of the rotations given to the kernel
+    enum class RotationMode
+    {
+        /// Euler angles, as in `Transform`
+        Euler,
+        /// Unit quaternions, as in `QuatTransform`
+        Quaternion,
+    };
+
+    std::string_view to_string(SimdLevel level);
+    std::string_view to_string(RotationMode mode);
+
+    /// Widest instruction set supported by both the build and the CPU. Detected once.
+    SimdLevel detect_simd_level() noexcept;
+
+    /// Largest difference between the kernel and the scalar transforms, relative to the larger of one and the
+    /// magnitude of the expected element
+    constexpr float TRS_EPSILON = 1e-5f;
+
+    /// Compose local matrices from translation, Euler rotation and scale, matching `Transform::get_transform_matrix`.
+    ///
+    /// The inputs are structure-of-arrays, one element per matrix. Blocks are computed with the widest instruction set
+    /// up to `level` which the CPU supports, and the remainder with the scalar path.
+    void compose_transforms(std::span<const glm::vec3> locations, std::span<const glm::vec3> rotations,
+                            std::span<const glm::vec3> scales, std::span<glm::mat4> out,
+                            SimdLevel level = detect_simd_level());
+
+    /// Compose local matrices from translation, unit quaternion and scale, matching
+    /// `QuatTransform::get_transform_matrix`.
+    void compose_transforms(std::span<const glm::vec3> locations, std::span<const glm::quat> orientations,
+                            std::span<const glm::vec3> scales, std::span<glm::mat4> out,
+                            SimdLevel level = detect_simd_level());
+
+    struct TrsBenchmark
+    {
+        SimdLevel    level               = SimdLevel::Scalar;
+        RotationMode mode                = RotationMode::Euler;
+        size_t       count               = 0;
+        /// Throughput of `compose_transforms`
+        double       matrices_per_second = 0.0;
+        /// Throughput of the scalar `get_transform_matrix` of the same rotation mode
+        double       baseline_per_second = 0.0;
+        /// Largest relative difference from the baseline
+        float        max_error           = 0.0f;
+        bool         within_epsilon      = false;
+    };
+
+    /// Time `compose_transforms` against `Transform::get_transform_matrix` or `QuatTransform::get_transform_matrix` on
+    /// `count` random transforms.
+    TrsBenchmark benchmark_compose_transforms(size_t count, SimdLevel level = detect_simd_level(),
+                                              RotationMode mode = RotationMode::Euler);
+} // namespace engine::math
@@ -1,4 +1,6 @@
 #pragma once
+#include "scene/bounds.hpp"
+#include "scene/transform_registry.hpp"
 #include "transform.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,23 +12,34 @@ namespace engine
 {
     /// Represents an object.
     ///
-    /// Child objects must be explicitly stored.
+    /// The object's transform is stored in a `TransformRegistry`, which must outlive the object. Child objects must be
+    /// explicitly stored.
     class Object
     {
       public:
+        Object(TransformRegistry &registry);
         virtual ~Object();
 
-        virtual void draw(struct DrawingContext &context, const glm::mat4 &parent_transform = {1.0}) = 0;
+        /// Record the object's draw commands, using `transform.world()` as its model matrix.
+        virtual void draw(struct DrawingContext &context) = 0;
+
+        /// Bounds of the object's geometry, before its transform is applied
+        virtual Aabb local_bounds() const;
+
+        /// Memory of the assets the object loaded for itself alone, such as procedural meshes
+        virtual size_t resource_bytes() const;
 
         virtual void process(double delta);
         virtual void physics_process(double delta);
 
         virtual const reflection::Datastructure *get_rep() const;
 
-        Transform   transform;
-        std::string name;
+        TransformRef transform;
+        std::string  name;
 
-        std::weak_ptr<Object> parent;
+        // The object owns its entity
+        Object(const Object &)            = delete;
+        Object &operator=(const Object &) = delete;
     };
 
     extern const reflection::Datastructure OBJECT_REP;
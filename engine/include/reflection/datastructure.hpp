@@ -8,17 +8,39 @@
 namespace engine::reflection
 {
     /// Representation of a field in a datastructure
+    ///
+    /// Fields are either stored at an offset from the start of the datastructure, or read and written through accessors
+    /// when the value is stored elsewhere.
     struct Field
     {
+        /// Copy the field of `object` into `value`
+        using Getter = void (*)(const void *object, void *value);
+        /// Set the field of `object` from `value`
+        using Setter = void (*)(void *object, const void *value);
+
         const char *name;
         FieldType   type;
         size_t      offset;
+        Getter      getter;
+        Setter      setter;
 
         inline constexpr Field(const char *name, FieldType type, size_t offset)
             : name(name)
             , type(type)
             , offset(offset)
+            , getter(nullptr)
+            , setter(nullptr)
+        { }
+
+        inline constexpr Field(const char *name, FieldType type, Getter getter, Setter setter)
+            : name(name)
+            , type(type)
+            , offset(0)
+            , getter(getter)
+            , setter(setter)
         { }
+
+        inline constexpr bool has_accessors() const { return getter != nullptr; }
     };
 
     /// Representation of a single-inheritance datastructure.
@@ -136,6 +136,14 @@ namespace engine
             CxxString = 0b0001'0100,
 
             Boolean = 0b0101,
+
+            /// Unit quaternion, whose components are named rather than stored in a fixed order.
+            ///
+            /// Applies to:
+            /// - Bits32
+            Quat = 0b0110,
+
+            Quat32 = Bits32 | Quat,
         };
 
         struct FieldType
@@ -0,0 +1,152 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <glm/glm.hpp>
+#include <limits>
+
+namespace engine
+{
+    /// Axis-aligned bounding box. A default-constructed box is empty, and expanding it yields the added bounds.
+    struct Aabb
+    {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+        inline bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+        inline glm::vec3 center() const { return (min + max) * 0.5f; }
+        inline glm::vec3 extent() const { return max - min; }
+
+        inline float surface_area() const
+        {
+            if (empty())
+                return 0.0f;
+
+            glm::vec3 e = extent();
+            return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+        }
+
+        inline void expand(const glm::vec3 &point)
+        {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        inline void expand(const Aabb &other)
+        {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        inline bool overlaps(const Aabb &other) const
+        {
+            return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+        }
+
+        inline bool contains(const glm::vec3 &point) const
+        {
+            return glm::all(glm::lessThanEqual(min, point)) && glm::all(glm::lessThanEqual(point, max));
+        }
+
+        /// Squared distance from a point to the box; zero inside it
+        inline float distance_squared(const glm::vec3 &point) const
+        {
+            glm::vec3 d = glm::max(glm::vec3(0.0f), glm::max(min - point, point - max));
+            return glm::dot(d, d);
+        }
+
+        /// Bounds of the box after an affine transform
+        inline Aabb transformed(const glm::mat4 &matrix) const
+        {
+            if (empty())
+                return *this;
+
+            glm::vec3 c = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+            glm::vec3 h = extent() * 0.5f;
+            glm::vec3 e = glm::abs(glm::vec3(matrix[0])) * h.x + glm::abs(glm::vec3(matrix[1])) * h.y
+                        + glm::abs(glm::vec3(matrix[2])) * h.z;
+
+            return Aabb {c - e, c + e};
+        }
+
+        bool operator==(const Aabb &) const = default;
+    };
+
+    struct Ray
+    {
+        glm::vec3 origin       = {0.0, 0.0, 0.0};
+        glm::vec3 direction    = {0.0, 1.0, 0.0};
+        float     max_distance = std::numeric_limits<float>::infinity();
+
+        /// Distance along the ray at which it enters the box, if it hits within `max_distance`.
+        ///
+        /// `inverse` is `1 / direction`, computed once per ray.
+        inline bool intersect(const Aabb &box, const glm::vec3 &inverse, float &distance) const
+        {
+            glm::vec3 t0 = (box.min - origin) * inverse;
+            glm::vec3 t1 = (box.max - origin) * inverse;
+
+            glm::vec3 near = glm::min(t0, t1);
+            glm::vec3 far  = glm::max(t0, t1);
+
+            float enter = std::max({near.x, near.y, near.z, 0.0f});
+            float exit  = std::min({far.x, far.y, far.z, max_distance});
+
+            distance = enter;
+            return enter <= exit;
+        }
+    };
+
+    /// Six planes bounding the volume seen by a camera, facing inwards
+    struct Frustum
+    {
+        /// Left, right, bottom, top, near, far, as `(normal, distance)`
+        std::array<glm::vec4, 6> planes = {};
+
+        /// Extract the planes from a view-projection matrix with a [0, 1] depth range
+        static inline Frustum from_matrix(const glm::mat4 &m)
+        {
+            glm::vec4 r0 = {m[0][0], m[1][0], m[2][0], m[3][0]};
+            glm::vec4 r1 = {m[0][1], m[1][1], m[2][1], m[3][1]};
+            glm::vec4 r2 = {m[0][2], m[1][2], m[2][2], m[3][2]};
+            glm::vec4 r3 = {m[0][3], m[1][3], m[2][3], m[3][3]};
+
+            Frustum frustum = {};
+            frustum.planes  = {r3 + r0, r3 - r0, r3 + r1, r3 - r1, r2, r3 - r2};
+
+            for (glm::vec4 &plane : frustum.planes)
+                plane /= glm::length(glm::vec3(plane));
+
+            return frustum;
+        }
+
+        enum class Containment
+        {
+            Outside,
+            Intersecting,
+            Inside,
+        };
+
+        inline Containment classify(const Aabb &box) const
+        {
+            Containment result = Containment::Inside;
+
+            for (const glm::vec4 &plane : planes) {
+                glm::vec3 normal = plane;
+
+                // Corners furthest along and against the plane's normal
+                glm::vec3 positive = glm::mix(box.min, box.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+                glm::vec3 negative = glm::mix(box.max, box.min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+                if (glm::dot(normal, positive) + plane.w < 0.0f)
+                    return Containment::Outside;
+                if (glm::dot(normal, negative) + plane.w < 0.0f)
+                    result = Containment::Intersecting;
+            }
+
+            return result;
+        }
+
+        inline bool intersects(const Aabb &box) const { return classify(box) != Containment::Outside; }
+    };
+} // namespace engine
@@ -0,0 +1,85 @@
+#pragma once
+#include "spatial_index.hpp"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace engine
+{
+    /// Bounding volume hierarchy built with binned surface area heuristic splits.
+    ///
+    /// `update` refits the node bounds of the leaves whose items moved, without changing the tree. Refitting keeps
+    /// queries correct, but their cost grows as items move far from where they were built, so callers should `build`
+    /// again once the tree has degraded; `quality` measures this.
+    class Bvh final : public SpatialIndex
+    {
+      public:
+        /// Number of bins used to evaluate split candidates along each axis
+        static constexpr uint32_t BIN_COUNT     = 16;
+        /// Largest number of items in a leaf
+        static constexpr uint32_t MAX_LEAF_SIZE = 8;
+
+        std::string_view name() const override;
+
+        void   build(std::span<const Aabb> bounds, JobSystem &jobs) override;
+        void   update(std::span<const Aabb> bounds, JobSystem &jobs) override;
+        size_t size() const noexcept override;
+
+        void                  query_frustum(const Frustum &frustum, std::vector<uint32_t> &out) const override;
+        void                  query_aabb(const Aabb &box, std::vector<uint32_t> &out) const override;
+        std::optional<RayHit> raycast(const Ray &ray) const override;
+        void query_nearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &out) const override;
+
+        /// Surface area heuristic cost of the tree relative to the cost when it was built; grows as refits degrade it
+        float  quality() const;
+        size_t node_count() const noexcept;
+
+        /// Smallest range of items split by a worker of its own
+        size_t parallel_threshold = 4096;
+
+      private:
+        struct Node
+        {
+            Aabb     bounds = {};
+            /// First child for internal nodes; the children are adjacent. First entry in `m_items` for leaves.
+            uint32_t first  = 0;
+            /// Number of items, zero for internal nodes
+            uint32_t count  = 0;
+            uint32_t parent = ~uint32_t(0);
+            uint32_t depth  = 0;
+        };
+
+        /// Items are partitioned along with their bounds, so that each split streams through memory
+        struct BuildItem
+        {
+            Aabb      bounds   = {};
+            glm::vec3 centroid = {};
+            uint32_t  item     = 0;
+        };
+
+        struct RangeBounds
+        {
+            Aabb bounds    = {};
+            Aabb centroids = {};
+        };
+
+        RangeBounds range_bounds(uint32_t begin, uint32_t end, JobSystem &jobs) const;
+        void        build_node(uint32_t node, uint32_t begin, uint32_t end, uint32_t depth, const RangeBounds &range,
+                               JobSystem &jobs);
+        float       cost() const;
+        void        collect(uint32_t node, std::vector<uint32_t> &out) const;
+
+        std::vector<Node>                  m_nodes      = {};
+        std::atomic<uint32_t>              m_node_count = 0;
+        /// Item indices, grouped by leaf
+        std::vector<uint32_t>              m_items      = {};
+        std::vector<uint32_t>              m_item_leaf  = {};
+        std::vector<Aabb>                  m_bounds     = {};
+        /// Items being partitioned, only kept during a build
+        std::vector<BuildItem>             m_build      = {};
+        std::vector<uint8_t>               m_dirty      = {};
+        /// Nodes grouped by depth, for bottom-up refits
+        std::vector<std::vector<uint32_t>> m_depths     = {};
+        float                              m_built_cost = 0.0f;
+    };
+} // namespace engine
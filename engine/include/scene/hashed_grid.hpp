@@ -0,0 +1,125 @@
+#pragma once
+#include "spatial_index.hpp"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace engine
+{
+    /// Loose uniform grid whose occupied cells are found through a hash table.
+    ///
+    /// Each item is stored in the one cell containing the center of its bounds, so inserting, moving and removing an
+    /// item takes constant time regardless of its size. Items may extend out of their cell; queries widen their search
+    /// by the largest half-extent seen since the last `build`. Suits scenes where most items move every frame, at the
+    /// cost of slower raycasts and nearest queries than a `Bvh` over sparse or unevenly sized items.
+    class HashedGrid final : public SpatialIndex
+    {
+      public:
+        /// Cells a few times larger than a typical item keep several items per cell, which are stored contiguously in
+        /// one pool shared by every cell
+        explicit HashedGrid(float cell_size = 8.0f);
+
+        std::string_view name() const override;
+
+        void   build(std::span<const Aabb> bounds, JobSystem &jobs) override;
+        void   update(std::span<const Aabb> bounds, JobSystem &jobs) override;
+        size_t size() const noexcept override;
+
+        void                  query_frustum(const Frustum &frustum, std::vector<uint32_t> &out) const override;
+        void                  query_aabb(const Aabb &box, std::vector<uint32_t> &out) const override;
+        std::optional<RayHit> raycast(const Ray &ray) const override;
+        void query_nearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &out) const override;
+
+        /// Add an item, returning its index
+        uint32_t insert(const Aabb &bounds);
+        /// Change the bounds of an item. Items with empty bounds are kept, but not found by queries.
+        void     move(uint32_t item, const Aabb &bounds);
+        /// Equivalent to moving the item to empty bounds; the index is not reused
+        void     remove(uint32_t item);
+
+        float  cell_size() const noexcept;
+        size_t cell_count() const noexcept;
+
+      private:
+        struct Entry
+        {
+            Aabb     bounds = {};
+            uint32_t item   = 0;
+        };
+
+        struct Cell
+        {
+            glm::ivec3 coord    = {};
+            /// Union of the bounds of the entries; only shrinks when the cell empties
+            Aabb       bounds   = {};
+            /// Range of `m_entries` reserved for the cell, of which the first `count` are used
+            uint32_t   first    = 0;
+            uint32_t   count    = 0;
+            uint32_t   capacity = 0;
+        };
+
+        struct Location
+        {
+            uint32_t cell = ~uint32_t(0);
+            /// Offset of the entry from the start of its cell's range
+            uint32_t slot = 0;
+        };
+
+        /// Open addressing hash table entry mapping packed cell coordinates to an index in `m_cells`
+        struct Slot
+        {
+            uint64_t key  = ~uint64_t(0);
+            uint32_t cell = 0;
+        };
+
+        glm::ivec3  cell_of(const glm::vec3 &point) const;
+        /// Bounds of the items whose cells are in `[low, high]`, without looking at the cells
+        Aabb        loose_bounds(const glm::ivec3 &low, const glm::ivec3 &high) const;
+        const Cell *find(const glm::ivec3 &coord) const;
+        /// Index of the cell at `coord`, adding it if it is not occupied
+        uint32_t    acquire_cell(const glm::ivec3 &coord);
+        /// Widen the margin and cell range since the last build to cover an item
+        void        track(const glm::ivec3 &coord, const Aabb &bounds);
+        void        insert_entry(uint32_t item, const Aabb &bounds);
+        void        remove_entry(uint32_t item);
+
+        std::span<const Entry> entries(const Cell &cell) const;
+        /// Move the cell's entries to a range twice as large at the end of the pool, unless it already ends the pool
+        void                   grow(Cell &cell);
+        /// Give back a range no cell uses, compacting the pool once most of it is unused
+        void                   release(uint32_t first, uint32_t capacity);
+        /// Pack the ranges of every cell at the start of the pool, in the order of the cells
+        void                   compact();
+
+        size_t home_slot(uint64_t key) const;
+        void   assign_slot(uint64_t key, uint32_t cell);
+        void   erase_slot(uint64_t key);
+        void   rehash(size_t capacity);
+
+        /// Call `visit` with every occupied cell in `[low, high]`
+        template<class Visit>
+        void visit_cells(glm::ivec3 low, glm::ivec3 high, Visit &&visit) const;
+        void visit_frustum(const Frustum &frustum, const glm::ivec3 &low, const glm::ivec3 &high, bool inside,
+                           std::vector<uint32_t> &out) const;
+
+        float m_cell_size    = 0.0f;
+        float m_inverse_cell = 0.0f;
+
+        /// Occupied cells, kept dense so that they can be scanned
+        std::vector<Cell>     m_cells     = {};
+        /// Entries of every cell, in one range per cell
+        std::vector<Entry>    m_entries   = {};
+        /// Entries of the pool in ranges released by cells
+        size_t                m_released  = 0;
+        /// Linearly probed, with a power of two size and at most half full
+        std::vector<Slot>     m_slots     = {};
+        uint32_t              m_shift     = 64;
+        std::vector<Location> m_locations = {};
+
+        /// Largest half-extent of any item since the last build
+        float      m_margin   = 0.0f;
+        /// Range of coordinates of occupied cells since the last build
+        glm::ivec3 m_min_cell = glm::ivec3(std::numeric_limits<int>::max());
+        glm::ivec3 m_max_cell = glm::ivec3(std::numeric_limits<int>::min());
+    };
+} // namespace engine
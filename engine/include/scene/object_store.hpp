@@ -0,0 +1,275 @@
+#pragma once
+#include "drawables/drawing_context.hpp"
+#include "object.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace engine
+{
+    namespace detail
+    {
+        /// Address unique to each type, identifying the type's bucket without RTTI
+        template<class T>
+        inline constexpr char OBJECT_TYPE_KEY = 0;
+
+        struct ObjectBucketBase
+        {
+            static constexpr uint32_t EMPTY = ~uint32_t(0);
+
+            /// Draw the queued objects, setting `context.occlusion_item` to their position, and clear the queue
+            virtual void draw_pending(DrawingContext &context) = 0;
+            /// Draw every visible object in storage order
+            virtual void draw_all(DrawingContext &context)     = 0;
+            virtual void erase(uint32_t slot)                  = 0;
+
+            virtual ~ObjectBucketBase() = default;
+
+            const void *type = nullptr;
+            /// Index in the store of the object in each slot, or `EMPTY`
+            std::vector<uint32_t> indices = {};
+            /// Empty slots, reused before the bucket grows
+            std::vector<uint32_t> free    = {};
+
+            struct Pending
+            {
+                uint32_t slot = 0;
+                uint32_t item = 0;
+            };
+
+            std::vector<Pending> pending = {};
+        };
+
+        /// Objects of type `T`, in chunks which never move
+        template<class T>
+        struct ObjectBucket final : ObjectBucketBase
+        {
+            static constexpr uint32_t CHUNK_SIZE = 256;
+
+            struct alignas(T) Storage
+            {
+                std::byte bytes[sizeof(T)];
+            };
+
+            std::vector<std::unique_ptr<Storage[]>> chunks = {};
+
+            T &at(uint32_t slot)
+            {
+                return *std::launder(reinterpret_cast<T *>(&chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]));
+            }
+
+            template<class... Args>
+            uint32_t emplace(uint32_t index, Args &&...args)
+            {
+                if (!free.empty()) {
+                    uint32_t slot = free.back();
+                    new (&chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]) T(std::forward<Args>(args)...);
+                    free.pop_back();
+                    indices[slot] = index;
+                    return slot;
+                }
+
+                uint32_t slot = uint32_t(indices.size());
+                if (slot / CHUNK_SIZE == chunks.size())
+                    chunks.push_back(std::make_unique_for_overwrite<Storage[]>(CHUNK_SIZE));
+
+                indices.push_back(index);
+                try {
+                    new (&chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]) T(std::forward<Args>(args)...);
+                } catch (...) {
+                    indices.pop_back();
+                    throw;
+                }
+                return slot;
+            }
+
+            void erase(uint32_t slot) override
+            {
+                at(slot).~T();
+                indices[slot] = EMPTY;
+                free.push_back(slot);
+            }
+
+            /// Draw an object with a qualified call, which the compiler can inline
+            static void draw(T &object, DrawingContext &context)
+            {
+                object.T::draw(context);
+            }
+
+            void draw_pending(DrawingContext &context) override
+            {
+                for (const Pending &item : pending) {
+                    T &object = at(item.slot);
+                    if (!object.transform.visible())
+                        continue;
+
+                    context.occlusion_item = item.item;
+                    draw(object, context);
+                }
+                pending.clear();
+            }
+
+            void draw_all(DrawingContext &context) override
+            {
+                for (uint32_t first = 0; first < indices.size(); first += CHUNK_SIZE) {
+                    T       *chunk = std::launder(reinterpret_cast<T *>(chunks[first / CHUNK_SIZE].get()));
+                    uint32_t count = std::min<uint32_t>(CHUNK_SIZE, uint32_t(indices.size()) - first);
+
+                    for (uint32_t i = 0; i < count; ++i)
+                        if (indices[first + i] != EMPTY && chunk[i].transform.visible())
+                            draw(chunk[i], context);
+                }
+            }
+
+            ~ObjectBucket() override
+            {
+                for (uint32_t slot = 0; slot < indices.size(); ++slot)
+                    if (indices[slot] != EMPTY)
+                        at(slot).~T();
+            }
+        };
+    } // namespace detail
+
+    /// Owns objects, storing those of each concrete type contiguously so that they are drawn without virtual calls.
+    ///
+    /// Objects of one type live in a bucket of fixed size chunks, so they never move, and references to them stay
+    /// valid until they are erased. Drawing a set of objects sorts them by bucket and runs one loop per bucket, which
+    /// calls the type's `draw` directly.
+    ///
+    /// Objects are also numbered densely from zero, for code which indexes them such as spatial indices and editors.
+    /// Erasing an object gives its index to the last object.
+    class ObjectStore final
+    {
+      public:
+        /// Refers to an object until it is erased, unlike its index
+        struct Key
+        {
+            uint32_t bucket = 0;
+            uint32_t slot   = 0;
+        };
+
+        /// Construct an object in the bucket of its type. It takes the index `size()`.
+        template<std::derived_from<Object> T, class... Args>
+        T &emplace(Args &&...args);
+        /// Destroy the object at `index`, giving the index to the last object
+        void erase(uint32_t index);
+        void clear();
+
+        size_t   size() const noexcept;
+        bool     empty() const noexcept;
+        /// Changes whenever an object is added or removed
+        uint64_t version() const noexcept;
+
+        Object       &operator[](uint32_t index) noexcept;
+        const Object &operator[](uint32_t index) const noexcept;
+
+        Key      key(uint32_t index) const noexcept;
+        uint32_t index(Key key) const noexcept;
+
+        /// Call `fn` on each object of type `T`, in storage order
+        template<std::derived_from<Object> T, class Fn>
+        void for_each(Fn &&fn);
+
+        /// Draw every visible object, one type at a time
+        void draw(DrawingContext &context);
+        /// Draw the visible objects at `indices`, one type at a time, in the order of `indices` within a type.
+        ///
+        /// `context.occlusion_item` is set to the position in `indices` of each object drawn.
+        void draw(DrawingContext &context, std::span<const uint32_t> indices);
+
+        ObjectStore();
+        ~ObjectStore();
+
+        ObjectStore(const ObjectStore &)            = delete;
+        ObjectStore &operator=(const ObjectStore &) = delete;
+
+      private:
+        struct Entry
+        {
+            Object  *object = nullptr;
+            uint32_t bucket = 0;
+            uint32_t slot   = 0;
+        };
+
+        /// Find the bucket of `T`, creating it on first use
+        template<class T>
+        uint32_t bucket_of();
+
+        std::vector<std::unique_ptr<detail::ObjectBucketBase>> m_buckets = {};
+        std::vector<Entry>                                     m_objects = {};
+        uint64_t                                               m_version = 0;
+    };
+
+    template<std::derived_from<Object> T, class... Args>
+    T &ObjectStore::emplace(Args &&...args)
+    {
+        uint32_t bucket_index = bucket_of<T>();
+        auto    &bucket       = static_cast<detail::ObjectBucket<T> &>(*m_buckets[bucket_index]);
+
+        uint32_t index = uint32_t(m_objects.size());
+        m_objects.push_back(Entry {.bucket = bucket_index});
+
+        try {
+            uint32_t slot   = bucket.emplace(index, std::forward<Args>(args)...);
+            T       &object = bucket.at(slot);
+
+            m_objects[index].object = &object;
+            m_objects[index].slot   = slot;
+            ++m_version;
+            return object;
+        } catch (...) {
+            m_objects.pop_back();
+            throw;
+        }
+    }
+
+    template<std::derived_from<Object> T, class Fn>
+    void ObjectStore::for_each(Fn &&fn)
+    {
+        for (auto &base : m_buckets) {
+            if (base->type != &detail::OBJECT_TYPE_KEY<T>)
+                continue;
+
+            auto &bucket = static_cast<detail::ObjectBucket<T> &>(*base);
+            for (uint32_t slot = 0; slot < bucket.indices.size(); ++slot)
+                if (bucket.indices[slot] != detail::ObjectBucketBase::EMPTY)
+                    fn(bucket.at(slot));
+            return;
+        }
+    }
+
+    template<class T>
+    uint32_t ObjectStore::bucket_of()
+    {
+        for (uint32_t i = 0; i < m_buckets.size(); ++i)
+            if (m_buckets[i]->type == &detail::OBJECT_TYPE_KEY<T>)
+                return i;
+
+        auto bucket  = std::make_unique<detail::ObjectBucket<T>>();
+        bucket->type = &detail::OBJECT_TYPE_KEY<T>;
+        m_buckets.push_back(std::move(bucket));
+        return uint32_t(m_buckets.size() - 1);
+    }
+
+    struct ObjectStoreBenchmark
+    {
+        size_t count        = 0;
+        /// Time to draw every object of a `std::vector<std::shared_ptr<Object>>` through virtual calls
+        double pointer_ms   = 0.0;
+        /// As `pointer_ms`, copying each pointer as the loop visits it
+        double copy_ms      = 0.0;
+        /// Time to draw every object of an `ObjectStore`
+        double store_ms     = 0.0;
+        /// Time to draw every object of an `ObjectStore` by index, as the objects left by culling are drawn
+        double store_set_ms = 0.0;
+    };
+
+    /// Time drawing `count` trivial objects held by shared pointers against the same objects in an `ObjectStore`.
+    ObjectStoreBenchmark benchmark_object_store(size_t count);
+} // namespace engine
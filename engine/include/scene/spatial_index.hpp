@@ -0,0 +1,67 @@
+#pragma once
+#include "bounds.hpp"
+#include "jobs/job_system.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace engine
+{
+    struct RayHit
+    {
+        /// Index of the item in the bounds given to `build`
+        uint32_t item     = 0;
+        /// Distance along the ray at which it enters the item's bounds
+        float    distance = 0.0f;
+    };
+
+    /// Spatial acceleration structure over a set of bounding boxes.
+    ///
+    /// Items are identified by their index in the bounds given to `build`. Queries append the items they find to `out`,
+    /// in no particular order.
+    class SpatialIndex
+    {
+      public:
+        virtual ~SpatialIndex() = default;
+
+        /// Name of the kind of index; refers to static storage
+        virtual std::string_view name() const = 0;
+
+        /// Replace the indexed items.
+        virtual void build(std::span<const Aabb> bounds, JobSystem &jobs) = 0;
+        /// Move the items given to the last `build`. `bounds` must have as many elements.
+        virtual void update(std::span<const Aabb> bounds, JobSystem &jobs) = 0;
+        /// Number of indexed items
+        virtual size_t size() const noexcept = 0;
+
+        /// Items whose bounds intersect the frustum
+        virtual void query_frustum(const Frustum &frustum, std::vector<uint32_t> &out) const = 0;
+        /// Items whose bounds overlap the box
+        virtual void query_aabb(const Aabb &box, std::vector<uint32_t> &out) const = 0;
+        /// Closest item whose bounds the ray enters
+        virtual std::optional<RayHit> raycast(const Ray &ray) const = 0;
+        /// Up to `k` items whose bounds are closest to `point`, nearest first
+        virtual void query_nearest(const glm::vec3 &point, size_t k, std::vector<uint32_t> &out) const = 0;
+    };
+
+    struct SpatialBenchmark
+    {
+        std::string_view index        = {};
+        size_t           count        = 0;
+        double           build_ms     = 0.0;
+        /// Time to move a tenth of the items
+        double           update_ms    = 0.0;
+        /// Time per query, averaged over a batch of queries
+        double           frustum_us   = 0.0;
+        double           aabb_us      = 0.0;
+        double           raycast_us   = 0.0;
+        double           nearest_us   = 0.0;
+        /// Items found per frustum query
+        size_t           frustum_hits = 0;
+    };
+
+    /// Time building, updating and querying an index over `count` random boxes.
+    SpatialBenchmark benchmark_spatial_index(SpatialIndex &index, size_t count, JobSystem &jobs);
+} // namespace engine
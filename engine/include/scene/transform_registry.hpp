@@ -0,0 +1,203 @@
+#pragma once
+#include "transform.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <span>
+#include <vector>
+
+namespace engine
+{
+    /// Identifies a transform in a `TransformRegistry`. IDs of destroyed entities are reused.
+    using Entity = uint32_t;
+
+    constexpr Entity NULL_ENTITY = ~Entity(0);
+
+    enum class TransformFlags : uint8_t
+    {
+        None         = 0,
+        /// The object is drawn
+        Visible      = 1 << 0,
+        /// Location, rotation or scale changed since the last transform pass
+        LocalDirty   = 1 << 1,
+        /// The parent changed since the last transform pass
+        WorldDirty   = 1 << 2,
+        /// The world matrix was recomputed by the last transform pass
+        WorldChanged = 1 << 3,
+
+        /// Bits maintained by the registry and the transform pass
+        Internal = LocalDirty | WorldDirty | WorldChanged,
+    };
+
+    inline constexpr bool operator!(TransformFlags value)
+    {
+        return uint8_t(value) == 0;
+    }
+
+    inline constexpr TransformFlags operator|(TransformFlags l, TransformFlags r)
+    {
+        return TransformFlags(uint8_t(l) | uint8_t(r));
+    }
+
+    inline constexpr TransformFlags &operator|=(TransformFlags &l, TransformFlags r)
+    {
+        return l = l | r;
+    }
+
+    inline constexpr TransformFlags operator&(TransformFlags l, TransformFlags r)
+    {
+        return TransformFlags(uint8_t(l) & uint8_t(r));
+    }
+
+    inline constexpr TransformFlags &operator&=(TransformFlags &l, TransformFlags r)
+    {
+        return l = l & r;
+    }
+
+    inline constexpr TransformFlags operator~(TransformFlags value)
+    {
+        return TransformFlags(~uint8_t(value));
+    }
+
+    /// Stores transforms as parallel dense arrays, indexed through a sparse set.
+    ///
+    /// Entities map to a position in the dense arrays through a sparse array. `sort` orders the dense arrays by depth
+    /// in the hierarchy, so that a transform pass can walk each depth level as one contiguous range.
+    ///
+    /// Setters mark the transform dirty, so that the transform pass only recomputes matrices which changed.
+    ///
+    /// Rotations are stored as unit quaternions. The Euler accessors convert, and exist for editing.
+    class TransformRegistry final
+    {
+      public:
+        static constexpr uint32_t NO_INDEX = ~uint32_t(0);
+
+        Entity create();
+        /// Destroy an entity. Its children become roots.
+        void   destroy(Entity entity);
+        bool   contains(Entity entity) const noexcept;
+        size_t size() const noexcept;
+
+        /// Set the parent of an entity; `NULL_ENTITY` makes it a root.
+        void   set_parent(Entity entity, Entity parent);
+        Entity parent(Entity entity) const;
+
+        glm::vec3      location(Entity entity) const;
+        /// Euler angles equivalent to the orientation
+        glm::vec3      rotation(Entity entity) const;
+        glm::quat      orientation(Entity entity) const;
+        glm::vec3      scale(Entity entity) const;
+        TransformFlags flags(Entity entity) const;
+        /// World matrix as of the last transform pass
+        glm::mat4      world(Entity entity) const;
+        /// Number of transform passes which changed the world matrix, counted for each entity alone, so that it only
+        /// changes with the entity's own matrix. Zero until the first pass.
+        uint64_t       version(Entity entity) const;
+
+        void set_location(Entity entity, const glm::vec3 &location);
+        /// Set the orientation from Euler angles, as in `Transform`
+        void set_rotation(Entity entity, const glm::vec3 &rotation);
+        /// Set the orientation. The quaternion is normalized.
+        void set_orientation(Entity entity, const glm::quat &orientation);
+        void set_scale(Entity entity, const glm::vec3 &scale);
+        /// Set the flags of an entity. The internal bits are left untouched.
+        void set_flags(Entity entity, TransformFlags flags);
+
+        /// Order the dense arrays by depth if the hierarchy changed since the last call.
+        void sort();
+
+        // Dense arrays, in the order established by `sort`
+
+        std::span<const Entity>         entities() const noexcept;
+        std::span<const glm::vec3>      locations() const noexcept;
+        std::span<const glm::quat>      orientations() const noexcept;
+        std::span<const glm::vec3>      scales() const noexcept;
+        std::span<TransformFlags>       flags() noexcept;
+        /// Dense index of each entity's parent, or `NO_INDEX`
+        std::span<const uint32_t>       parent_indices() const noexcept;
+        std::span<glm::mat4>            local_matrices() noexcept;
+        std::span<glm::mat4>            world_matrices() noexcept;
+        std::span<uint64_t>             versions() noexcept;
+        /// Start of each depth level, followed by the number of entities
+        std::span<const size_t>         levels() const noexcept;
+
+      private:
+        uint32_t index(Entity entity) const;
+
+        std::vector<uint32_t>       m_sparse       = {};
+        /// Number of children of each entity, indexed by entity, so that destroying a leaf skips looking for children
+        std::vector<uint32_t>       m_children     = {};
+        std::vector<Entity>         m_free         = {};
+        std::vector<Entity>         m_entities     = {};
+        std::vector<glm::vec3>      m_locations    = {};
+        std::vector<glm::quat>      m_orientations = {};
+        std::vector<glm::vec3>      m_scales       = {};
+        std::vector<TransformFlags> m_flags        = {};
+        std::vector<Entity>         m_parents      = {};
+        std::vector<uint32_t>       m_parent_ix    = {};
+        std::vector<glm::mat4>      m_local        = {};
+        std::vector<glm::mat4>      m_world        = {};
+        std::vector<uint64_t>       m_versions     = {};
+        std::vector<size_t>         m_levels       = {};
+        bool                        m_unsorted     = false;
+    };
+
+    /// View of a single transform in a `TransformRegistry`.
+    ///
+    /// Values are returned by copy, since the dense arrays move when the registry changes.
+    class TransformRef
+    {
+      public:
+        TransformRef() = default;
+
+        inline TransformRef(TransformRegistry &registry, Entity entity)
+            : m_registry(&registry)
+            , m_entity(entity)
+        { }
+
+        inline Entity             entity() const noexcept { return m_entity; }
+        inline TransformRegistry &registry() const noexcept { return *m_registry; }
+
+        inline glm::vec3 location() const { return m_registry->location(m_entity); }
+        inline glm::vec3 rotation() const { return m_registry->rotation(m_entity); }
+        inline glm::quat orientation() const { return m_registry->orientation(m_entity); }
+        inline glm::vec3 scale() const { return m_registry->scale(m_entity); }
+        inline glm::mat4 world() const { return m_registry->world(m_entity); }
+        inline uint64_t  version() const { return m_registry->version(m_entity); }
+
+        inline void set_location(const glm::vec3 &location) { m_registry->set_location(m_entity, location); }
+        inline void set_rotation(const glm::vec3 &rotation) { m_registry->set_rotation(m_entity, rotation); }
+        inline void set_orientation(const glm::quat &orientation)
+        {
+            m_registry->set_orientation(m_entity, orientation);
+        }
+        inline void set_scale(const glm::vec3 &scale) { m_registry->set_scale(m_entity, scale); }
+
+        inline bool visible() const { return !!(m_registry->flags(m_entity) & TransformFlags::Visible); }
+
+        inline void set_visible(bool visible)
+        {
+            TransformFlags flags = m_registry->flags(m_entity) & ~TransformFlags::Visible;
+            m_registry->set_flags(m_entity, visible ? flags | TransformFlags::Visible : flags);
+        }
+
+        inline void set_parent(TransformRef parent) { m_registry->set_parent(m_entity, parent.m_entity); }
+        inline void clear_parent() { m_registry->set_parent(m_entity, NULL_ENTITY); }
+
+        /// Copy of the local transform
+        inline QuatTransform get() const { return QuatTransform {location(), orientation(), scale()}; }
+
+        inline void set(const QuatTransform &transform)
+        {
+            set_location(transform.location);
+            set_orientation(transform.orientation);
+            set_scale(transform.scale);
+        }
+
+        inline void set(const Transform &transform) { set(QuatTransform(transform)); }
+
+      private:
+        TransformRegistry *m_registry = nullptr;
+        Entity             m_entity   = NULL_ENTITY;
+    };
+} // namespace engine
@@ -0,0 +1,34 @@
+#pragma once
+#include "jobs/job_system.hpp"
+#include "math/trs_kernel.hpp"
+#include "transform_registry.hpp"
+#include <atomic>
+
+namespace engine
+{
+    /// Computes the world matrices of every transform in a registry.
+    ///
+    /// The registry's dense arrays are sorted by depth, so each depth level is a contiguous range which is updated in
+    /// parallel once the level above it is done. Run `update` before recording, so that drawing only reads world
+    /// matrices.
+    ///
+    /// Only dirty local matrices are rebuilt, in batches by `math::compose_transforms`, and world matrices are only
+    /// recomputed when the local matrix or an ancestor's world matrix changed.
+    class TransformSystem final
+    {
+      public:
+        /// Recompute the world matrices which changed.
+        void update(TransformRegistry &registry, JobSystem &jobs);
+
+        /// Number of world matrices recomputed by the last update
+        size_t updated() const noexcept;
+
+        /// Smallest number of transforms handed to a worker at once
+        size_t          batch_size = 256;
+        /// Widest instruction set used to build local matrices
+        math::SimdLevel simd_level = math::detect_simd_level();
+
+      private:
+        std::atomic<size_t> m_updated = 0;
+    };
+} // namespace engine
@@ -0,0 +1,188 @@
+#pragma once
+#include "assets/asset_manager.hpp"
+#include "backend/timeline.hpp"
+#include "jobs/job_system.hpp"
+#include "scene/object_store.hpp"
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <glm/glm.hpp>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace engine
+{
+    /// Coordinates of a cell of a `WorldPartition`. Cells divide the XY plane, and span all heights.
+    struct CellCoord
+    {
+        int32_t x = 0;
+        int32_t y = 0;
+
+        auto operator<=>(const CellCoord &) const = default;
+    };
+
+    /// Object as stored in a cell file: its type, and the text of its reflected fields by name
+    struct ObjectRecord
+    {
+        std::string                                      type   = {};
+        std::vector<std::pair<std::string, std::string>> fields = {};
+    };
+
+    /// Contents of a cell file
+    struct CellData
+    {
+        CellCoord                 coord   = {};
+        /// Paths of the meshes the cell's objects use, kept loaded while the cell is
+        std::vector<std::string>  meshes  = {};
+        std::vector<ObjectRecord> objects = {};
+    };
+
+    /// Read a cell file.
+    ///
+    /// Cell files are text. A `cell <x> <y>` line gives the cell's coordinates, and each `mesh <path>` line an asset
+    /// it references. Objects start with an `object <type>` line, followed by one `<field> <value>` line per field,
+    /// and end with an `end` line. Vectors are written as their components separated by spaces, and booleans as
+    /// `true` or `false`. Lines starting with `#` are ignored.
+    CellData read_cell(const std::filesystem::path &path);
+    void     write_cell(const std::filesystem::path &path, const CellData &cell);
+
+    /// Streams the objects of a world divided into cells, keeping the cells around the camera loaded.
+    ///
+    /// Each cell is a file named `<x>_<y>.cell` in the world's directory. Cells are read on the job system and their
+    /// objects created by `update`, nearest first, as long as the memory used by the loaded cells fits the budget.
+    /// Cells which fall out of range or out of the budget are unloaded: their objects are hidden at once, and destroyed
+    /// once no frame in flight can still draw them.
+    class WorldPartition final
+    {
+      public:
+        enum class CellState : uint8_t
+        {
+            Unloaded,
+            /// Being read by a worker
+            Loading,
+            Loaded,
+            /// Objects are hidden and waiting to be destroyed
+            Unloading,
+        };
+
+        struct Statistics
+        {
+            uint32_t cells     = 0;
+            uint32_t loaded    = 0;
+            uint32_t loading   = 0;
+            uint32_t unloading = 0;
+            /// Objects created by loaded cells
+            size_t   objects   = 0;
+            /// Memory used by loaded cells, as counted against the budget
+            size_t   bytes     = 0;
+        };
+
+        /// Find the cells in `directory`, whose sides are `cell_size` long. Objects of unloaded cells are destroyed
+        /// once `timeline` shows that the frames which may draw them have finished.
+        WorldPartition(std::filesystem::path directory, float cell_size, ObjectStore &objects,
+                       TransformRegistry &registry, AssetManager &assets, JobSystem &jobs, Timeline &timeline);
+        ~WorldPartition();
+
+        /// Create objects of type `T` for the objects of type `name` in cell files.
+        ///
+        /// `T` is constructed from the transform registry and the asset manager, then its reflected fields are set.
+        template<std::derived_from<Object> T>
+        void register_type(std::string_view name);
+
+        /// Load and unload cells for a camera at `camera`. Must be called once per frame, from the thread which owns
+        /// the object store.
+        void update(const glm::vec3 &camera);
+
+        CellCoord  cell_of(const glm::vec3 &location) const noexcept;
+        Statistics statistics() const noexcept;
+
+        /// Cells closer than this to the camera are loaded, if the budget allows
+        float    load_radius          = 64.0f;
+        /// Loaded cells are only unloaded once further than this, so that they do not thrash at the load radius
+        float    unload_radius        = 80.0f;
+        /// Bytes of objects, their assets and meshes kept loaded at most. The camera's nearest cell is always loaded.
+        size_t   memory_budget        = 256 * 1024 * 1024;
+        /// Maximum number of cells being read at any time
+        uint32_t max_concurrent_loads = 2;
+
+        WorldPartition(const WorldPartition &)            = delete;
+        WorldPartition &operator=(const WorldPartition &) = delete;
+
+      private:
+        using Create = Object &(*)(ObjectStore &objects, TransformRegistry &registry, AssetManager &assets);
+
+        struct Factory
+        {
+            Create create = nullptr;
+            size_t size   = 0;
+        };
+
+        struct Cell
+        {
+            CellCoord             coord        = {};
+            std::filesystem::path path         = {};
+            CellState             state        = CellState::Unloaded;
+            /// Kept or made resident by the last update
+            bool                  wanted       = false;
+            /// Reading the cell failed; it is not tried again
+            bool                  failed       = false;
+            /// Memory counted against the budget while the cell is not loaded. Estimated from the file's size until
+            /// the cell is first loaded, then measured as it is unloaded.
+            size_t                bytes        = 0;
+            /// Memory of the objects created by the cell
+            size_t                object_bytes = 0;
+            /// Timeline value of the last submission which may draw the objects of an unloading cell
+            uint64_t              retire       = 0;
+            std::future<CellData> loading      = {};
+
+            std::vector<ObjectStore::Key> objects = {};
+            std::vector<MeshHandle>       meshes  = {};
+        };
+
+        /// Memory counted against the budget for a cell: its objects, the assets they loaded, and its meshes
+        size_t cost(const Cell &cell) const;
+
+        /// Distance from `camera` to the nearest point of a cell, on the XY plane
+        float distance(const Cell &cell, const glm::vec3 &camera) const noexcept;
+
+        void finish_loads(const glm::vec3 &camera);
+        void finish_unloads();
+        void begin_load(Cell &cell);
+        void begin_unload(Cell &cell);
+        /// Create the objects of a cell read by a worker, `distance` away from the camera
+        void instantiate(Cell &cell, const CellData &data, float distance);
+
+        std::shared_ptr<spdlog::logger> m_logger    = {};
+        std::filesystem::path           m_directory = {};
+        float                           m_cell_size = 0.0f;
+        ObjectStore                    *m_objects   = nullptr;
+        TransformRegistry              *m_registry  = nullptr;
+        AssetManager                   *m_assets    = nullptr;
+        JobSystem                      *m_jobs      = nullptr;
+        Timeline                       *m_timeline  = nullptr;
+
+        std::unordered_map<std::string, Factory> m_factories = {};
+        std::vector<Cell>                        m_cells     = {};
+        /// Candidate cells of the last update, by distance
+        std::vector<std::pair<float, uint32_t>>  m_ranked    = {};
+        uint32_t                                 m_loading   = 0;
+    };
+
+    template<std::derived_from<Object> T>
+    void WorldPartition::register_type(std::string_view name)
+    {
+        m_factories[std::string(name)] = Factory {
+            .create = [](ObjectStore &objects, TransformRegistry &registry, AssetManager &assets) -> Object & {
+                return objects.emplace<T>(registry, assets);
+            },
+            .size = sizeof(T),
+        };
+    }
+} // namespace engine
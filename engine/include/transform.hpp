@@ -2,6 +2,7 @@
 #include "constants.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 inline constexpr double operator"" _deg(long double value)
 {
@@ -37,6 +38,72 @@ namespace engine
         inline operator glm::mat4() const { return get_transform_matrix(); }
     };
 
+    /// Orientation equivalent to the Euler angles of a `Transform`: yaw about Y, then pitch about X, then roll about Z
+    inline glm::quat euler_to_quat(const glm::vec3 &rotation)
+    {
+        return glm::angleAxis(rotation.x, Y_AXIS) * glm::angleAxis(rotation.y, X_AXIS)
+             * glm::angleAxis(rotation.z, Z_AXIS);
+    }
+
+    /// Euler angles of a `Transform` equivalent to a unit quaternion.
+    ///
+    /// Pitch is kept in [-90, 90] degrees. At +/-90 degrees, where yaw and roll rotate about the same axis, roll is 0.
+    inline glm::vec3 quat_to_euler(const glm::quat &orientation)
+    {
+        glm::mat3 m = glm::mat3_cast(orientation);
+
+        // `m[column][row]`: the third column is (sin(yaw) cos(pitch), -sin(pitch), cos(yaw) cos(pitch))
+        float cos_pitch = glm::sqrt(m[2][0] * m[2][0] + m[2][2] * m[2][2]);
+        float pitch     = glm::atan(-m[2][1], cos_pitch);
+
+        if (cos_pitch > 1e-6f)
+            return {glm::atan(m[2][0], m[2][2]), pitch, glm::atan(m[0][1], m[1][1])};
+        else
+            return {glm::atan(-m[0][2], m[0][0]), pitch, 0.0f};
+    }
+
+    /// Transform storing its rotation as a unit quaternion.
+    ///
+    /// The rotation matrix is built directly from the quaternion, without trigonometry, and orientations can be
+    /// interpolated with `glm::slerp`.
+    struct QuatTransform
+    {
+        glm::vec3 location    = {0.0, 0.0, 0.0};
+        glm::quat orientation = {1.0, 0.0, 0.0, 0.0};
+        glm::vec3 scale       = {1.0, 1.0, 1.0};
+
+        QuatTransform() = default;
+
+        inline QuatTransform(const glm::vec3 &location, const glm::quat &orientation, const glm::vec3 &scale)
+            : location(location)
+            , orientation(orientation)
+            , scale(scale)
+        { }
+
+        inline explicit QuatTransform(const Transform &transform)
+            : location(transform.location)
+            , orientation(euler_to_quat(transform.rotation))
+            , scale(transform.scale)
+        { }
+
+        /// Euler view of the transform, for editing
+        inline Transform to_euler() const { return Transform {location, quat_to_euler(orientation), scale}; }
+
+        inline glm::mat4 get_transform_matrix() const
+        {
+            glm::mat3 rotation = glm::mat3_cast(orientation);
+
+            return glm::mat4 {
+                glm::vec4(rotation[0] * scale.x, 0.0f),
+                glm::vec4(rotation[1] * scale.y, 0.0f),
+                glm::vec4(rotation[2] * scale.z, 0.0f),
+                glm::vec4(location, 1.0f),
+            };
+        }
+
+        inline operator glm::mat4() const { return get_transform_matrix(); }
+    };
+
     struct CameraTransform
     {
         glm::vec3 location = {0.0, 0.0, 0.0};
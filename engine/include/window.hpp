@@ -2,6 +2,8 @@
 #include "version.hpp"
 
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <functional>
 #include <glm/glm.hpp>
 #include <memory>
 #include <spdlog/spdlog.h>
@@ -11,7 +13,10 @@
 #include "input/keyboard.hpp"
 #include "input/mouse.hpp"
 
+#include "backend/present_policy.hpp"
+#include "frame_pacer.hpp"
 #include "gui/imgui_manager.hpp"
+#include "jobs/job_system.hpp"
 
 #ifdef VULKAN_HPP
 #    include "backend/vulkan_backend.hpp"
@@ -19,6 +24,16 @@
 
 namespace engine
 {
+    /// How a window throttles its frames while it cannot be seen or is not being used. Simulation keeps running at
+    /// its own rate either way.
+    struct ThrottlePolicy
+    {
+        /// Stop drawing while the window is minimised, hidden or has an empty framebuffer
+        bool   pause_hidden   = true;
+        /// Frames per second at most while the window does not have focus, or 0 for no cap
+        double unfocused_rate = 30.0;
+    };
+
     /**
      * @brief Base class for all windows.
      *
@@ -26,6 +41,8 @@ namespace engine
      */
     class Window
     {
+        friend class WindowGroup;
+
       public:
         /// Create a new window, creating new instance and device configurations.
         Window(std::string_view title, int32_t width, int32_t height, std::string_view application_name = "app_runtime",
@@ -46,8 +63,27 @@ namespace engine
         inline void update_view(const glm::mat4 &mat) { m_backend->update_view(mat); }
         inline void update_fov(float fov) { m_backend->update_fov(fov); }
 
-        class VulkanBackend &get_render_backend();
+        /// Switch how frames are presented. Takes effect once the current frame is submitted.
+        void          set_present_policy(PresentPolicy policy);
+        PresentPolicy present_policy() const;
 
+        class VulkanBackend &get_render_backend();
+        class AssetManager  &get_asset_manager();
+        JobSystem           &get_job_system();
+        /// Pacer holding the window's frame rate limit and latency setting, which a `WindowGroup` also follows
+        FramePacer          &get_frame_pacer();
+        /// Pacer timing the window's frames: that of its group while in one, otherwise its own
+        const FramePacer    &active_frame_pacer() const;
+
+        /// Draw at least the next `frames` frames when rendering on demand.
+        ///
+        /// Input invalidates frames by itself. Call this when the scene changes otherwise, such as when an object
+        /// moves, and from `process` for every frame an animation advances.
+        void invalidate(uint32_t frames = 1);
+
+        /// Record the window's draw commands.
+        ///
+        /// When run as part of a `WindowGroup`, this may run on a worker thread, concurrently with other windows.
         virtual void handle_draw(struct DrawingContext &context) = 0;
 
         virtual void on_key_action(KeyboardKey key, ModifierKey modifiers, KeyAction action, int scancode);
@@ -60,6 +96,19 @@ namespace engine
 
         void run(double pproc_freq = 20.0);
 
+        bool should_close() const;
+
+        /// Only draw frames which have been invalidated, waiting for events in between rather than polling for them.
+        ///
+        /// Frames are drawn after input, after `invalidate`, while an ImGui item is active and while assets load.
+        /// `process` and `physics_process` keep running while idle, waking at least for every physics tick.
+        bool           render_on_demand = false;
+        ThrottlePolicy throttle         = {};
+
+        /// The window is minimised, hidden or has an empty framebuffer
+        bool hidden() const;
+        bool focused() const noexcept;
+
         virtual ~Window();
 
         // No copying
@@ -78,7 +127,47 @@ namespace engine
 
       private:
         std::shared_ptr<spdlog::logger>      m_logger;
-        std::unique_ptr<class VulkanBackend> m_backend = {};
+        JobSystem::Shared                    m_job_system    = {};
+        std::unique_ptr<class VulkanBackend> m_backend       = {};
+        std::unique_ptr<class AssetManager>  m_asset_manager = {};
+
+        std::chrono::steady_clock::time_point m_creation_time  = {};
+        std::chrono::steady_clock::time_point m_last_draw      = {};
+        std::chrono::steady_clock::time_point m_next_physics   = {};
+        std::chrono::duration<double>         m_physics_period = {};
+        bool                                  m_first_frame    = true;
+        FramePacer                            m_pacer          = {};
+        /// Pacer of the group the window is in, if any
+        const FramePacer                     *m_group_pacer    = nullptr;
+        /// Frames left to draw when rendering on demand
+        uint32_t                              m_redraw_frames  = 0;
+        /// Earliest start of the next frame under the window's own frame period, when run in a group
+        std::chrono::steady_clock::time_point m_next_frame     = {};
+
+        bool m_focused           = true;
+        bool m_iconified         = false;
+        bool m_framebuffer_empty = false;
+
+        /// Initialize ImGui's renderer as part of the backend's startup. Its context must already exist.
+        std::function<void(class VulkanBackend &)> imgui_startup();
+
+        /// Reset the frame timers before entering a loop
+        void start_loop(double pproc_freq);
+        /// Run the per-frame processing which precedes drawing
+        void update_frame();
+        void log_first_frame();
+        /// A frame must be drawn, since rendering is continuous or something invalidated it, and the window is not
+        /// paused by its throttle policy
+        bool wants_frame();
+        /// The window's own frame period allows a frame starting at `now`, give or take `slack`
+        bool frame_due(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration slack) const;
+        /// Seconds until the next physics tick, the longest an idle loop waits for events
+        double idle_timeout() const;
+        /// Account for a frame started at `start` having been submitted
+        void frame_submitted(std::chrono::steady_clock::time_point start);
+        /// Time between frames under the lowest of the frame rate limit, the present policy's cap and the throttle
+        /// policy's cap while unfocused, or zero if none of them applies
+        std::chrono::steady_clock::duration frame_period() const;
 
         void set_glfw_callbacks();
 
@@ -87,5 +176,8 @@ namespace engine
         static void cursor_pos_callback(GLFWwindow *, double xpos, double ypos);
         static void framebuffer_resize_callback(GLFWwindow *, int width, int height);
         static void scroll_callback(GLFWwindow *, double xoff, double yoff);
+        static void refresh_callback(GLFWwindow *);
+        static void focus_callback(GLFWwindow *, int focused);
+        static void iconify_callback(GLFWwindow *, int iconified);
     };
 } // namespace engine
@@ -0,0 +1,50 @@
+#pragma once
+#include "window.hpp"
+#include <chrono>
+#include <initializer_list>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace engine
+{
+    /// Runs several windows sharing one device from a single loop.
+    ///
+    /// Events are polled once per frame and every window's scene is recorded in parallel on the job system. All frames
+    /// are then submitted with one queue submission and presented with one present call.
+    class WindowGroup final
+    {
+      public:
+        WindowGroup(std::initializer_list<Window *> windows = {});
+        ~WindowGroup();
+
+        /// Add a window. It must share its device with the other windows in the group.
+        void add(Window &window);
+
+        /// Run every window until all of them are closed. Closed windows are hidden and leave the group.
+        ///
+        /// Frames are paced to the highest frame rate allowed by the windows' limits and present policies, and are not
+        /// paced if any window is unlimited. Windows capped below that rate, such as unfocused ones, skip frames until
+        /// their own period has passed. Windows rendering on demand or paused by their throttle policy only draw the
+        /// frames they want, and the group waits for events while none of them wants one. Latency is reduced if any
+        /// window's pacer asks for it.
+        void run(double pproc_freq = 20.0);
+
+        // Windows refer to the group's pacer
+        WindowGroup(const WindowGroup &)            = delete;
+        WindowGroup &operator=(const WindowGroup &) = delete;
+
+      private:
+        /// Remove closed windows, returning `true` if any were removed
+        bool remove_closed();
+
+        /// Shortest time between frames allowed by the windows, or zero if one of them is unlimited
+        std::chrono::steady_clock::duration frame_period() const;
+        /// Stop `window` from reporting the group's pacer as its own
+        void                                leave(Window &window);
+
+        std::shared_ptr<spdlog::logger> m_logger  = {};
+        std::vector<Window *>           m_windows = {};
+        FramePacer                      m_pacer   = {};
+    };
+} // namespace engine
@@ -0,0 +1,387 @@
+#include "assets/asset_manager.hpp"
+#include "backend/device_manager.hpp"
+#include "backend/vulkan_backend.hpp"
+#include "drawables/GouraudMesh.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <span>
+#include <tiny_obj_loader.h>
+
+using std::shared_ptr, std::make_shared, std::vector, std::string, std::string_view, std::sort, std::erase_if;
+
+namespace engine
+{
+    static vk::DeviceSize mesh_bytes(const MeshData &data)
+    {
+        return data.vertices.size() * sizeof(primitives::GouraudVertex) + data.indices.size() * sizeof(uint32_t);
+    }
+
+    static bool is_finished(AssetState state)
+    {
+        return state == AssetState::Resident || state == AssetState::Cancelled || state == AssetState::Failed;
+    }
+
+    MeshHandle::MeshHandle(shared_ptr<detail::MeshRequest> request)
+        : m_request(std::move(request))
+    { }
+
+    AssetState MeshHandle::state() const
+    {
+        return m_request ? m_request->state.load() : AssetState::Cancelled;
+    }
+
+    bool MeshHandle::resident() const
+    {
+        return state() == AssetState::Resident;
+    }
+
+    size_t MeshHandle::bytes() const
+    {
+        return m_request ? m_request->bytes.load() : 0;
+    }
+
+    shared_ptr<GouraudMesh> MeshHandle::get() const
+    {
+        if (!resident())
+            return nullptr;
+
+        return m_request->mesh;
+    }
+
+    void MeshHandle::set_priority(float priority)
+    {
+        if (m_request)
+            m_request->priority = priority;
+    }
+
+    void MeshHandle::cancel()
+    {
+        if (!m_request)
+            return;
+
+        m_request->cancel = true;
+
+        // Requests which are queued or waiting for an upload can be dropped immediately; the others are dropped by
+        // whoever currently owns them.
+        AssetState expected = AssetState::Queued;
+        if (!m_request->state.compare_exchange_strong(expected, AssetState::Cancelled)) {
+            expected = AssetState::Decoded;
+            m_request->state.compare_exchange_strong(expected, AssetState::Cancelled);
+        }
+    }
+
+    AssetManager::AssetManager(VulkanBackend &backend, JobSystem::Shared job_system)
+        : m_logger(get_logger())
+        , m_backend(&backend)
+        , m_job_system(std::move(job_system))
+    {
+        max_concurrent_loads = std::max(m_job_system->worker_count(), 1u);
+    }
+
+    AssetManager::~AssetManager()
+    {
+        for (auto &request : m_requests)
+            MeshHandle(request).cancel();
+
+        // Workers hold a reference to `m_loading`
+        while (m_loading > 0)
+            if (!m_job_system->try_run_one())
+                std::this_thread::yield();
+
+        retire_uploads(true);
+        m_requests.clear();
+    }
+
+    MeshHandle AssetManager::load_mesh(string_view path, float priority)
+    {
+        auto &file = m_files[string(path)];
+        if (Request existing = reuse(file, priority))
+            return MeshHandle(std::move(existing));
+
+        auto request      = make_shared<detail::MeshRequest>();
+        request->source   = path;
+        request->priority = priority;
+        file              = request;
+
+        return enqueue(std::move(request));
+    }
+
+    MeshHandle AssetManager::load_mesh(MeshLoader loader, float priority, string_view name)
+    {
+        auto request      = make_shared<detail::MeshRequest>();
+        request->source   = name;
+        request->loader   = std::move(loader);
+        request->priority = priority;
+
+        if (name != UNNAMED_MESH) {
+            auto &procedural = m_procedural[string(name)];
+            if (Request existing = reuse(procedural, priority))
+                return MeshHandle(std::move(existing));
+            procedural = request;
+        }
+
+        return enqueue(std::move(request));
+    }
+
+    MeshHandle AssetManager::enqueue(Request request)
+    {
+        m_requests.push_back(request);
+        return MeshHandle(std::move(request));
+    }
+
+    AssetManager::Request AssetManager::reuse(const std::weak_ptr<detail::MeshRequest> &shared, float priority)
+    {
+        Request existing = shared.lock();
+        if (!existing)
+            return nullptr;
+
+        AssetState state = existing->state;
+        if (state == AssetState::Cancelled || state == AssetState::Failed)
+            return nullptr;
+
+        existing->priority = std::max(existing->priority.load(), priority);
+        return existing;
+    }
+
+    void AssetManager::update()
+    {
+        retire_uploads(false);
+        dispatch_loads();
+        submit_uploads();
+    }
+
+    size_t AssetManager::pending() const noexcept
+    {
+        return std::count_if(m_requests.begin(), m_requests.end(),
+                             [](const Request &request) { return !is_finished(request->state); });
+    }
+
+    float AssetManager::distance_priority(float distance)
+    {
+        return -distance;
+    }
+
+    float AssetManager::distance_priority(const glm::vec3 &camera, const glm::vec3 &location)
+    {
+        return distance_priority(glm::distance(camera, location));
+    }
+
+    void AssetManager::dispatch_loads()
+    {
+        erase_if(m_requests, [](const Request &request) { return is_finished(request->state); });
+        erase_if(m_files, [](const auto &file) { return file.second.expired(); });
+
+        if (m_loading >= max_concurrent_loads)
+            return;
+
+        vector<Request> queued = {};
+        for (auto &request : m_requests)
+            if (request->state == AssetState::Queued)
+                queued.push_back(request);
+
+        sort(queued.begin(), queued.end(),
+             [](const Request &a, const Request &b) { return a->priority > b->priority; });
+
+        for (auto &request : queued) {
+            if (m_loading >= max_concurrent_loads)
+                break;
+
+            AssetState expected = AssetState::Queued;
+            if (!request->state.compare_exchange_strong(expected, AssetState::Loading))
+                continue;
+
+            ++m_loading;
+            m_job_system->submit([request, &loading = m_loading, max_lods = max_lods]() {
+                try {
+                    if (!request->cancel) {
+                        MeshData data = request->loader ? request->loader() : decode_obj(request->source);
+
+                        if (data.vertices.empty() || data.indices.empty())
+                            throw Exception(fmt::format("Mesh \"{}\" has no geometry", request->source));
+
+                        data.bounds = {};
+                        for (const auto &vertex : data.vertices)
+                            data.bounds.expand(vertex.position);
+
+                        if (data.lods.empty())
+                            data.lods = generate_lods(data.vertices, data.indices, max_lods);
+
+                        request->bytes = mesh_bytes(data);
+                        request->data  = std::move(data);
+                    }
+
+                    request->state = request->cancel ? AssetState::Cancelled : AssetState::Decoded;
+                } catch (Exception &e) {
+                    e.log();
+                    request->state = AssetState::Failed;
+                } catch (std::exception &e) {
+                    get_logger()->error("Failed to load mesh \"{}\": {}", request->source, e.what());
+                    request->state = AssetState::Failed;
+                }
+
+                --loading;
+            });
+        }
+    }
+
+    void AssetManager::submit_uploads()
+    {
+        constexpr vk::BufferUsageFlags BUFFER_USAGE = vk::BufferUsageFlagBits::eVertexBuffer
+                                                    | vk::BufferUsageFlagBits::eIndexBuffer
+                                                    | vk::BufferUsageFlagBits::eTransferDst;
+
+        vector<Request> decoded = {};
+        for (auto &request : m_requests)
+            if (request->state == AssetState::Decoded)
+                decoded.push_back(request);
+
+        if (decoded.empty())
+            return;
+
+        sort(decoded.begin(), decoded.end(),
+             [](const Request &a, const Request &b) { return a->priority > b->priority; });
+
+        // Fill the budget in priority order; the first mesh is always taken so that large meshes still make progress.
+        vk::DeviceSize total = 0;
+        size_t         count = 0;
+        for (; count < decoded.size(); ++count) {
+            vk::DeviceSize bytes = mesh_bytes(decoded[count]->data);
+            if (count > 0 && total + bytes > upload_budget)
+                break;
+            total += bytes;
+        }
+        decoded.resize(count);
+
+        UploadBatch &batch = m_batches.emplace_back(UploadBatch {
+            .cmd     = m_backend->m_command_pool.get(),
+            .value   = 0,
+            .staging = HostVisibleBufferAllocation(m_backend->m_allocator, total,
+                                                   vk::BufferUsageFlagBits::eTransferSrc),
+            .uploads = {},
+        });
+
+        batch.cmd.begin(vk::CommandBufferBeginInfo {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        vk::DeviceSize offset = 0;
+        for (auto &request : decoded) {
+            AssetState expected = AssetState::Decoded;
+            if (!request->state.compare_exchange_strong(expected, AssetState::Uploading))
+                continue;
+
+            MeshData      &data         = request->data;
+            vk::DeviceSize vertex_bytes = data.vertices.size() * sizeof(primitives::GouraudVertex);
+            vk::DeviceSize index_bytes  = data.indices.size() * sizeof(uint32_t);
+
+            uint8_t *staging = (uint8_t *)batch.staging.get_map() + offset;
+            memcpy(staging, data.vertices.data(), vertex_bytes);
+            memcpy(staging + vertex_bytes, data.indices.data(), index_bytes);
+
+            PendingUpload &upload = batch.uploads.emplace_back(PendingUpload {
+                .request      = request,
+                .allocation   = BufferAllocation(m_backend->m_allocator, vertex_bytes + index_bytes, BUFFER_USAGE),
+                .vertex_bytes = vertex_bytes,
+                .lods         = std::move(data.lods),
+                .bounds       = data.bounds,
+            });
+
+            batch.cmd.copyBuffer(batch.staging.buffer, upload.allocation.buffer,
+                                 vk::BufferCopy {.srcOffset = offset, .dstOffset = 0, .size = vertex_bytes + index_bytes});
+
+            offset += vertex_bytes + index_bytes;
+            data    = {};
+        }
+
+        batch.staging.flush();
+
+        // Make the copies visible to vertex input in every later submission.
+        vk::MemoryBarrier barrier = {
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead,
+        };
+        batch.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput, {},
+                                  barrier, {}, {});
+        batch.cmd.end();
+
+        Timeline      &timeline = m_backend->m_device_manager->timeline;
+        vk::SubmitInfo submit   = {.commandBufferCount = 1, .pCommandBuffers = &batch.cmd};
+
+        batch.value = timeline.submit(m_backend->m_graphics_queue, std::span(&submit, 1));
+
+        m_logger->debug("Uploading {} meshes ({} bytes)", batch.uploads.size(), offset);
+    }
+
+    void AssetManager::retire_uploads(bool wait)
+    {
+        Timeline &timeline = m_backend->m_device_manager->timeline;
+
+        for (auto it = m_batches.begin(); it != m_batches.end();) {
+            if (wait)
+                timeline.wait(it->value);
+            else if (!timeline.reached(it->value)) {
+                ++it;
+                continue;
+            }
+
+            for (auto &upload : it->uploads) {
+                auto &request = upload.request;
+
+                if (request->cancel) {
+                    request->state = AssetState::Cancelled;
+                    continue;
+                }
+
+                request->mesh  = shared_ptr<GouraudMesh>(new GouraudMesh(
+                    std::move(upload.allocation), 0, upload.vertex_bytes, std::move(upload.lods), upload.bounds));
+                request->state = AssetState::Resident;
+            }
+
+            m_backend->m_command_pool.free(it->cmd);
+            it = m_batches.erase(it);
+        }
+    }
+
+    MeshData AssetManager::decode_obj(const string &path)
+    {
+        tinyobj::ObjReaderConfig config = {};
+        config.triangulate              = true;
+        config.vertex_color             = true;
+
+        tinyobj::ObjReader reader = {};
+        if (!reader.ParseFromFile(path, config))
+            throw Exception(fmt::format("Failed to load \"{}\": {}", path, reader.Error()));
+
+        const auto &attrib = reader.GetAttrib();
+        MeshData    data   = {};
+
+        // Position and color share the vertex index, so vertices are deduplicated on it alone.
+        vector<int64_t> remap(attrib.vertices.size() / 3, -1);
+
+        for (const auto &shape : reader.GetShapes()) {
+            const auto &indices = shape.mesh.indices;
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                // OBJ faces are counter-clockwise, the pipeline culls counter-clockwise faces.
+                for (size_t corner : {i, i + 2, i + 1}) {
+                    int vertex = indices[corner].vertex_index;
+
+                    if (remap[vertex] < 0) {
+                        remap[vertex] = (int64_t)data.vertices.size();
+                        data.vertices.push_back(primitives::GouraudVertex {
+                            .position = {attrib.vertices[3 * vertex + 0], attrib.vertices[3 * vertex + 1],
+                                         attrib.vertices[3 * vertex + 2]},
+                            .color    = {attrib.colors[3 * vertex + 0], attrib.colors[3 * vertex + 1],
+                                         attrib.colors[3 * vertex + 2]},
+                        });
+                    }
+
+                    data.indices.push_back((uint32_t)remap[vertex]);
+                }
+            }
+        }
+
+        return data;
+    }
+} // namespace engine
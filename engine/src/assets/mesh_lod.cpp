@@ -0,0 +1,400 @@
+#include "assets/mesh_lod.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using std::span, std::vector, engine::primitives::GouraudVertex;
+
+namespace engine
+{
+    /// Sum of squared distances to a set of planes, weighted by the area of the triangles they came from
+    struct Quadric
+    {
+        /// Upper triangle of the symmetric 4x4 matrix, row by row
+        std::array<double, 10> m      = {};
+        double                 weight = 0.0;
+
+        static Quadric plane(const glm::dvec3 &normal, double distance, double weight)
+        {
+            double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+            Quadric q = {};
+            q.m       = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+            for (double &value : q.m)
+                value *= weight;
+            q.weight = weight;
+
+            return q;
+        }
+
+        Quadric &operator+=(const Quadric &other)
+        {
+            for (size_t i = 0; i < m.size(); ++i)
+                m[i] += other.m[i];
+            weight += other.weight;
+            return *this;
+        }
+
+        double evaluate(const glm::dvec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+
+            return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x + m[4] * y * y
+                 + 2.0 * m[5] * y * z + 2.0 * m[6] * y + m[7] * z * z + 2.0 * m[8] * z + m[9];
+        }
+    };
+
+    struct Collapse
+    {
+        float    distance = 0.0f;
+        uint32_t from     = 0;
+        uint32_t to       = 0;
+    };
+
+    static uint64_t edge_key(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    /// Distance of the surface from the planes of `quadric` at `point`
+    static float quadric_distance(const Quadric &quadric, const glm::dvec3 &point)
+    {
+        if (quadric.weight <= 0.0)
+            return 0.0f;
+
+        return (float)std::sqrt(std::max(0.0, quadric.evaluate(point)) / quadric.weight);
+    }
+
+    /// Simplify towards each of the decreasing `target_index_counts` in turn, passing the indices and error of each
+    /// level reached to `emit`. If the error limit is hit first, the last partial simplification is emitted instead.
+    template<class Emit>
+    static void simplify_levels(span<const GouraudVertex> vertices, span<const uint32_t> indices,
+                                span<const size_t> target_index_counts, float max_error, Emit &&emit)
+    {
+        float error = 0.0f;
+
+        // Weld vertices sharing a position, so that seams in the colors do not split the surface
+        vector<uint32_t> weld(vertices.size());
+        {
+            struct PositionHash
+            {
+                size_t operator()(const glm::vec3 &p) const
+                {
+                    uint32_t bits[3];
+                    std::memcpy(bits, &p, sizeof(bits));
+                    return (size_t(bits[0]) * 73856093) ^ (size_t(bits[1]) * 19349663) ^ (size_t(bits[2]) * 83492791);
+                }
+            };
+
+            std::unordered_map<glm::vec3, uint32_t, PositionHash> positions = {};
+            positions.reserve(vertices.size());
+            for (uint32_t i = 0; i < vertices.size(); ++i)
+                weld[i] = positions.try_emplace(vertices[i].position, i).first->second;
+        }
+
+        auto position = [&](uint32_t vertex) { return glm::dvec3(vertices[vertex].position); };
+
+        vector<uint32_t> triangles = {};
+        triangles.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            uint32_t a = weld[indices[i]], b = weld[indices[i + 1]], c = weld[indices[i + 2]];
+            if (a != b && b != c && c != a)
+                triangles.insert(triangles.end(), {a, b, c});
+        }
+
+        vector<Quadric> quadrics(vertices.size());
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            glm::dvec3 p0 = position(triangles[i]), p1 = position(triangles[i + 1]), p2 = position(triangles[i + 2]);
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+
+            double area = glm::length(normal) * 0.5;
+            if (area <= 0.0)
+                continue;
+
+            normal /= area * 2.0;
+            Quadric plane = Quadric::plane(normal, -glm::dot(normal, p0), area);
+            for (size_t corner = 0; corner < 3; ++corner)
+                quadrics[triangles[i + corner]] += plane;
+        }
+
+        // Vertices on open or non-manifold edges stay in place, so that the outline of the mesh is kept
+        vector<uint8_t> locked(vertices.size(), 0);
+        {
+            std::unordered_map<uint64_t, uint32_t> edge_uses = {};
+            for (size_t i = 0; i < triangles.size(); i += 3)
+                for (size_t corner = 0; corner < 3; ++corner)
+                    ++edge_uses[edge_key(triangles[i + corner], triangles[i + (corner + 1) % 3])];
+
+            for (auto [key, uses] : edge_uses)
+                if (uses != 2)
+                    locked[key >> 32] = locked[key & 0xFFFFFFFF] = 1;
+        }
+
+        vector<uint32_t> remap(vertices.size());
+        for (uint32_t i = 0; i < remap.size(); ++i)
+            remap[i] = i;
+
+        auto resolve = [&](uint32_t vertex) {
+            while (remap[vertex] != vertex)
+                vertex = remap[vertex];
+            return vertex;
+        };
+
+        // Vertices sharing each welded position, to pick the closest color from
+        vector<uint32_t> group_start(vertices.size() + 1, 0);
+        vector<uint32_t> groups(vertices.size());
+        for (uint32_t vertex : weld)
+            ++group_start[vertex + 1];
+        for (size_t i = 1; i < group_start.size(); ++i)
+            group_start[i] += group_start[i - 1];
+        {
+            vector<uint32_t> fill(group_start.begin(), group_start.end() - 1);
+            for (uint32_t i = 0; i < weld.size(); ++i)
+                groups[fill[weld[i]]++] = i;
+        }
+
+        auto corner_vertex = [&](uint32_t vertex) {
+            uint32_t target = resolve(weld[vertex]);
+            if (target == weld[vertex])
+                return vertex;
+
+            uint32_t best          = target;
+            float    best_distance = INFINITY;
+            for (uint32_t i = group_start[target]; i < group_start[target + 1]; ++i) {
+                glm::vec3 difference = vertices[groups[i]].color - vertices[vertex].color;
+                float     distance   = glm::dot(difference, difference);
+
+                if (distance < best_distance) {
+                    best          = groups[i];
+                    best_distance = distance;
+                }
+            }
+            return best;
+        };
+
+        auto snapshot = [&]() {
+            vector<uint32_t> result = {};
+            result.reserve(triangles.size());
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                uint32_t a = resolve(weld[indices[i]]);
+                uint32_t b = resolve(weld[indices[i + 1]]);
+                uint32_t c = resolve(weld[indices[i + 2]]);
+                if (a == b || b == c || c == a)
+                    continue;
+
+                result.insert(result.end(), {corner_vertex(indices[i]), corner_vertex(indices[i + 1]),
+                                             corner_vertex(indices[i + 2])});
+            }
+
+            return result;
+        };
+
+        vector<Collapse> collapses = {};
+        vector<uint32_t> adjacency_start(vertices.size() + 1);
+        vector<uint32_t> adjacency = {};
+        vector<uint8_t>  touched(vertices.size());
+
+        size_t level   = 0;
+        size_t emitted = triangles.size() / 3;
+
+        // Each pass collapses the cheapest edges which do not share a neighbourhood, then rebuilds the triangles
+        while (level < target_index_counts.size()) {
+            size_t target_triangles = target_index_counts[level] / 3;
+            if (triangles.size() / 3 <= target_triangles) {
+                emit(snapshot(), error);
+                emitted = triangles.size() / 3;
+                ++level;
+                continue;
+            }
+
+            collapses.clear();
+            for (size_t i = 0; i < triangles.size(); i += 3)
+                for (size_t corner = 0; corner < 3; ++corner) {
+                    uint32_t a = triangles[i + corner], b = triangles[i + (corner + 1) % 3];
+                    if (a > b)
+                        continue;
+
+                    Quadric combined = quadrics[a];
+                    combined += quadrics[b];
+
+                    float a_to_b = locked[a] ? INFINITY : quadric_distance(combined, position(b));
+                    float b_to_a = locked[b] ? INFINITY : quadric_distance(combined, position(a));
+
+                    if (a_to_b <= b_to_a && a_to_b <= max_error)
+                        collapses.push_back({a_to_b, a, b});
+                    else if (b_to_a < a_to_b && b_to_a <= max_error)
+                        collapses.push_back({b_to_a, b, a});
+                }
+
+            // Edges shared by two triangles were seen from both
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &l, const Collapse &r) {
+                return l.distance != r.distance ? l.distance < r.distance
+                                                : edge_key(l.from, l.to) < edge_key(r.from, r.to);
+            });
+            collapses.erase(std::unique(collapses.begin(), collapses.end(),
+                                        [](const Collapse &l, const Collapse &r) {
+                                            return l.from == r.from && l.to == r.to;
+                                        }),
+                            collapses.end());
+
+            std::fill(adjacency_start.begin(), adjacency_start.end(), 0);
+            for (uint32_t vertex : triangles)
+                ++adjacency_start[vertex + 1];
+            for (size_t i = 1; i < adjacency_start.size(); ++i)
+                adjacency_start[i] += adjacency_start[i - 1];
+
+            adjacency.resize(triangles.size());
+            {
+                vector<uint32_t> fill(adjacency_start.begin(), adjacency_start.end() - 1);
+                for (uint32_t i = 0; i < triangles.size(); ++i)
+                    adjacency[fill[triangles[i]]++] = i / 3;
+            }
+
+            std::fill(touched.begin(), touched.end(), 0);
+
+            size_t remaining = triangles.size() / 3;
+            size_t collapsed = 0;
+
+            for (const Collapse &collapse : collapses) {
+                if (remaining <= target_triangles)
+                    break;
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                // Reject collapses which would flip a triangle around the removed vertex
+                bool   flips   = false;
+                size_t removed = 0;
+                for (uint32_t t = adjacency_start[collapse.from]; t < adjacency_start[collapse.from + 1]; ++t) {
+                    const uint32_t *triangle = &triangles[adjacency[t] * 3];
+
+                    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                        ++removed;
+                        continue;
+                    }
+
+                    glm::dvec3 before[3], after[3];
+                    for (size_t corner = 0; corner < 3; ++corner) {
+                        before[corner] = position(triangle[corner]);
+                        after[corner]  = triangle[corner] == collapse.from ? position(collapse.to) : before[corner];
+                    }
+
+                    glm::dvec3 old_normal = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::dvec3 new_normal = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    if (glm::dot(old_normal, new_normal) <= 0.0) {
+                        flips = true;
+                        break;
+                    }
+                }
+
+                if (flips)
+                    continue;
+
+                remap[collapse.from]      = collapse.to;
+                quadrics[collapse.to]    += quadrics[collapse.from];
+                error                     = std::max(error, collapse.distance);
+                remaining                -= removed;
+                ++collapsed;
+
+                // The neighbourhood's triangles are stale until the next pass
+                for (uint32_t t = adjacency_start[collapse.from]; t < adjacency_start[collapse.from + 1]; ++t)
+                    for (size_t corner = 0; corner < 3; ++corner)
+                        touched[triangles[adjacency[t] * 3 + corner]] = 1;
+            }
+
+            if (collapsed == 0)
+                break;
+
+            size_t kept = 0;
+            for (size_t i = 0; i < triangles.size(); i += 3) {
+                uint32_t a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+                if (a == b || b == c || c == a)
+                    continue;
+
+                triangles[kept++] = a;
+                triangles[kept++] = b;
+                triangles[kept++] = c;
+            }
+            triangles.resize(kept);
+        }
+
+        if (level < target_index_counts.size() && triangles.size() / 3 < emitted)
+            emit(snapshot(), error);
+    }
+
+    vector<uint32_t> simplify_mesh(span<const GouraudVertex> vertices, span<const uint32_t> indices,
+                                   size_t target_index_count, float max_error, float &error)
+    {
+        vector<uint32_t> result(indices.begin(), indices.end());
+        error = 0.0f;
+
+        simplify_levels(vertices, indices, span(&target_index_count, 1), max_error,
+                        [&](vector<uint32_t> &&simplified, float simplified_error) {
+                            result = std::move(simplified);
+                            error  = simplified_error;
+                        });
+
+        return result;
+    }
+
+    vector<MeshLod> generate_lods(span<const GouraudVertex> vertices, vector<uint32_t> &indices, uint32_t max_lods,
+                                  float max_error)
+    {
+        vector<MeshLod> lods = {MeshLod {.first = 0, .count = (uint32_t)indices.size(), .error = 0.0f}};
+
+        glm::vec3 low = glm::vec3(INFINITY), high = glm::vec3(-INFINITY);
+        for (uint32_t index : indices) {
+            low  = glm::min(low, vertices[index].position);
+            high = glm::max(high, vertices[index].position);
+        }
+
+        glm::vec3 center = (low + high) * 0.5f;
+        float     radius = 0.0f;
+        for (uint32_t index : indices)
+            radius = std::max(radius, glm::distance(center, vertices[index].position));
+
+        if (!(radius > 0.0f))
+            return lods;
+
+        vector<size_t> targets = {};
+        for (size_t count = indices.size() / 6 * 3; count >= 3 && targets.size() + 1 < max_lods; count = count / 6 * 3)
+            targets.push_back(count);
+
+        // All levels come from one simplification run, which is copied out as it reaches each target. The levels
+        // index the full detail mesh, which is appended to as they are emitted.
+        vector<uint32_t> full(indices.begin(), indices.end());
+
+        simplify_levels(vertices, full, targets, max_error * radius, [&](vector<uint32_t> &&simplified, float error) {
+            // Levels which barely shrink would cost memory without saving much work
+            if (simplified.empty() || simplified.size() * 10 > size_t(lods.back().count) * 9)
+                return;
+
+            lods.push_back(MeshLod {
+                .first = (uint32_t)indices.size(),
+                .count = (uint32_t)simplified.size(),
+                .error = error / radius,
+            });
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+        });
+
+        return lods;
+    }
+
+    uint32_t select_lod(span<const MeshLod> lods, float radius_pixels, uint32_t current, float tolerance_pixels,
+                        float hysteresis)
+    {
+        uint32_t selected = 0;
+
+        for (uint32_t i = 1; i < lods.size(); ++i) {
+            float limit = i > current ? tolerance_pixels / (1.0f + hysteresis) : tolerance_pixels;
+            if (lods[i].error * radius_pixels > limit)
+                break;
+
+            selected = i;
+        }
+
+        return selected;
+    }
+} // namespace engine
@@ -0,0 +1,49 @@
+#include "backend/deletion_queue.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace engine
+{
+    DeletionQueue::DeletionQueue() = default;
+
+    DeletionQueue::~DeletionQueue()
+    {
+        flush();
+    }
+
+    void DeletionQueue::push(uint64_t value, std::function<void()> destroy)
+    {
+        // Later values are reached later, so an earlier value would wait for the entries before it anyway
+        if (!m_entries.empty())
+            value = std::max(value, m_entries.back().value);
+
+        m_entries.push_back(Entry {.value = value, .destroy = std::move(destroy)});
+    }
+
+    void DeletionQueue::stamp(uint64_t value)
+    {
+        // Entries pushed after one waiting on the next submission were raised to `NEXT` too
+        for (auto it = m_entries.rbegin(); it != m_entries.rend() && it->value == NEXT; ++it)
+            it->value = value;
+    }
+
+    void DeletionQueue::collect(uint64_t finished)
+    {
+        while (!m_entries.empty() && m_entries.front().value <= finished) {
+            // Popped first, so that a destruction which throws is not run again
+            Entry entry = std::move(m_entries.front());
+            m_entries.pop_front();
+            entry.destroy();
+        }
+    }
+
+    void DeletionQueue::flush()
+    {
+        collect(UINT64_MAX);
+    }
+
+    size_t DeletionQueue::size() const noexcept
+    {
+        return m_entries.size();
+    }
+} // namespace engine
@@ -34,11 +34,12 @@ namespace engine
     {
         buffer.end();
 
-        queue.submit(vk::SubmitInfo {
+        // Only this submission is waited for, rather than every frame in flight on the queue
+        vk::SubmitInfo submit = {
             .commandBufferCount = 1,
             .pCommandBuffers    = &buffer,
-        });
-        queue.waitIdle();
+        };
+        p_manager->timeline.wait(p_manager->timeline.submit(queue, span(&submit, 1)));
         p_manager->device.freeCommandBuffers(p_manager->command_pool, buffer);
 
         p_manager = nullptr;
@@ -130,7 +131,19 @@ namespace engine
                 .pQueuePriorities = &queue_priority,
             });
 
+        // Submissions are tracked with a timeline semaphore rather than fences
+        vk::PhysicalDeviceVulkan12Features vulkan12_features = {
+            .timelineSemaphore = true,
+        };
+
+        // Drawing uses dynamic rendering rather than render pass and framebuffer objects
+        vk::PhysicalDeviceVulkan13Features vulkan13_features = {
+            .pNext            = &vulkan12_features,
+            .dynamicRendering = true,
+        };
+
         vk::DeviceCreateInfo dci = {
+            .pNext                   = &vulkan13_features,
             .queueCreateInfoCount    = (uint32_t)queue_create_infos.size(),
             .pQueueCreateInfos       = queue_create_infos.data(),
             .enabledLayerCount       = 0,
@@ -158,6 +171,7 @@ namespace engine
         };
 
         command_pool = device.createCommandPool(cpi);
+        timeline.init(device);
 
         logger->info("Selected queue family {} for graphics queue ({:8X})", graphics_queue.index,
                      (size_t)(VkQueue)graphics_queue.handle);
@@ -167,6 +181,7 @@ namespace engine
 
     RenderDeviceManager::~RenderDeviceManager()
     {
+        timeline.destroy();
         device.destroyCommandPool(command_pool);
         device.destroy();
         logger->info("Destroyed device");
@@ -202,9 +217,9 @@ namespace engine
         for (auto format : formats) {
             vk::FormatProperties properties = physical_device.getFormatProperties(format);
 
-            if ((tiling == vk::ImageTiling::eLinear) && (properties.linearTilingFeatures & features))
+            if ((tiling == vk::ImageTiling::eLinear) && (properties.linearTilingFeatures & features) == features)
                 return format;
-            else if ((tiling == vk::ImageTiling::eOptimal) && (properties.optimalTilingFeatures & features))
+            else if ((tiling == vk::ImageTiling::eOptimal) && (properties.optimalTilingFeatures & features) == features)
                 return format;
         }
 
@@ -0,0 +1,81 @@
+#include "backend/dynamic_resolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace engine
+{
+    /// Weight of each new sample in the average GPU time
+    static constexpr double   SMOOTHING = 0.1;
+    /// The scale only grows while the GPU time is below this fraction of the budget
+    static constexpr double   HEADROOM  = 0.85;
+    /// Fraction of the distance to the ideal scale covered by each update
+    static constexpr double   GAIN      = 0.25;
+    /// Scales are rounded to multiples of this, so that small variations in GPU time leave the resolution alone
+    static constexpr float    STEP      = 1.0f / 64.0f;
+    /// Frames left alone after a change, while frames in flight at the old scale finish and the average catches up
+    static constexpr uint32_t COOLDOWN  = 8;
+
+    void DynamicResolution::update(double gpu_ms)
+    {
+        double &average = m_statistics.gpu_ms;
+        average         = average == 0.0 ? gpu_ms : average + (gpu_ms - average) * SMOOTHING;
+
+        if (m_cooldown > 0) {
+            --m_cooldown;
+            return;
+        }
+
+        if (!enabled || average <= 0.0 || budget_ms <= 0.0)
+            return;
+
+        bool over  = average > budget_ms;
+        bool under = average < budget_ms * HEADROOM;
+        if (!over && !under)
+            return;
+
+        // Aim for the middle of the band between the headroom and the budget
+        double target = budget_ms * (1.0 + HEADROOM) * 0.5;
+        double ideal  = m_scale * std::sqrt(target / average);
+        double next   = m_scale + (ideal - m_scale) * GAIN;
+
+        float scale = std::clamp(std::round(float(next) / STEP) * STEP, min_scale, max_scale);
+
+        // Rounding may undo a small step, which must still be taken in the direction it was going
+        if (scale == m_scale)
+            scale = std::clamp(m_scale + (over ? -STEP : STEP), min_scale, max_scale);
+
+        if (scale != m_scale) {
+            m_scale    = scale;
+            m_cooldown = COOLDOWN;
+            ++m_statistics.changes;
+        }
+    }
+
+    void DynamicResolution::reset()
+    {
+        m_scale      = max_scale;
+        m_cooldown   = 0;
+        m_statistics = {};
+    }
+
+    float DynamicResolution::scale() const noexcept
+    {
+        return enabled ? m_scale : 1.0f;
+    }
+
+    vk::Extent2D DynamicResolution::extent(vk::Extent2D full) const noexcept
+    {
+        float s = scale();
+        return vk::Extent2D {
+            .width  = std::clamp(uint32_t(std::lround(full.width * s)), 1u, full.width),
+            .height = std::clamp(uint32_t(std::lround(full.height * s)), 1u, full.height),
+        };
+    }
+
+    DynamicResolution::Statistics DynamicResolution::statistics() const noexcept
+    {
+        Statistics statistics = m_statistics;
+        statistics.scale      = scale();
+        return statistics;
+    }
+} // namespace engine
@@ -125,6 +125,10 @@ namespace engine
         image      = other.image;
         view       = other.view;
         extent     = other.extent;
+        format     = other.format;
+        layout     = other.layout;
+
+        subresource_range = other.subresource_range;
 
         other.allocation = nullptr;
         other.image      = nullptr;
@@ -139,6 +143,9 @@ namespace engine
         std::swap(image, other.image);
         std::swap(view, other.view);
         std::swap(extent, other.extent);
+        std::swap(format, other.format);
+        std::swap(layout, other.layout);
+        std::swap(subresource_range, other.subresource_range);
 
         return *this;
     }
@@ -241,7 +241,10 @@ namespace engine
                                    && IS_FEATURE_SUPPORTED(inheritedQueries);                       //
 #undef IS_FEATURE_SUPPORTED
 
-            if (extensions_supported && features_supported)
+            // Rendering uses dynamic rendering, which every Vulkan 1.3 device supports
+            bool version_supported = device.getProperties().apiVersion >= vk::ApiVersion13;
+
+            if (extensions_supported && features_supported && version_supported)
                 supported_devices.push_back(device);
         }
 
@@ -0,0 +1,704 @@
+#include "backend/occlusion_culler.hpp"
+#include "backend/vulkan_backend.hpp"
+#include "drawables/drawing_context.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+#include "shaders.hpp"
+
+using std::span, std::vector, std::array;
+
+namespace engine
+{
+    /// Value of `visibility` for objects without draws
+    static constexpr uint32_t UNTESTED      = ~uint32_t(0);
+    static constexpr uint32_t OCCLUDED      = 0;
+    static constexpr uint32_t VISIBLE_LATE  = 2;
+    static constexpr uint32_t WORKGROUP     = 64;
+    static constexpr uint32_t PYRAMID_GROUP = 8;
+
+    struct PyramidParameters
+    {
+        glm::ivec2 source_size      = {};
+        glm::ivec2 destination_size = {};
+    };
+
+    struct CullParameters
+    {
+        glm::mat4 view_projection = {};
+        glm::vec2 viewport        = {};
+        uint32_t  levels          = 0;
+        uint32_t  draw_count      = 0;
+        uint32_t  late            = 0;
+        uint32_t  pyramid_valid   = 0;
+    };
+
+    static vk::Pipeline create_compute_pipeline(vk::Device device, vk::PipelineCache cache, vk::PipelineLayout layout,
+                                                span<const uint32_t> spirv_code)
+    {
+        vk::ShaderModule module = device.createShaderModule(vk::ShaderModuleCreateInfo {
+            .codeSize = (uint32_t)spirv_code.size_bytes(),
+            .pCode    = spirv_code.data(),
+        });
+
+        vk::ComputePipelineCreateInfo create_info = {
+            .stage  = {.stage = vk::ShaderStageFlagBits::eCompute, .module = module, .pName = "main"},
+            .layout = layout,
+        };
+
+        auto [result, pipeline] = device.createComputePipeline(cache, create_info);
+        device.destroyShaderModule(module);
+
+        if (result != vk::Result::eSuccess)
+            throw VulkanException((uint32_t)result, "Failed to create occlusion culling pipeline");
+
+        return pipeline;
+    }
+
+    OcclusionCuller::OcclusionCuller() { }
+
+    OcclusionCuller::~OcclusionCuller()
+    {
+        destroy();
+    }
+
+    void OcclusionCuller::init(VulkanBackend &backend)
+    {
+        m_backend = &backend;
+        m_device  = backend.m_device;
+
+        m_sampler = m_device.createSampler(vk::SamplerCreateInfo {
+            .magFilter    = vk::Filter::eNearest,
+            .minFilter    = vk::Filter::eNearest,
+            .mipmapMode   = vk::SamplerMipmapMode::eNearest,
+            .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+            .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+            .maxLod       = VK_LOD_CLAMP_NONE,
+        });
+
+        create_pipelines();
+
+        // Each frame's culling set binds the pyramid and three buffers
+        array<vk::DescriptorPoolSize, 2> sizes = {
+            vk::DescriptorPoolSize {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 1},
+            vk::DescriptorPoolSize {.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 3},
+        };
+        for (auto &size : sizes)
+            size.descriptorCount *= MAX_IN_FLIGHT;
+
+        m_frame_pool = m_device.createDescriptorPool(vk::DescriptorPoolCreateInfo {
+            .maxSets       = MAX_IN_FLIGHT,
+            .poolSizeCount = sizes.size(),
+            .pPoolSizes    = sizes.data(),
+        });
+
+        vector<vk::DescriptorSetLayout> layouts(MAX_IN_FLIGHT, m_cull_layout);
+
+        auto sets = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo {
+            .descriptorPool     = m_frame_pool,
+            .descriptorSetCount = (uint32_t)layouts.size(),
+            .pSetLayouts        = layouts.data(),
+        });
+        auto cmds = backend.m_command_pool.get(MAX_IN_FLIGHT);
+
+        for (size_t i = 0; i < MAX_IN_FLIGHT; ++i) {
+            m_frames[i].cull_set  = sets[i];
+            m_frames[i].early_cmd = cmds[i];
+        }
+    }
+
+    void OcclusionCuller::create_pipelines()
+    {
+        array<vk::DescriptorSetLayoutBinding, 2> pyramid_bindings = {
+            vk::DescriptorSetLayoutBinding {
+                .binding         = 0,
+                .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                .descriptorCount = 1,
+                .stageFlags      = vk::ShaderStageFlagBits::eCompute,
+            },
+            vk::DescriptorSetLayoutBinding {
+                .binding         = 1,
+                .descriptorType  = vk::DescriptorType::eStorageImage,
+                .descriptorCount = 1,
+                .stageFlags      = vk::ShaderStageFlagBits::eCompute,
+            },
+        };
+
+        array<vk::DescriptorSetLayoutBinding, 4> cull_bindings = {};
+        for (uint32_t i = 0; i < cull_bindings.size(); ++i) {
+            cull_bindings[i].binding         = i;
+            cull_bindings[i].descriptorType  = vk::DescriptorType::eStorageBuffer;
+            cull_bindings[i].descriptorCount = 1;
+            cull_bindings[i].stageFlags      = vk::ShaderStageFlagBits::eCompute;
+        }
+        // The pyramid
+        cull_bindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+
+        vk::DescriptorSetLayoutCreateInfo pyramid_layout = {
+            .bindingCount = pyramid_bindings.size(),
+            .pBindings    = pyramid_bindings.data(),
+        };
+
+        vk::DescriptorSetLayoutCreateInfo cull_layout = {
+            .bindingCount = cull_bindings.size(),
+            .pBindings    = cull_bindings.data(),
+        };
+
+        m_pyramid_layout = m_device.createDescriptorSetLayout(pyramid_layout);
+        m_cull_layout    = m_device.createDescriptorSetLayout(cull_layout);
+
+        vk::PushConstantRange pyramid_constants = {
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .offset     = 0,
+            .size       = sizeof(PyramidParameters),
+        };
+
+        vk::PushConstantRange cull_constants = {
+            .stageFlags = vk::ShaderStageFlagBits::eCompute,
+            .offset     = 0,
+            .size       = sizeof(CullParameters),
+        };
+
+        vk::PipelineLayoutCreateInfo pyramid_pipeline_layout = {
+            .setLayoutCount         = 1,
+            .pSetLayouts            = &m_pyramid_layout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges    = &pyramid_constants,
+        };
+
+        vk::PipelineLayoutCreateInfo cull_pipeline_layout = {
+            .setLayoutCount         = 1,
+            .pSetLayouts            = &m_cull_layout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges    = &cull_constants,
+        };
+
+        m_pyramid_pipeline_layout = m_device.createPipelineLayout(pyramid_pipeline_layout);
+        m_cull_pipeline_layout    = m_device.createPipelineLayout(cull_pipeline_layout);
+
+        vk::PipelineCache cache = m_backend->m_pipelines.cache();
+
+        m_pyramid_pipeline = create_compute_pipeline(m_device, cache, m_pyramid_pipeline_layout, hiz_downsample_shader);
+        m_cull_pipeline    = create_compute_pipeline(m_device, cache, m_cull_pipeline_layout, hiz_cull_shader);
+    }
+
+    void OcclusionCuller::destroy()
+    {
+        if (!m_device)
+            return;
+
+        destroy_pyramid();
+
+        for (auto &frame : m_frames) {
+            m_backend->m_command_pool.free(frame.early_cmd);
+            frame = Frame();
+        }
+
+        m_device.destroyDescriptorPool(m_frame_pool);
+        m_device.destroyPipeline(m_pyramid_pipeline);
+        m_device.destroyPipeline(m_cull_pipeline);
+        m_device.destroyPipelineLayout(m_pyramid_pipeline_layout);
+        m_device.destroyPipelineLayout(m_cull_pipeline_layout);
+        m_device.destroyDescriptorSetLayout(m_pyramid_layout);
+        m_device.destroyDescriptorSetLayout(m_cull_layout);
+        m_device.destroySampler(m_sampler);
+
+        m_frame_pool              = nullptr;
+        m_pyramid_pipeline        = nullptr;
+        m_cull_pipeline           = nullptr;
+        m_pyramid_pipeline_layout = nullptr;
+        m_cull_pipeline_layout    = nullptr;
+        m_pyramid_layout          = nullptr;
+        m_cull_layout             = nullptr;
+        m_sampler                 = nullptr;
+        m_device                  = nullptr;
+        m_backend                 = nullptr;
+    }
+
+    void OcclusionCuller::resize(DeletionQueue &retired, uint64_t value)
+    {
+        if (!m_pyramid.image) {
+            destroy_pyramid();
+            return;
+        }
+
+        // Frames in flight may still build or sample the pyramid
+        auto pyramid = std::make_shared<ImageAllocation>(std::move(m_pyramid));
+        retired.push(value, [device = m_device, pyramid, views = m_level_views, pool = m_pyramid_pool]() {
+            for (vk::ImageView view : views)
+                device.destroyImageView(view);
+            device.destroyDescriptorPool(pool);
+        });
+
+        m_level_views.clear();
+        m_pyramid_pool = nullptr;
+        destroy_pyramid();
+    }
+
+    void OcclusionCuller::create_pyramid()
+    {
+        if (m_pyramid.image)
+            return;
+
+        SwapchainManager &swapchain = m_backend->m_swapchain;
+        vk::Extent2D      extent    = swapchain.configuration.extent;
+
+        // Power of two sizes halve exactly at each level, so a texel of level n covers exactly 2^(n+1) pixels
+        uint32_t width  = std::bit_ceil((extent.width + 1) / 2);
+        uint32_t height = std::bit_ceil((extent.height + 1) / 2);
+        m_levels        = std::bit_width(std::max(width, height));
+
+        ImageAllocationInfo info = {
+            .usage      = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+            .width      = width,
+            .height     = height,
+            .format     = vk::Format::eR32Sfloat,
+            .mip_levels = m_levels,
+        };
+        info.view_subresource_range.levelCount = m_levels;
+
+        m_pyramid = ImageAllocation(m_backend->m_allocator, info);
+
+        m_level_views.resize(m_levels);
+        for (uint32_t level = 0; level < m_levels; ++level)
+            m_level_views[level] = m_device.createImageView(vk::ImageViewCreateInfo {
+                .image            = m_pyramid.image,
+                .viewType         = vk::ImageViewType::e2D,
+                .format           = vk::Format::eR32Sfloat,
+                .subresourceRange = {.aspectMask     = vk::ImageAspectFlagBits::eColor,
+                                     .baseMipLevel   = level,
+                                     .levelCount     = 1,
+                                     .baseArrayLayer = 0,
+                                     .layerCount     = 1},
+            });
+
+        // Depth buffers are created on first use, so the sets reducing them are written as the frames build the
+        // pyramid
+        uint32_t set_count = MAX_IN_FLIGHT + m_levels - 1;
+
+        array<vk::DescriptorPoolSize, 2> sizes = {
+            vk::DescriptorPoolSize {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = set_count},
+            vk::DescriptorPoolSize {.type = vk::DescriptorType::eStorageImage, .descriptorCount = set_count},
+        };
+
+        m_pyramid_pool = m_device.createDescriptorPool(vk::DescriptorPoolCreateInfo {
+            .maxSets       = set_count,
+            .poolSizeCount = sizes.size(),
+            .pPoolSizes    = sizes.data(),
+        });
+
+        vector<vk::DescriptorSetLayout> layouts(set_count, m_pyramid_layout);
+
+        m_pyramid_sets = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo {
+            .descriptorPool     = m_pyramid_pool,
+            .descriptorSetCount = set_count,
+            .pSetLayouts        = layouts.data(),
+        });
+
+        vector<vk::DescriptorImageInfo> sources(set_count);
+        vector<vk::DescriptorImageInfo> destinations(set_count);
+        vector<vk::WriteDescriptorSet>  writes;
+        writes.reserve(set_count * 2);
+
+        for (uint32_t i = MAX_IN_FLIGHT; i < set_count; ++i) {
+            uint32_t level = i - MAX_IN_FLIGHT + 1;
+
+            sources[i] = {
+                .sampler     = m_sampler,
+                .imageView   = m_level_views[level - 1],
+                .imageLayout = vk::ImageLayout::eGeneral,
+            };
+            destinations[i] = {.imageView = m_level_views[level], .imageLayout = vk::ImageLayout::eGeneral};
+
+            writes.push_back({
+                .dstSet          = m_pyramid_sets[i],
+                .dstBinding      = 0,
+                .descriptorCount = 1,
+                .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo      = &sources[i],
+            });
+            writes.push_back({
+                .dstSet          = m_pyramid_sets[i],
+                .dstBinding      = 1,
+                .descriptorCount = 1,
+                .descriptorType  = vk::DescriptorType::eStorageImage,
+                .pImageInfo      = &destinations[i],
+            });
+        }
+
+        m_device.updateDescriptorSets(writes, {});
+        m_pyramid_valid = false;
+    }
+
+    void OcclusionCuller::destroy_pyramid()
+    {
+        for (vk::ImageView view : m_level_views)
+            m_device.destroyImageView(view);
+
+        if (m_pyramid_pool)
+            m_device.destroyDescriptorPool(m_pyramid_pool);
+
+        m_pyramid       = ImageAllocation();
+        m_pyramid_pool  = nullptr;
+        m_levels        = 0;
+        m_pyramid_valid = false;
+        m_depth_views = {};
+        m_level_views.clear();
+        m_pyramid_sets.clear();
+    }
+
+    void OcclusionCuller::reserve(Frame &frame, size_t objects, size_t draws)
+    {
+        using vk::BufferUsageFlagBits::eStorageBuffer, vk::BufferUsageFlagBits::eIndirectBuffer;
+
+        auto &allocator = m_backend->m_allocator;
+
+        // The buffers are only used by this frame, whose previous submission has completed
+        if (frame.visibility.count() < objects) {
+            size_t count     = std::max(objects, frame.visibility.count() * 2);
+            frame.bounds     = TypedHostVisibleBufferAllocation<glm::vec4[]>(allocator, count * 2, eStorageBuffer);
+            frame.visibility = TypedHostVisibleBufferAllocation<uint32_t[]>(allocator, count, eStorageBuffer, true);
+        }
+
+        if (frame.draws.count() < draws)
+            frame.draws = TypedHostVisibleBufferAllocation<GpuDraw[]>(
+                allocator, std::max(draws, frame.draws.count() * 2), eStorageBuffer | eIndirectBuffer);
+    }
+
+    void OcclusionCuller::read_back(Frame &frame)
+    {
+        if (frame.tested == 0)
+            return;
+
+        if (!frame.visibility.coherent)
+            vmaInvalidateAllocation(*m_backend->m_allocator, frame.visibility.allocation, 0, VK_WHOLE_SIZE);
+
+        Statistics statistics = {};
+        for (uint32_t i = 0; i < frame.tested; ++i) {
+            uint32_t visibility = frame.visibility[i];
+            if (visibility == UNTESTED)
+                continue;
+
+            statistics.tested += 1;
+            statistics.occluded += visibility == OCCLUDED;
+            statistics.revealed += visibility == VISIBLE_LATE;
+        }
+
+        m_statistics = statistics;
+        frame.tested = 0;
+    }
+
+    void OcclusionCuller::begin(DrawingContext &context, span<const Aabb> bounds)
+    {
+        Frame &frame = m_frames[context.frame_index];
+
+        read_back(frame);
+        reserve(frame, bounds.size(), 0);
+
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            frame.bounds[i * 2]     = glm::vec4(bounds[i].min, 1.0f);
+            frame.bounds[i * 2 + 1] = glm::vec4(bounds[i].max, 1.0f);
+        }
+        frame.bounds.flush();
+
+        frame.queued.clear();
+        frame.items.clear();
+        frame.objects = bounds.size();
+
+        context.occlusion      = this;
+        context.occlusion_item = 0;
+    }
+
+    void OcclusionCuller::draw_indexed(DrawingContext &context, const IndexedDraw &draw)
+    {
+        Frame &frame = m_frames[context.frame_index];
+
+        frame.queued.push_back(draw);
+        frame.items.push_back(context.occlusion_item);
+    }
+
+    void OcclusionCuller::end(DrawingContext &context)
+    {
+        Frame &frame = m_frames[context.frame_index];
+
+        context.occlusion = nullptr;
+        if (frame.queued.empty())
+            return;
+
+        create_pyramid();
+        reserve(frame, frame.objects, frame.queued.size());
+
+        for (size_t i = 0; i < frame.queued.size(); ++i) {
+            vk::DrawIndexedIndirectCommand command = {
+                .indexCount    = frame.queued[i].index_count,
+                .instanceCount = 0,
+                .firstIndex    = frame.queued[i].first_index,
+                .vertexOffset  = 0,
+                .firstInstance = 0,
+            };
+
+            frame.draws[i] = {.early = command, .late = command, .item = frame.items[i]};
+        }
+        frame.draws.flush();
+
+        std::fill_n(frame.visibility.get(), frame.objects, UNTESTED);
+        frame.visibility.flush();
+
+        vk::DescriptorImageInfo pyramid = {
+            .sampler     = m_sampler,
+            .imageView   = m_pyramid.view,
+            .imageLayout = vk::ImageLayout::eGeneral,
+        };
+
+        // The bounds, draws and visibility bindings are consecutive, so a single write covers them
+        array<vk::DescriptorBufferInfo, 3> buffers = {
+            vk::DescriptorBufferInfo {.buffer = frame.bounds.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo {.buffer = frame.draws.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+            vk::DescriptorBufferInfo {.buffer = frame.visibility.buffer, .offset = 0, .range = VK_WHOLE_SIZE},
+        };
+
+        array<vk::WriteDescriptorSet, 2> writes = {
+            vk::WriteDescriptorSet {
+                .dstSet          = frame.cull_set,
+                .dstBinding      = 0,
+                .descriptorCount = 1,
+                .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo      = &pyramid,
+            },
+            vk::WriteDescriptorSet {
+                .dstSet          = frame.cull_set,
+                .dstBinding      = 1,
+                .descriptorCount = buffers.size(),
+                .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo     = buffers.data(),
+            },
+        };
+
+        m_device.updateDescriptorSets(writes, {});
+
+        record_early_phase(frame, context);
+        record_draws(context, frame, false);
+
+        vk::CommandBuffer cmd = context.cmd;
+        m_backend->m_swapchain.end_rendering(cmd, uint32_t(context.frame_index));
+
+        record_pyramid(cmd, uint32_t(context.frame_index), context.render_extent);
+
+        CullParameters parameters = {
+            .view_projection = context.view_projection,
+            .viewport        = glm::vec2(context.render_extent.width, context.render_extent.height),
+            .levels          = m_levels,
+            .draw_count      = (uint32_t)frame.queued.size(),
+            .late            = 1,
+            .pyramid_valid   = 1,
+        };
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_cull_pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_cull_pipeline_layout, 0, frame.cull_set, {});
+        cmd.pushConstants<CullParameters>(m_cull_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, parameters);
+        cmd.dispatch((parameters.draw_count + WORKGROUP - 1) / WORKGROUP, 1, 1);
+
+        vk::MemoryBarrier results = {
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eHostRead,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eHost, {}, results,
+                            {}, {});
+
+        m_backend->m_swapchain.begin_rendering(cmd, uint32_t(context.frame_index), context.render_extent, true);
+
+        record_draws(context, frame, true);
+
+        frame.tested    = frame.objects;
+        m_pyramid_valid = true;
+        m_pyramid_scene = context.render_extent;
+    }
+
+    void OcclusionCuller::record_early_phase(Frame &frame, const DrawingContext &context)
+    {
+        vk::CommandBuffer cmd = frame.early_cmd;
+
+        cmd.reset();
+        cmd.begin(vk::CommandBufferBeginInfo {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+        // The pyramid was written by the previous frame
+        if (m_pyramid_valid) {
+            vk::MemoryBarrier pyramid = {
+                .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+                .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+            };
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                {}, pyramid, {}, {});
+        }
+
+        // Pixels of a scene drawn at another size land on other texels of the pyramid, so every object is drawn early
+        // and tested again late
+        bool same_scene = m_pyramid_scene == context.render_extent;
+
+        CullParameters parameters = {
+            .view_projection = context.view_projection,
+            .viewport        = glm::vec2(context.render_extent.width, context.render_extent.height),
+            .levels          = m_levels,
+            .draw_count      = (uint32_t)frame.queued.size(),
+            .late            = 0,
+            .pyramid_valid   = m_pyramid_valid && same_scene,
+        };
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_cull_pipeline);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_cull_pipeline_layout, 0, frame.cull_set, {});
+        cmd.pushConstants<CullParameters>(m_cull_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0, parameters);
+        cmd.dispatch((parameters.draw_count + WORKGROUP - 1) / WORKGROUP, 1, 1);
+
+        vk::MemoryBarrier commands = {
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {},
+                            commands, {}, {});
+
+        cmd.end();
+    }
+
+    void OcclusionCuller::record_pyramid(vk::CommandBuffer cmd, uint32_t frame, vk::Extent2D extent)
+    {
+        // The frame's first set is only used by its own commands, which are not in flight while they are recorded
+        vk::ImageView depth = m_backend->m_swapchain.depth(frame).view;
+        if (m_depth_views[frame] != depth) {
+            vk::DescriptorImageInfo source = {
+                .sampler     = m_sampler,
+                .imageView   = depth,
+                .imageLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+            };
+            vk::DescriptorImageInfo destination = {
+                .imageView   = m_level_views[0],
+                .imageLayout = vk::ImageLayout::eGeneral,
+            };
+
+            array<vk::WriteDescriptorSet, 2> writes = {
+                vk::WriteDescriptorSet {
+                    .dstSet          = m_pyramid_sets[frame],
+                    .dstBinding      = 0,
+                    .descriptorCount = 1,
+                    .descriptorType  = vk::DescriptorType::eCombinedImageSampler,
+                    .pImageInfo      = &source,
+                },
+                vk::WriteDescriptorSet {
+                    .dstSet          = m_pyramid_sets[frame],
+                    .dstBinding      = 1,
+                    .descriptorCount = 1,
+                    .descriptorType  = vk::DescriptorType::eStorageImage,
+                    .pImageInfo      = &destination,
+                },
+            };
+            m_device.updateDescriptorSets(writes, {});
+            m_depth_views[frame] = depth;
+        }
+
+        vk::ImageSubresourceRange range = {
+            .aspectMask     = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel   = 0,
+            .levelCount     = m_levels,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        };
+
+        // Both phases must be done reading the pyramid, and the late phase reads what the early phase wrote
+        vk::ImageMemoryBarrier overwrite = {
+            .srcAccessMask       = vk::AccessFlagBits::eShaderRead,
+            .dstAccessMask       = vk::AccessFlagBits::eShaderWrite,
+            .oldLayout           = m_pyramid_valid ? vk::ImageLayout::eGeneral : vk::ImageLayout::eUndefined,
+            .newLayout           = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image               = m_pyramid.image,
+            .subresourceRange    = range,
+        };
+        vk::MemoryBarrier early = {
+            .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+        };
+
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+                            early, {}, overwrite);
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, m_pyramid_pipeline);
+
+        PyramidParameters parameters = {
+            .source_size      = glm::ivec2(extent.width, extent.height),
+            .destination_size = glm::ivec2(m_pyramid.extent.width, m_pyramid.extent.height),
+        };
+
+        for (uint32_t level = 0; level < m_levels; ++level) {
+            vk::DescriptorSet set = level == 0 ? m_pyramid_sets[frame] : m_pyramid_sets[MAX_IN_FLIGHT + level - 1];
+
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pyramid_pipeline_layout, 0, set, {});
+            cmd.pushConstants<PyramidParameters>(m_pyramid_pipeline_layout, vk::ShaderStageFlagBits::eCompute, 0,
+                                                 parameters);
+            cmd.dispatch((parameters.destination_size.x + PYRAMID_GROUP - 1) / PYRAMID_GROUP,
+                         (parameters.destination_size.y + PYRAMID_GROUP - 1) / PYRAMID_GROUP, 1);
+
+            range.baseMipLevel = level;
+            range.levelCount   = 1;
+
+            vk::ImageMemoryBarrier written = {
+                .srcAccessMask       = vk::AccessFlagBits::eShaderWrite,
+                .dstAccessMask       = vk::AccessFlagBits::eShaderRead,
+                .oldLayout           = vk::ImageLayout::eGeneral,
+                .newLayout           = vk::ImageLayout::eGeneral,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image               = m_pyramid.image,
+                .subresourceRange    = range,
+            };
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                {}, {}, {}, written);
+
+            parameters.source_size      = parameters.destination_size;
+            parameters.destination_size = glm::max(parameters.destination_size / 2, glm::ivec2(1));
+        }
+    }
+
+    void OcclusionCuller::record_draws(DrawingContext &context, const Frame &frame, bool late)
+    {
+        vk::CommandBuffer cmd       = context.cmd;
+        vk::DeviceSize    command   = late ? offsetof(GpuDraw, late) : offsetof(GpuDraw, early);
+        vk::Pipeline      pipeline  = nullptr;
+        vk::DescriptorSet bound_set = nullptr;
+
+        // The second phase begins rendering again, so nothing is assumed to be bound
+        if (!late)
+            pipeline = context.bound_pipeline;
+
+        for (size_t i = 0; i < frame.queued.size(); ++i) {
+            const IndexedDraw &draw = frame.queued[i];
+
+            if (draw.pipeline != pipeline) {
+                cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, draw.pipeline);
+                pipeline = draw.pipeline;
+            }
+
+            if (draw.descriptor != bound_set) {
+                cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_backend->m_pipeline_layout, 0,
+                                       draw.descriptor, {});
+                bound_set = draw.descriptor;
+            }
+
+            cmd.bindVertexBuffers(0, draw.buffer, draw.vertex_offset);
+            cmd.bindIndexBuffer(draw.buffer, draw.index_offset, vk::IndexType::eUint32);
+            cmd.drawIndexedIndirect(frame.draws.buffer, frame.draws.offset(i) + command, 1,
+                                    sizeof(vk::DrawIndexedIndirectCommand));
+        }
+
+        if (pipeline)
+            context.bound_pipeline = pipeline;
+    }
+
+    OcclusionCuller::Statistics OcclusionCuller::statistics() const noexcept
+    {
+        return m_statistics;
+    }
+} // namespace engine
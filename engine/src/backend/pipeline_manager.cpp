@@ -0,0 +1,190 @@
+#include "backend/pipeline_manager.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <thread>
+
+using std::string_view, std::optional, std::nullopt, std::lock_guard, std::chrono::steady_clock;
+
+namespace engine
+{
+    PipelineManager::PipelineManager() { }
+
+    PipelineManager::~PipelineManager()
+    {
+        destroy();
+    }
+
+    void PipelineManager::init(vk::Device device, JobSystem::Shared job_system)
+    {
+        m_logger     = get_logger();
+        m_device     = device;
+        m_job_system = std::move(job_system);
+        m_cache      = m_device.createPipelineCache(vk::PipelineCacheCreateInfo {});
+    }
+
+    void PipelineManager::destroy()
+    {
+        if (!m_device)
+            return;
+
+        // Compilations reference the variants and the pipeline cache
+        while (m_compiling > 0)
+            if (!m_job_system->try_run_one())
+                std::this_thread::yield();
+
+        for (auto &variant : m_variants)
+            if (variant.pipeline)
+                m_device.destroyPipeline(variant.pipeline);
+
+        m_device.destroyPipelineCache(m_cache);
+
+        m_variants.clear();
+        m_cache      = nullptr;
+        m_device     = nullptr;
+        m_job_system = nullptr;
+    }
+
+    vk::PipelineCache PipelineManager::cache() const noexcept
+    {
+        return m_cache;
+    }
+
+    PipelineId PipelineManager::add(string_view name, vk::Pipeline pipeline)
+    {
+        lock_guard lock(m_mutex);
+
+        PipelineId id    = m_variants.size();
+        Variant   &added = m_variants.emplace_back();
+        added.name       = name;
+        added.pipeline   = pipeline;
+        added.ready      = true;
+
+        return id;
+    }
+
+    PipelineId PipelineManager::request(string_view name, PipelineConfiguration config, vk::PipelineLayout layout,
+                                        AttachmentFormats formats, PipelineId fallback)
+    {
+        if (auto existing = find(name))
+            return *existing;
+
+        PipelineId id;
+        Variant   *variant;
+        {
+            lock_guard lock(m_mutex);
+
+            id                = m_variants.size();
+            variant           = &m_variants.emplace_back();
+            variant->name     = name;
+            variant->fallback = fallback;
+            ++m_statistics.pending;
+        }
+
+        ++m_compiling;
+        m_job_system->submit([this, variant, config = std::move(config), layout, formats]() {
+            compile(*variant, config, layout, formats);
+            --m_compiling;
+        });
+
+        return id;
+    }
+
+    optional<PipelineId> PipelineManager::find(string_view name) const
+    {
+        lock_guard lock(m_mutex);
+
+        auto it = std::find_if(m_variants.begin(), m_variants.end(),
+                               [&](const Variant &variant) { return variant.name == name; });
+        if (it == m_variants.end())
+            return nullopt;
+
+        return PipelineId(it - m_variants.begin());
+    }
+
+    bool PipelineManager::ready(PipelineId id) const
+    {
+        lock_guard lock(m_mutex);
+        return id < m_variants.size() && m_variants[id].ready;
+    }
+
+    vk::Pipeline PipelineManager::get(PipelineId id)
+    {
+        lock_guard lock(m_mutex);
+
+        if (id >= m_variants.size())
+            throw Exception(fmt::format("Unknown pipeline {}", id));
+
+        const Variant &variant = m_variants[id];
+        if (variant.ready)
+            return variant.pipeline;
+
+        // Only count stalls which compiling on this thread would have caused
+        if (!variant.failed)
+            m_frame_missed = true;
+
+        if (variant.fallback < m_variants.size() && m_variants[variant.fallback].ready) {
+            ++m_statistics.fallback_draws;
+            return m_variants[variant.fallback].pipeline;
+        }
+
+        ++m_statistics.skipped_draws;
+        return nullptr;
+    }
+
+    void PipelineManager::end_frame()
+    {
+        lock_guard lock(m_mutex);
+
+        if (m_frame_missed)
+            ++m_statistics.hitch_frames_avoided;
+        m_frame_missed = false;
+    }
+
+    PipelineManager::Statistics PipelineManager::statistics() const
+    {
+        lock_guard lock(m_mutex);
+        return m_statistics;
+    }
+
+    void PipelineManager::compile(Variant &variant, PipelineConfiguration config, vk::PipelineLayout layout,
+                                  AttachmentFormats formats)
+    {
+        auto start = steady_clock::now();
+
+        vk::Pipeline pipeline = nullptr;
+        try {
+            auto [result, created] = m_device.createGraphicsPipeline(m_cache, config.prepare(layout, formats));
+            if (result != vk::Result::eSuccess)
+                throw VulkanException((uint32_t)result, fmt::format("Failed to compile pipeline \"{}\"", variant.name));
+
+            pipeline = created;
+        } catch (Exception &e) {
+            e.log();
+        } catch (std::exception &e) {
+            m_logger->error("Failed to compile pipeline \"{}\": {}", variant.name, e.what());
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(steady_clock::now() - start).count();
+
+        lock_guard lock(m_mutex);
+
+        --m_statistics.pending;
+        if (!pipeline) {
+            ++m_statistics.failed;
+            variant.failed = true;
+            return;
+        }
+
+        ++m_statistics.compiled;
+        m_statistics.last_compile_ms   = elapsed;
+        m_statistics.max_compile_ms    = std::max(m_statistics.max_compile_ms, elapsed);
+        m_statistics.total_compile_ms += elapsed;
+
+        variant.pipeline = pipeline;
+        variant.ready    = true;
+
+        m_logger->info("Compiled pipeline \"{}\" in {:.2f} ms", variant.name, elapsed);
+    }
+} // namespace engine
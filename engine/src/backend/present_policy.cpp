@@ -0,0 +1,52 @@
+#include "backend/present_policy.hpp"
+#include "constants.hpp"
+#include <array>
+
+using std::array, std::string_view;
+
+namespace engine
+{
+    /// Frame rate of the power saving policy
+    static constexpr double POWER_SAVING_CAP = 30.0;
+
+    static constexpr array LOW_LATENCY_MODES  = {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+    static constexpr array SMOOTH_MODES       = {vk::PresentModeKHR::eFifo};
+    static constexpr array POWER_SAVING_MODES = {vk::PresentModeKHR::eFifoRelaxed};
+    static constexpr array BENCHMARK_MODES    = {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+
+    PresentSettings present_settings(PresentPolicy policy) noexcept
+    {
+        switch (policy) {
+        case PresentPolicy::LowLatency:
+            return PresentSettings {.modes = LOW_LATENCY_MODES, .min_frames = 1, .max_frames = 1};
+        case PresentPolicy::PowerSaving:
+            return PresentSettings {
+                .modes      = POWER_SAVING_MODES,
+                .min_frames = 2,
+                .max_frames = 2,
+                .frame_cap  = POWER_SAVING_CAP,
+            };
+        case PresentPolicy::Benchmark:
+            return PresentSettings {.modes = BENCHMARK_MODES, .min_frames = 2, .max_frames = MAX_IN_FLIGHT};
+        case PresentPolicy::Smooth:
+        default:
+            return PresentSettings {.modes = SMOOTH_MODES, .min_frames = 2, .max_frames = 3};
+        }
+    }
+
+    string_view to_string(PresentPolicy policy)
+    {
+        switch (policy) {
+        case PresentPolicy::LowLatency:
+            return "Low latency";
+        case PresentPolicy::Smooth:
+            return "Smooth";
+        case PresentPolicy::PowerSaving:
+            return "Power saving";
+        case PresentPolicy::Benchmark:
+            return "Benchmark";
+        default:
+            return "Unknown";
+        }
+    }
+} // namespace engine
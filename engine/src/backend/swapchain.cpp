@@ -2,6 +2,8 @@
 #include "backend/device_manager.hpp"
 #include "exceptions.hpp"
 #include <array>
+#include <fmt/format.h>
+#include <memory>
 
 static const std::array<vk::Format, 3> SUPPORTED_DEPTH_FORMATS = {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint,
                                                                   vk::Format::eD24UnormS8Uint};
@@ -13,6 +15,21 @@ static bool has_stencil_component(vk::Format format)
 
 namespace engine
 {
+    /// Range of a depth buffer to transition, which covers its stencil as well if it has one
+    static vk::ImageSubresourceRange depth_range(vk::Format format)
+    {
+        vk::ImageSubresourceRange range = {
+            .aspectMask     = vk::ImageAspectFlagBits::eDepth,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        };
+        if (has_stencil_component(format))
+            range.aspectMask |= vk::ImageAspectFlagBits::eStencil;
+        return range;
+    }
+
     SwapchainSupportDetails SwapchainSupportDetails::query(vk::PhysicalDevice device, vk::SurfaceKHR surface)
     {
         return SwapchainSupportDetails {
@@ -39,9 +56,9 @@ namespace engine
     SwapchainManager::SwapchainManager() { }
 
     SwapchainManager::SwapchainManager(SharedDeviceManager device_manager, vk::SurfaceKHR surface,
-                                       SwapchainConfiguration config)
+                                       SwapchainConfiguration config, std::shared_ptr<VulkanAllocator> allocator)
     {
-        init(device_manager, surface, configuration);
+        init(device_manager, surface, configuration, std::move(allocator));
     }
 
     SwapchainManager::~SwapchainManager()
@@ -49,101 +66,66 @@ namespace engine
         destroy();
     }
 
-    bool SwapchainManager::recreate_swapchain(SwapchainConfiguration config)
+    bool SwapchainManager::recreate_swapchain(SwapchainConfiguration config, DeletionQueue &retired, uint64_t value)
     {
-        m_device.waitIdle();
-        if (swapchain)
-            destroy_swapchain();
+        // A zero sized window keeps its swapchain, without images, to create the next one from
+        bool             valid         = config.extent.width != 0 && config.extent.height != 0;
+        vk::SwapchainKHR old_swapchain = valid ? swapchain : nullptr;
+        auto             old_images    = std::make_shared<std::vector<SwapchainImage>>(std::move(images));
+        auto             old_targets   = std::make_shared<FrameTargets>(std::move(m_targets));
+        images.clear();
 
-        if (config.extent.width == 0 || config.extent.height == 0)
-            return false;
+        if (valid) {
+            configuration = config;
+            create_swapchain();
+            get_swapchain_images();
+        }
 
-        configuration = config;
-        create_swapchain();
-        get_swapchain_images();
-        return true;
+        if (old_swapchain || !old_images->empty())
+            retired.push(value, [device = m_device, old_swapchain, old_images, old_targets]() {
+                destroy_images(device, *old_images);
+                if (old_swapchain)
+                    device.destroySwapchainKHR(old_swapchain);
+            });
+
+        return valid;
     }
 
     void SwapchainManager::init(SharedDeviceManager device_manager, vk::SurfaceKHR surface,
-                                SwapchainConfiguration config)
+                                SwapchainConfiguration config, std::shared_ptr<VulkanAllocator> allocator)
+    {
+        init_formats(device_manager, surface, config);
+        init_swapchain(std::move(allocator));
+    }
+
+    void SwapchainManager::init_formats(SharedDeviceManager device_manager, vk::SurfaceKHR surface,
+                                        SwapchainConfiguration config)
     {
         m_device_manager = device_manager;
         m_device         = device_manager->device;
         m_surface        = surface;
         configuration    = config;
 
-        create_swapchain();
-
+        // The depth buffer is sampled to build the occlusion culling pyramid
         depth_format = m_device_manager->find_supported_format(SUPPORTED_DEPTH_FORMATS, vk::ImageTiling::eOptimal,
-                                                               vk::FormatFeatureFlagBits::eDepthStencilAttachment);
-
-        vk::AttachmentDescription color_attachment = {
-            .format         = configuration.format,
-            .samples        = vk::SampleCountFlagBits::e1,
-            .loadOp         = vk::AttachmentLoadOp::eClear,
-            .storeOp        = vk::AttachmentStoreOp::eStore,
-            .stencilLoadOp  = vk::AttachmentLoadOp::eDontCare,
-            .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
-            .initialLayout  = vk::ImageLayout::eUndefined,
-            .finalLayout    = vk::ImageLayout::ePresentSrcKHR,
-        };
-
-        vk::AttachmentReference color_attachment_reference = {
-            .attachment = 0,
-            .layout     = vk::ImageLayout::eColorAttachmentOptimal,
-        };
-
-        vk::AttachmentDescription depth_attachment = {
-            .format         = depth_format,
-            .samples        = vk::SampleCountFlagBits::e1,
-            .loadOp         = vk::AttachmentLoadOp::eClear,
-            .storeOp        = vk::AttachmentStoreOp::eDontCare,
-            .stencilLoadOp  = vk::AttachmentLoadOp::eDontCare,
-            .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
-            .initialLayout  = vk::ImageLayout::eUndefined,
-            .finalLayout    = vk::ImageLayout::eDepthStencilAttachmentOptimal,
-        };
-
-        vk::AttachmentReference depth_attachment_reference = {
-            .attachment = 1,
-            .layout     = vk::ImageLayout::eDepthStencilAttachmentOptimal,
-        };
+                                                               vk::FormatFeatureFlagBits::eDepthStencilAttachment
+                                                                   | vk::FormatFeatureFlagBits::eSampledImage);
 
-        std::array<vk::AttachmentDescription, 2> attachment_descriptions = {
-            color_attachment,
-            depth_attachment,
-        };
-
-        vk::SubpassDescription subpass_description = {
-            .pipelineBindPoint       = vk::PipelineBindPoint::eGraphics,
-            .colorAttachmentCount    = 1,
-            .pColorAttachments       = &color_attachment_reference,
-            .pDepthStencilAttachment = &depth_attachment_reference,
-        };
-
-        using vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-        using vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eEarlyFragmentTests;
-
-        vk::SubpassDependency subpass = {
-            .srcSubpass    = vk::SubpassExternal,
-            .dstSubpass    = 0,
-            .srcStageMask  = eColorAttachmentOutput | eEarlyFragmentTests,
-            .dstStageMask  = eColorAttachmentOutput | eEarlyFragmentTests,
-            .srcAccessMask = vk::AccessFlagBits::eNone,
-            .dstAccessMask = eColorAttachmentWrite | eDepthStencilAttachmentWrite,
-        };
+        // The scene is upscaled to the swapchain image by a blit, which filters linearly where the format allows it
+        vk::FormatProperties   properties = m_device_manager->physical_device.getFormatProperties(configuration.format);
+        vk::FormatFeatureFlags features   = properties.optimalTilingFeatures;
+        if (!(features & vk::FormatFeatureFlagBits::eBlitSrc) || !(features & vk::FormatFeatureFlagBits::eBlitDst))
+            throw Exception(fmt::format("Swapchain format {} cannot be blitted", vk::to_string(configuration.format)));
 
-        vk::RenderPassCreateInfo render_pass_create_info = {
-            .attachmentCount = attachment_descriptions.size(),
-            .pAttachments    = attachment_descriptions.data(),
-            .subpassCount    = 1,
-            .pSubpasses      = &subpass_description,
-            .dependencyCount = 1,
-            .pDependencies   = &subpass,
-        };
+        bool linear      = bool(features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+        m_upscale_filter = linear ? vk::Filter::eLinear : vk::Filter::eNearest;
+    }
 
-        render_pass = m_device.createRenderPass(render_pass_create_info);
+    void SwapchainManager::init_swapchain(std::shared_ptr<VulkanAllocator> allocator)
+    {
+        m_allocator = std::move(allocator);
 
+        create_swapchain();
         get_swapchain_images();
     }
 
@@ -151,16 +133,13 @@ namespace engine
     {
         destroy_swapchain();
 
-        if (render_pass)
-            m_device.destroyRenderPass(render_pass);
-
         if (swapchain)
             m_device.destroySwapchainKHR(swapchain);
 
         images.clear();
+        m_allocator = nullptr;
 
         swapchain        = nullptr;
-        render_pass      = nullptr;
         m_device         = nullptr;
         m_surface        = nullptr;
         m_device_manager = nullptr;
@@ -174,6 +153,15 @@ namespace engine
 
         bool same_queues = queue_families[0] == queue_families[1];
 
+        // Swapchain images are only written by the blit which upscales the scene
+        constexpr vk::ImageUsageFlags IMAGE_USAGE = vk::ImageUsageFlagBits::eColorAttachment
+                                                  | vk::ImageUsageFlagBits::eTransferDst;
+
+        vk::ImageUsageFlags supported = swapchain_support_details.capabilities.supportedUsageFlags;
+        if ((supported & IMAGE_USAGE) != IMAGE_USAGE)
+            throw Exception(fmt::format("Swapchain images only support {}, but {} is needed", vk::to_string(supported),
+                                        vk::to_string(IMAGE_USAGE)));
+
         vk::SwapchainCreateInfoKHR swapchain_create_info = {
             .surface               = m_surface,
             .minImageCount         = configuration.image_count,
@@ -181,7 +169,7 @@ namespace engine
             .imageColorSpace       = configuration.color_space,
             .imageExtent           = configuration.extent,
             .imageArrayLayers      = configuration.image_layers,
-            .imageUsage            = vk::ImageUsageFlagBits::eColorAttachment,
+            .imageUsage            = IMAGE_USAGE,
             .imageSharingMode      = same_queues ? vk::SharingMode::eExclusive : vk::SharingMode::eConcurrent,
             .queueFamilyIndexCount = same_queues ? 0u : 2u,
             .pQueueFamilyIndices   = same_queues ? nullptr : queue_families,
@@ -191,12 +179,8 @@ namespace engine
             .clipped               = true,
             .oldSwapchain          = swapchain, // Should be NULL for the first call
         };
-        vk::SwapchainKHR old_swapchain = swapchain;
-
+        // The old swapchain is retired by the caller
         swapchain = m_device.createSwapchainKHR(swapchain_create_info);
-
-        if (old_swapchain)
-            m_device.destroySwapchainKHR(old_swapchain);
     }
 
     void SwapchainManager::get_swapchain_images()
@@ -204,9 +188,6 @@ namespace engine
         auto image_handles = m_device.getSwapchainImagesKHR(swapchain);
         images.resize(image_handles.size());
 
-        // TODO: create allocator and create depth attachments
-        auto allocator = VulkanAllocator::new_shared(m_device_manager);
-
         for (size_t i = 0; i < image_handles.size(); ++i) {
             vk::ImageViewCreateInfo create_info = {
                 .image            = image_handles[i],
@@ -223,42 +204,267 @@ namespace engine
                                      .layerCount     = configuration.image_layers},
             };
 
-            images[i].color.handle = image_handles[i];
-            images[i].color.view   = m_device.createImageView(create_info);
+            images[i].color.handle    = image_handles[i];
+            images[i].color.view      = m_device.createImageView(create_info);
+            images[i].render_finished = m_device.createSemaphore(vk::SemaphoreCreateInfo {});
+        }
+    }
 
-            ImageAllocationInfo iainfo = {
-                .usage  = vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                .width  = configuration.extent.width,
-                .height = configuration.extent.height,
-                .format = depth_format,
-            };
-            iainfo.view_subresource_range.aspectMask = vk::ImageAspectFlagBits::eDepth;
+    AttachmentFormats SwapchainManager::formats() const noexcept
+    {
+        return AttachmentFormats {.color = configuration.format, .depth = depth_format};
+    }
 
-            images[i].depth = ImageAllocation(allocator, iainfo);
+    AttachmentFormats SwapchainManager::overlay_formats() const noexcept
+    {
+        return AttachmentFormats {.color = configuration.format, .depth = vk::Format::eUndefined};
+    }
 
-            std::array<vk::ImageView, 2> attachments = {
-                images[i].color,
-                images[i].depth,
-            };
+    /// Whole of a single layer color image
+    static constexpr vk::ImageSubresourceRange COLOR_RANGE = {
+        .aspectMask     = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel   = 0,
+        .levelCount     = 1,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+    };
 
-            vk::FramebufferCreateInfo framebuffer_create_info = {
-                .renderPass      = render_pass,
-                .attachmentCount = attachments.size(),
-                .pAttachments    = attachments.data(),
-                .width           = configuration.extent.width,
-                .height          = configuration.extent.height,
-                .layers          = configuration.image_layers,
-            };
+    void SwapchainManager::begin_rendering(vk::CommandBuffer cmd, uint32_t frame, vk::Extent2D extent, bool resume)
+    {
+        using vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eEarlyFragmentTests,
+            vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eTransfer;
+        using vk::AccessFlagBits::eColorAttachmentRead, vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::AccessFlagBits::eDepthStencilAttachmentRead, vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+        SceneTargets &scene = targets(frame);
+
+        // Cleared attachments discard their contents. Resumed ones are as `end_rendering` left them.
+        using vk::ImageLayout::eUndefined;
+        vk::ImageLayout color_layout = resume ? vk::ImageLayout::eTransferSrcOptimal : eUndefined;
+        vk::ImageLayout depth_layout = resume ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : eUndefined;
+
+        std::array<vk::ImageMemoryBarrier, 2> barriers = {
+            vk::ImageMemoryBarrier {
+                .srcAccessMask       = vk::AccessFlagBits::eNone,
+                .dstAccessMask       = eColorAttachmentRead | eColorAttachmentWrite,
+                .oldLayout           = color_layout,
+                .newLayout           = vk::ImageLayout::eColorAttachmentOptimal,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image               = scene.color.image,
+                .subresourceRange    = COLOR_RANGE,
+            },
+            vk::ImageMemoryBarrier {
+                .srcAccessMask       = resume ? eDepthStencilAttachmentWrite : vk::AccessFlagBits::eNone,
+                .dstAccessMask       = eDepthStencilAttachmentRead | eDepthStencilAttachmentWrite,
+                .oldLayout           = depth_layout,
+                .newLayout           = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image               = scene.depth.image,
+                .subresourceRange    = depth_range(depth_format),
+            },
+        };
 
-            images[i].handle = m_device.createFramebuffer(framebuffer_create_info);
-        }
+        // The last frame using the targets may still be building the pyramid from the depth or upscaling the color
+        cmd.pipelineBarrier(eColorAttachmentOutput | eLateFragmentTests | eComputeShader | eTransfer,
+                            eColorAttachmentOutput | eEarlyFragmentTests | eLateFragmentTests, {}, {}, {}, barriers);
+
+        vk::AttachmentLoadOp load = resume ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+
+        vk::RenderingAttachmentInfo color = {
+            .imageView   = scene.color.view,
+            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+            .loadOp      = load,
+            .storeOp     = vk::AttachmentStoreOp::eStore,
+            .clearValue  = vk::ClearColorValue(std::array<float, 4> {0.0f, 0.0f, 0.0f, 1.0f}),
+        };
+        vk::RenderingAttachmentInfo depth_attachment = {
+            .imageView   = scene.depth.view,
+            .imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            .loadOp      = load,
+            .storeOp     = vk::AttachmentStoreOp::eStore,
+            .clearValue  = vk::ClearDepthStencilValue {1.0f, 0},
+        };
+
+        cmd.beginRendering(vk::RenderingInfo {
+            .renderArea           = {.offset = {0, 0}, .extent = extent},
+            .layerCount           = 1,
+            .colorAttachmentCount = 1,
+            .pColorAttachments    = &color,
+            .pDepthAttachment     = &depth_attachment,
+        });
+    }
+
+    void SwapchainManager::end_rendering(vk::CommandBuffer cmd, uint32_t frame)
+    {
+        cmd.endRendering();
+
+        SceneTargets &scene = m_targets[frame];
+
+        std::array<vk::ImageMemoryBarrier, 2> barriers = {
+            vk::ImageMemoryBarrier {
+                .srcAccessMask       = vk::AccessFlagBits::eColorAttachmentWrite,
+                .dstAccessMask       = vk::AccessFlagBits::eTransferRead,
+                .oldLayout           = vk::ImageLayout::eColorAttachmentOptimal,
+                .newLayout           = vk::ImageLayout::eTransferSrcOptimal,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image               = scene.color.image,
+                .subresourceRange    = COLOR_RANGE,
+            },
+            // The depth is read by the occlusion culling pyramid
+            vk::ImageMemoryBarrier {
+                .srcAccessMask       = vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+                .dstAccessMask       = vk::AccessFlagBits::eShaderRead,
+                .oldLayout           = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                .newLayout           = vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image               = scene.depth.image,
+                .subresourceRange    = depth_range(depth_format),
+            },
+        };
+
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                | vk::PipelineStageFlagBits::eLateFragmentTests,
+                            vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, {},
+                            {}, barriers);
+    }
+
+    void SwapchainManager::begin_overlay(vk::CommandBuffer cmd, uint32_t image, uint32_t frame, vk::Extent2D extent)
+    {
+        vk::ImageSubresourceRange range = {
+            .aspectMask     = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = configuration.image_layers,
+        };
+
+        // The image was acquired before the frame's commands began, and its contents are replaced
+        vk::ImageMemoryBarrier acquired = {
+            .srcAccessMask       = vk::AccessFlagBits::eNone,
+            .dstAccessMask       = vk::AccessFlagBits::eTransferWrite,
+            .oldLayout           = vk::ImageLayout::eUndefined,
+            .newLayout           = vk::ImageLayout::eTransferDstOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image               = images[image].color,
+            .subresourceRange    = range,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+                            {}, {}, {}, acquired);
+
+        vk::Extent2D                full        = configuration.extent;
+        std::array<vk::Offset3D, 2> source      = {vk::Offset3D {0, 0, 0},
+                                                   vk::Offset3D {int32_t(extent.width), int32_t(extent.height), 1}};
+        std::array<vk::Offset3D, 2> destination = {vk::Offset3D {0, 0, 0},
+                                                   vk::Offset3D {int32_t(full.width), int32_t(full.height), 1}};
+
+        vk::ImageBlit region = {
+            .srcSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+            .srcOffsets     = source,
+            .dstSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+            .dstOffsets     = destination,
+        };
+        cmd.blitImage(m_targets[frame].color.image, vk::ImageLayout::eTransferSrcOptimal, images[image].color,
+                      vk::ImageLayout::eTransferDstOptimal, region, m_upscale_filter);
+
+        vk::ImageMemoryBarrier upscaled = {
+            .srcAccessMask       = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask       = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+            .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout           = vk::ImageLayout::eColorAttachmentOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image               = images[image].color,
+            .subresourceRange    = range,
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            {}, {}, {}, upscaled);
+
+        vk::RenderingAttachmentInfo color = {
+            .imageView   = images[image].color,
+            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+            .loadOp      = vk::AttachmentLoadOp::eLoad,
+            .storeOp     = vk::AttachmentStoreOp::eStore,
+        };
+
+        cmd.beginRendering(vk::RenderingInfo {
+            .renderArea           = {.offset = {0, 0}, .extent = configuration.extent},
+            .layerCount           = configuration.image_layers,
+            .colorAttachmentCount = 1,
+            .pColorAttachments    = &color,
+        });
+    }
+
+    void SwapchainManager::end_overlay(vk::CommandBuffer cmd, uint32_t image)
+    {
+        cmd.endRendering();
+
+        vk::ImageMemoryBarrier present = {
+            .srcAccessMask       = vk::AccessFlagBits::eColorAttachmentWrite,
+            .dstAccessMask       = vk::AccessFlagBits::eNone,
+            .oldLayout           = vk::ImageLayout::eColorAttachmentOptimal,
+            .newLayout           = vk::ImageLayout::ePresentSrcKHR,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image               = images[image].color,
+            .subresourceRange    = {.aspectMask     = vk::ImageAspectFlagBits::eColor,
+                                    .baseMipLevel   = 0,
+                                    .levelCount     = 1,
+                                    .baseArrayLayer = 0,
+                                    .layerCount     = configuration.image_layers},
+        };
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, present);
+    }
+
+    ImageAllocation &SwapchainManager::depth(uint32_t frame)
+    {
+        return targets(frame).depth;
+    }
+
+    SceneTargets &SwapchainManager::targets(uint32_t frame)
+    {
+        SceneTargets &scene = m_targets[frame];
+        if (scene.color.image)
+            return scene;
+
+        ImageAllocationInfo color = {
+            .usage  = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+            .width  = configuration.extent.width,
+            .height = configuration.extent.height,
+            .format = configuration.format,
+        };
+
+        // Sampled to build the occlusion culling pyramid, so it cannot be a transient attachment
+        ImageAllocationInfo depth = {
+            .usage  = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
+            .width  = configuration.extent.width,
+            .height = configuration.extent.height,
+            .format = depth_format,
+        };
+        depth.view_subresource_range.aspectMask = vk::ImageAspectFlagBits::eDepth;
+
+        scene.color = ImageAllocation(m_allocator, color);
+        scene.depth = ImageAllocation(m_allocator, depth);
+        return scene;
     }
 
     void SwapchainManager::destroy_swapchain()
+    {
+        destroy_images(m_device, images);
+        m_targets = {};
+    }
+
+    void SwapchainManager::destroy_images(vk::Device device, std::vector<SwapchainImage> &images)
     {
         for (auto &image : images) {
-            m_device.destroyFramebuffer(image.handle);
-            m_device.destroyImageView(image.color);
+            device.destroyImageView(image.color);
+            device.destroySemaphore(image.render_finished);
         }
 
         images.clear();
@@ -274,7 +480,7 @@ namespace engine
         return swapchain;
     }
 
-    Framebuffer &SwapchainManager::operator[](size_t i)
+    SwapchainImage &SwapchainManager::operator[](size_t i)
     {
         return images[i];
     }
@@ -0,0 +1,121 @@
+#include "backend/timeline.hpp"
+#include "exceptions.hpp"
+#include <limits>
+#include <vector>
+
+using std::span, std::vector;
+
+namespace engine
+{
+    void Timeline::init(vk::Device device)
+    {
+        vk::SemaphoreTypeCreateInfo type = {
+            .semaphoreType = vk::SemaphoreType::eTimeline,
+            .initialValue  = 0,
+        };
+
+        m_device    = device;
+        m_semaphore = device.createSemaphore(vk::SemaphoreCreateInfo {.pNext = &type});
+        m_submitted = 0;
+        m_completed = 0;
+    }
+
+    void Timeline::destroy()
+    {
+        if (m_semaphore)
+            m_device.destroySemaphore(m_semaphore);
+
+        m_semaphore = nullptr;
+        m_device    = nullptr;
+    }
+
+    uint64_t Timeline::submit(vk::Queue queue, span<const vk::SubmitInfo> batches)
+    {
+        size_t count = batches.size();
+
+        vector<vk::SubmitInfo>                  infos(batches.begin(), batches.end());
+        vector<vk::TimelineSemaphoreSubmitInfo> timelines(count);
+        vector<vector<vk::Semaphore>>           signals(count);
+        vector<vector<uint64_t>>                values(count);
+
+        std::lock_guard lock(m_submit);
+
+        uint64_t first = m_submitted + 1;
+        for (size_t i = 0; i < count; ++i) {
+            vk::SubmitInfo &info = infos[i];
+
+            // Binary semaphores ignore their values
+            signals[i].assign(info.pSignalSemaphores, info.pSignalSemaphores + info.signalSemaphoreCount);
+            signals[i].push_back(m_semaphore);
+            values[i].assign(info.signalSemaphoreCount, 0);
+            values[i].push_back(first + i);
+
+            timelines[i] = vk::TimelineSemaphoreSubmitInfo {
+                .pNext                     = info.pNext,
+                .signalSemaphoreValueCount = (uint32_t)values[i].size(),
+                .pSignalSemaphoreValues    = values[i].data(),
+            };
+
+            info.pNext                = &timelines[i];
+            info.signalSemaphoreCount = (uint32_t)signals[i].size();
+            info.pSignalSemaphores    = signals[i].data();
+        }
+
+        if (count > 0)
+            queue.submit(infos);
+
+        m_submitted = first + count - 1;
+        return first + count - 1;
+    }
+
+    uint64_t Timeline::submitted() const noexcept
+    {
+        return m_submitted;
+    }
+
+    uint64_t Timeline::completed() const noexcept
+    {
+        return m_completed;
+    }
+
+    uint64_t Timeline::poll()
+    {
+        complete(m_device.getSemaphoreCounterValue(m_semaphore));
+        return m_completed;
+    }
+
+    bool Timeline::reached(uint64_t value)
+    {
+        return value <= m_completed || value <= poll();
+    }
+
+    void Timeline::wait(uint64_t value)
+    {
+        if (reached(value))
+            return;
+
+        vk::SemaphoreWaitInfo info = {
+            .semaphoreCount = 1,
+            .pSemaphores    = &m_semaphore,
+            .pValues        = &value,
+        };
+
+        vk::Result result = m_device.waitSemaphores(info, std::numeric_limits<uint64_t>::max());
+        if (result != vk::Result::eSuccess)
+            throw VulkanException((uint32_t)result, "Failed to wait on the timeline");
+
+        complete(value);
+    }
+
+    vk::Semaphore Timeline::semaphore() const noexcept
+    {
+        return m_semaphore;
+    }
+
+    void Timeline::complete(uint64_t value) noexcept
+    {
+        // Values may be read concurrently, and an older one must not replace a newer one
+        uint64_t current = m_completed;
+        while (current < value && !m_completed.compare_exchange_weak(current, value)) { }
+    }
+} // namespace engine
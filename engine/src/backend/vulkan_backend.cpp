@@ -7,10 +7,13 @@
 #include "backend/vertex_description.hpp"
 #include "constants.hpp"
 #include "exceptions.hpp"
+#include "jobs/task_graph.hpp"
 #include "logger.hpp"
 #include "window.hpp"
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <fmt/format.h>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <limits>
@@ -24,7 +27,8 @@
 #include "shaders.hpp"
 
 using std::swap, std::string_view, std::vector, std::shared_ptr, std::stringstream, std::span, std::tuple,
-    std::numeric_limits, std::clamp, std::min, std::array, std::optional, std::nullopt, std::array;
+    std::numeric_limits, std::clamp, std::min, std::array, std::optional, std::nullopt, std::array,
+    std::chrono::steady_clock;
 
 using engine::PipelineConfiguration;
 
@@ -123,11 +127,16 @@ namespace engine
         return formats[0];
     }
 
-    static vk::PresentModeKHR select_present_mode(span<const vk::PresentModeKHR> modes)
+    /// Weight of each new sample in the average latency of a present policy
+    static constexpr double LATENCY_SMOOTHING = 0.05;
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    static vk::PresentModeKHR select_present_mode(span<const vk::PresentModeKHR> modes, PresentPolicy policy)
     {
-        for (auto mode : modes)
-            if (mode == vk::PresentModeKHR::eMailbox)
-                return mode;
+        for (auto preferred : present_settings(policy).modes)
+            if (std::find(modes.begin(), modes.end(), preferred) != modes.end())
+                return preferred;
 
         return vk::PresentModeKHR::eFifo;
     }
@@ -147,8 +156,10 @@ namespace engine
         }
     }
 
-    VulkanBackend::VulkanBackend(string_view application_name, Version application_version, GLFWwindow *window)
+    VulkanBackend::VulkanBackend(string_view application_name, Version application_version, GLFWwindow *window,
+                                 JobSystem::Shared job_system, const StartupTask &overlay)
         : m_logger(get_logger())
+        , m_job_system(std::move(job_system))
         , m_window(window)
     {
         m_instance_manager = VulkanInstanceManager::new_shared(application_name, application_version);
@@ -170,14 +181,15 @@ namespace engine
         m_graphics_queue = m_device_manager->graphics_queue.handle;
         m_present_queue  = m_device_manager->present_queue.handle;
 
-        create_pipeline();
+        create_pipeline(overlay);
     }
 
-    VulkanBackend::VulkanBackend(const VulkanBackend &other, GLFWwindow *window)
+    VulkanBackend::VulkanBackend(const VulkanBackend &other, GLFWwindow *window, const StartupTask &overlay)
         : m_logger(other.m_logger)
         , m_window(window)
         , m_instance_manager(other.m_instance_manager)
         , m_device_manager(other.m_device_manager)
+        , m_job_system(other.m_job_system)
         , m_device(other.m_device)
         , m_graphics_queue(other.m_graphics_queue)
         , m_present_queue(other.m_present_queue)
@@ -188,13 +200,23 @@ namespace engine
         if (!SwapchainSupportDetails::supported(m_device_manager->physical_device, m_surface))
             throw Exception("The device passed does not support this surface");
 
-        create_pipeline();
+        create_pipeline(overlay);
     }
 
     VulkanBackend::~VulkanBackend()
     {
+        m_retired.flush();
+
+        // Outstanding compilations use the pipeline layout
+        m_pipelines.destroy();
+
+        m_occlusion.destroy();
+
         m_swapchain.destroy();
 
+        if (m_timestamps)
+            m_device.destroyQueryPool(m_timestamps);
+
         m_staging_buffer.deinit(m_device, m_command_pool.get_pool(), *m_allocator);
 
         m_descriptor_pool.destroy();
@@ -202,9 +224,6 @@ namespace engine
         for (auto &frame_set : m_frame_sets)
             frame_set.sync.destroy(m_device);
 
-        if (m_gouraud_pipeline)
-            m_device.destroyPipeline(m_gouraud_pipeline);
-
         m_command_pool.destroy();
 
         if (m_pipeline_layout)
@@ -240,36 +259,64 @@ namespace engine
     }
 
     VulkanBackend::Unique VulkanBackend::new_unique(string_view application_name, Version application_version,
-                                                    GLFWwindow *window)
+                                                    GLFWwindow *window, JobSystem::Shared job_system,
+                                                    StartupTask overlay)
     {
-        return Unique(new VulkanBackend(application_name, application_version, window));
+        return Unique(
+            new VulkanBackend(application_name, application_version, window, std::move(job_system), overlay));
     }
 
-    VulkanBackend::Unique VulkanBackend::new_from(const VulkanBackend &other, GLFWwindow *window)
+    VulkanBackend::Unique VulkanBackend::new_from(const VulkanBackend &other, GLFWwindow *window, StartupTask overlay)
     {
-        return Unique(new VulkanBackend(other, window));
+        return Unique(new VulkanBackend(other, window, overlay));
     }
 
     void VulkanBackend::wait_idle()
     {
         m_device.waitIdle();
+
+        // Everything submitted has finished, so destructions waiting on the next submission need not wait for one
+        Timeline &timeline = m_device_manager->timeline;
+        m_retired.stamp(timeline.submitted());
+        m_retired.collect(timeline.poll());
     }
 
-    void VulkanBackend::create_pipeline()
+    void VulkanBackend::create_pipeline(const StartupTask &overlay)
     {
-        create_swapchain();
-        load_shaders();
-        create_descriptor_set_layout();
-        create_render_pipeline();
-        create_command_pool();
-        create_descriptor_pools();
-        initialize_frame_sets();
-        initialize_device_memory_allocator();
+        // Selecting the extent may query GLFW, which is only allowed on the main thread.
+        SwapchainConfiguration swapchain_config = select_swapchain_configuration();
+
+        m_pipelines.init(m_device, m_job_system);
+
+        TaskGraph graph = {};
+
+        // The swapchain creates its scene targets through the shared allocator, and the frame sets and staging buffer
+        // both allocate from the command pool, which is externally synchronized.
+        auto allocator  = graph.add("Device memory allocator", [&]() { initialize_device_memory_allocator(); });
+        auto formats    = graph.add("Attachment formats", [&]() { select_formats(swapchain_config); });
+        auto shaders    = graph.add("Shader modules", [&]() { load_shaders(); });
+        auto layout     = graph.add("Descriptor set layout", [&]() { create_descriptor_set_layout(); });
+        auto cmd_pool   = graph.add("Command pool", [&]() { create_command_pool(); });
+        auto desc_pool  = graph.add("Descriptor pool", [&]() { create_descriptor_pools(); });
+        auto frame_sets = graph.add("Frame sets", [&]() { initialize_frame_sets(); }, {cmd_pool, desc_pool, layout});
+
+        graph.add("Swapchain", [&]() { create_swapchain(); }, {formats, allocator});
+        graph.add("Graphics pipeline", [&]() { create_render_pipeline(); }, {shaders, layout, formats});
+        graph.add("Uniform buffers", [&]() { finalize_init(); }, {allocator});
 
-        finalize_init();
+        // The occlusion culler allocates from the command pool too
+        auto staging = graph.add("Staging buffer", [&]() { initialize_staging_buffer(); }, {allocator, frame_sets});
+        graph.add("Occlusion culling", [&]() { m_occlusion.init(*this); }, {staging, allocator});
+
+        // The overlay only needs the swapchain's format, and compiles its own pipelines alongside the backend's
+        if (overlay)
+            graph.add("Overlay", [&]() { overlay(*this); }, {formats});
+
+        graph.run(*m_job_system);
+        graph.log_timeline(*m_logger, "Backend startup");
     }
 
-    bool VulkanBackend::recreate_swapchain()
+    SwapchainConfiguration VulkanBackend::select_swapchain_configuration()
     {
         auto swapchain_support_details = SwapchainSupportDetails::query(m_device_manager->physical_device, m_surface);
 
@@ -279,39 +326,42 @@ namespace engine
 
         auto format = select_format(swapchain_support_details.formats);
 
-        SwapchainConfiguration config {
+        return SwapchainConfiguration {
             .format       = format.format,
             .color_space  = format.colorSpace,
-            .present_mode = select_present_mode(swapchain_support_details.modes),
+            .present_mode = select_present_mode(swapchain_support_details.modes, m_present_policy),
             .extent       = select_extent(swapchain_support_details.capabilities, m_window),
             .image_count  = image_count,
             .image_layers = 1,
         };
-
-        return m_swapchain.recreate_swapchain(config);
-        m_logger->info("Recreated swapchain");
     }
 
-    void VulkanBackend::create_swapchain()
+    bool VulkanBackend::recreate_swapchain()
     {
-        auto swapchain_support_details = SwapchainSupportDetails::query(m_device_manager->physical_device, m_surface);
+        // Frames submitted so far may use the old swapchain, and the next one may still wait on its presentation
+        uint64_t retire = DeletionQueue::NEXT;
 
-        uint32_t image_count = swapchain_support_details.capabilities.minImageCount + 1;
-        if (auto max = swapchain_support_details.capabilities.maxImageCount)
-            image_count = min(image_count, max);
+        bool valid = m_swapchain.recreate_swapchain(select_swapchain_configuration(), m_retired, retire);
+        m_occlusion.resize(m_retired, retire);
 
-        auto format = select_format(swapchain_support_details.formats);
+        // Times measured at the old size do not predict those at the new one
+        dynamic_resolution.reset();
 
-        SwapchainConfiguration config {
-            .format       = format.format,
-            .color_space  = format.colorSpace,
-            .present_mode = select_present_mode(swapchain_support_details.modes),
-            .extent       = select_extent(swapchain_support_details.capabilities, m_window),
-            .image_count  = image_count,
-            .image_layers = 1,
-        };
+        if (valid)
+            m_logger->info("Recreated swapchain");
+
+        return valid;
+    }
+
+    void VulkanBackend::select_formats(const SwapchainConfiguration &config)
+    {
+        m_swapchain.init_formats(m_device_manager, m_surface, config);
+        m_logger->info("Selected depth format {}", vk::to_string(m_swapchain.depth_format));
+    }
 
-        m_swapchain.init(m_device_manager, m_surface, config);
+    void VulkanBackend::create_swapchain()
+    {
+        m_swapchain.init_swapchain(m_allocator);
         m_logger->info("Created swapchain");
     }
 
@@ -423,14 +473,49 @@ namespace engine
         pipeline_config.vertex_attribute_descriptions =
             vector(GOURAUD_VERTEX.attributes.begin(), GOURAUD_VERTEX.attributes.end());
 
-        auto config = pipeline_config.prepare(m_pipeline_layout, m_swapchain.render_pass);
+        auto config = pipeline_config.prepare(m_pipeline_layout, m_swapchain.formats());
 
-        auto [result, pipeline] = m_device.createGraphicsPipeline(nullptr, config);
+        auto [result, pipeline] = m_device.createGraphicsPipeline(m_pipelines.cache(), config);
         if (result != vk::Result::eSuccess)
             throw VulkanException((uint32_t)result, "Failed to create graphics pipeline");
         m_logger->info("Created graphics pipeline");
 
-        m_gouraud_pipeline = pipeline;
+        m_gouraud_pipeline      = pipeline;
+        m_gouraud_configuration = std::move(pipeline_config);
+
+        if (m_pipelines.add("Gouraud", m_gouraud_pipeline) != GOURAUD_PIPELINE)
+            throw Exception("The Gouraud pipeline must be the first pipeline registered");
+    }
+
+    PipelineId VulkanBackend::request_pipeline(string_view name, const PipelineConfiguration &config)
+    {
+        return m_pipelines.request(name, config, m_pipeline_layout, m_swapchain.formats(), GOURAUD_PIPELINE);
+    }
+
+    bool VulkanBackend::bind_pipeline(DrawingContext &context, PipelineId pipeline)
+    {
+        vk::Pipeline resolved = m_pipelines.get(pipeline);
+        if (!resolved)
+            return false;
+
+        if (resolved != context.bound_pipeline) {
+            context.cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, resolved);
+            context.bound_pipeline = resolved;
+        }
+
+        return true;
+    }
+
+    vk::DescriptorSet VulkanBackend::next_descriptor(DrawingContext &context)
+    {
+        if (context.used_descriptors < context.descriptors.size())
+            return context.descriptors[context.used_descriptors++];
+
+        if (!m_descriptors_exhausted) {
+            m_logger->warn("A frame draws more than {} meshes; the rest are skipped", MAX_DESCRIPTORS);
+            m_descriptors_exhausted = true;
+        }
+        return nullptr;
     }
 
     void VulkanBackend::create_command_pool()
@@ -440,30 +525,66 @@ namespace engine
 
     void VulkanBackend::initialize_frame_sets()
     {
-        auto cmd_buffers     = m_command_pool.get(MAX_IN_FLIGHT);
-        auto descriptor_sets = m_descriptor_pool.get(m_uniform_descriptor_layout, MAX_IN_FLIGHT * MAX_DESCRIPTORS);
+        grow_frame_sets(m_frames_in_flight);
+        create_timestamp_queries();
+    }
+
+    void VulkanBackend::create_timestamp_queries()
+    {
+        auto families = m_device_manager->physical_device.getQueueFamilyProperties();
+        auto bits     = families[m_device_manager->graphics_queue.index].timestampValidBits;
+        auto limits   = m_device_manager->physical_device.getProperties().limits;
+
+        if (bits == 0 || limits.timestampPeriod <= 0.0f) {
+            m_logger->warn("The graphics queue does not support timestamps, so GPU times are not measured");
+            return;
+        }
+
+        m_timestamp_mask   = bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        m_timestamp_period = limits.timestampPeriod;
+
+        // Sized for the most frame sets there can be, since they are created as the frames in flight grow
+        m_timestamps = m_device.createQueryPool(vk::QueryPoolCreateInfo {
+            .queryType  = vk::QueryType::eTimestamp,
+            .queryCount = MAX_IN_FLIGHT * 2,
+        });
+    }
+
+    void VulkanBackend::grow_frame_sets(size_t count)
+    {
+        size_t first = m_frame_sets.size();
+        if (count <= first)
+            return;
+
+        auto cmd_buffers     = m_command_pool.get(count - first);
+        auto descriptor_sets = m_descriptor_pool.get(m_uniform_descriptor_layout, (count - first) * MAX_DESCRIPTORS);
+
+        m_frame_sets.resize(count);
+        for (size_t i = first; i < count; ++i) {
+            FrameSet &set         = m_frame_sets[i];
+            auto      descriptors = descriptor_sets.data() + (i - first) * MAX_DESCRIPTORS;
 
-        m_frame_sets.resize(MAX_IN_FLIGHT);
-        for (size_t i = 0; i < MAX_IN_FLIGHT; ++i) {
-            m_frame_sets[i].command_buffer = cmd_buffers[i];
-            m_frame_sets[i].sync.init(m_device);
-            memcpy(m_frame_sets[i].descriptors.data(), descriptor_sets.data() + i * MAX_DESCRIPTORS, MAX_DESCRIPTORS);
+            set.command_buffer = cmd_buffers[i - first];
+            set.sync.init(m_device);
+            set.submitted = 0;
+            std::copy_n(descriptors, MAX_DESCRIPTORS, set.descriptors.data());
         }
     }
 
     void VulkanBackend::initialize_device_memory_allocator()
     {
-        m_allocator           = VulkanAllocator::new_shared(m_device_manager);
-        vk::CommandBuffer cmd = m_command_pool.get();
-        vk::Fence fence       = m_device.createFence(vk::FenceCreateInfo {.flags = vk::FenceCreateFlagBits::eSignaled});
+        m_allocator = VulkanAllocator::new_shared(m_device_manager);
+    }
 
-        m_staging_buffer.init(*m_allocator, cmd, fence);
+    void VulkanBackend::initialize_staging_buffer()
+    {
+        m_staging_buffer.init(*m_allocator, m_command_pool.get());
     }
 
     void VulkanBackend::finalize_init()
     {
-        m_vp_uniform = TypedHostVisibleBufferAllocation<ViewProjectionUniform[MAX_IN_FLIGHT]>(
-            m_allocator, vk::BufferUsageFlagBits::eUniformBuffer);
+        m_vp_uniform = TypedHostVisibleBufferAllocation<ViewProjectionUniform[]>(
+            m_allocator, m_frames_in_flight, vk::BufferUsageFlagBits::eUniformBuffer);
     }
 
     optional<DrawingContext> VulkanBackend::begin_draw()
@@ -475,12 +596,22 @@ namespace engine
             return nullopt;
         }
 
-        uint32_t  frame = m_frame_index;
-        FrameSet &set   = m_frame_sets[frame];
+        uint32_t  frame    = m_frame_index;
+        FrameSet &set      = m_frame_sets[frame];
+        Timeline &timeline = m_device_manager->timeline;
 
-        auto wait_result = m_device.waitForFences(set.sync.in_flight, true, TIMEOUT);
-        if (wait_result != vk::Result::eSuccess)
-            throw VulkanException((uint32_t)wait_result, "Failed to wait on fence");
+        auto start = steady_clock::now();
+
+        for (uint32_t i = 0; i < m_frames_in_flight; ++i) {
+            FrameSet &other = m_frame_sets[i];
+            if (i != frame && other.pending && timeline.reached(other.submitted))
+                finish_frame(other, start);
+        }
+
+        timeline.wait(set.submitted);
+
+        if (set.pending)
+            finish_frame(set, steady_clock::now());
 
         auto [ia_result, image_index] = m_device.acquireNextImageKHR(m_swapchain, TIMEOUT, set.sync.image_available);
         if (ia_result == vk::Result::eErrorOutOfDateKHR) {
@@ -489,17 +620,27 @@ namespace engine
         } else if (ia_result != vk::Result::eSuccess)
             throw VulkanException((uint32_t)ia_result, "Failed to acquire image");
 
-        m_device.resetFences(set.sync.in_flight);
+        measure_frame(start, steady_clock::now() - start);
+
+        set.started        = start;
+        set.started_policy = m_present_policy;
+        set.pending        = true;
+
+        vk::Extent2D render_extent = dynamic_resolution.extent(m_swapchain.configuration.extent);
 
         set.command_buffer.reset();
-        initialize_command_buffer(set.command_buffer, image_index);
+        initialize_command_buffer(set.command_buffer, frame, render_extent);
+        set.timed = bool(m_timestamps);
 
-        m_vp_uniform[frame] = {
+        // Built locally, since the uniform buffer may be slow to read back
+        ViewProjectionUniform vp = {
             .view       = m_camera,
             .projection = glm::perspectiveFovZO<float>(glm::radians(m_fov), m_swapchain.configuration.extent.width,
                                                        m_swapchain.configuration.extent.height, 0.1, 100.0),
         };
-        m_vp_uniform[frame].projection[1][1] *= -1.0f;
+        vp.projection[1][1] *= -1.0f;
+
+        m_vp_uniform[frame] = vp;
         m_vp_uniform.flush();
 
         vk::DescriptorBufferInfo dbi = {
@@ -514,59 +655,300 @@ namespace engine
             .used_descriptors      = 0,
             .frame_index           = frame,
             .swapchain_image_index = image_index,
+            .render_extent         = render_extent,
             .vp_buffer_info        = dbi,
+            .view_projection       = vp.projection * vp.view,
+            .camera_position       = glm::vec3(glm::inverse(m_camera)[3]),
             .cmd                   = set.command_buffer,
+            .bound_pipeline        = m_gouraud_pipeline,
+            .early_cmd             = nullptr,
+            .occlusion             = nullptr,
+            .occlusion_item        = 0,
+            .overlay               = false,
         };
     }
 
     void VulkanBackend::end_draw(DrawingContext &context)
     {
-        size_t    frame_index = context.frame_index;
-        uint32_t  image_index = context.swapchain_image_index;
-        FrameSet &set         = m_frame_sets[frame_index];
+        finish_draw(context);
 
-        set.command_buffer.endRenderPass();
-        set.command_buffer.end();
+        VulkanBackend *self = this;
+        submit_frames(span(&self, 1), span(&context, 1));
+    }
 
-        vk::PipelineStageFlags wait_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    void VulkanBackend::begin_overlay(DrawingContext &context)
+    {
+        if (context.overlay)
+            return;
 
-        vk::SubmitInfo submit = {
-            .waitSemaphoreCount   = 1,
-            .pWaitSemaphores      = &set.sync.image_available,
-            .pWaitDstStageMask    = &wait_stages,
-            .commandBufferCount   = 1,
-            .pCommandBuffers      = &set.command_buffer,
-            .signalSemaphoreCount = 1,
-            .pSignalSemaphores    = &set.sync.render_finished,
-        };
+        auto frame = uint32_t(context.frame_index);
 
-        m_graphics_queue.submit(submit, set.sync.in_flight);
+        m_swapchain.end_rendering(context.cmd, frame);
+
+        // Only the scene is timed: the blit to the swapchain image waits for it to be acquired, which includes the
+        // time spent waiting for presentation
+        if (m_timestamps)
+            context.cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_timestamps, frame * 2 + 1);
+
+        m_swapchain.begin_overlay(context.cmd, context.swapchain_image_index, frame, context.render_extent);
+        context.overlay = true;
+    }
+
+    void VulkanBackend::finish_draw(DrawingContext &context)
+    {
+        begin_overlay(context);
+        m_swapchain.end_overlay(context.cmd, context.swapchain_image_index);
+
+        context.cmd.end();
+    }
+
+    void VulkanBackend::submit_frames(span<VulkanBackend *const> backends, span<DrawingContext> contexts)
+    {
+        if (backends.empty())
+            return;
+
+        size_t count = backends.size();
+
+        vk::PipelineStageFlags              wait_stages     = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        vector<vk::SubmitInfo>              submits         = {};
+        vector<vk::SwapchainKHR>            swapchains      = {};
+        vector<vk::Semaphore>               render_finished = {};
+        vector<uint32_t>                    image_indices   = {};
+        vector<vk::Result>                  results(count, vk::Result::eSuccess);
+        vector<array<vk::CommandBuffer, 2>> command_buffers(count);
+
+        submits.reserve(count);
+        swapchains.reserve(count);
+        render_finished.reserve(count);
+        image_indices.reserve(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            FrameSet &set = backends[i]->m_frame_sets[contexts[i].frame_index];
+
+            // The occlusion culler's early phase runs before the frame's rendering
+            uint32_t cmd_count = 0;
+            if (contexts[i].early_cmd)
+                command_buffers[i][cmd_count++] = contexts[i].early_cmd;
+            command_buffers[i][cmd_count++] = set.command_buffer;
+
+            // Waited on by the image's presentation, which may outlive the frame set's submission
+            vk::Semaphore &finished = backends[i]->m_swapchain[contexts[i].swapchain_image_index].render_finished;
+
+            submits.push_back(vk::SubmitInfo {
+                .waitSemaphoreCount   = 1,
+                .pWaitSemaphores      = &set.sync.image_available,
+                .pWaitDstStageMask    = &wait_stages,
+                .commandBufferCount   = cmd_count,
+                .pCommandBuffers      = command_buffers[i].data(),
+                .signalSemaphoreCount = 1,
+                .pSignalSemaphores    = &finished,
+            });
+
+            swapchains.push_back(backends[i]->m_swapchain.swapchain);
+            render_finished.push_back(finished);
+            image_indices.push_back(contexts[i].swapchain_image_index);
+        }
+
+        // Each frame signals its own value, so that every frame set only waits for its own frame
+        Timeline &timeline = backends[0]->m_device_manager->timeline;
+        uint64_t  last     = timeline.submit(backends[0]->m_graphics_queue, submits);
+
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t value = last - (count - 1 - i);
+
+            backends[i]->m_frame_sets[contexts[i].frame_index].submitted = value;
+            backends[i]->m_retired.stamp(value);
+        }
 
         vk::PresentInfoKHR present = {
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores    = &set.sync.render_finished,
-            .swapchainCount     = 1,
-            .pSwapchains        = &m_swapchain.swapchain,
-            .pImageIndices      = &image_index,
-            .pResults           = nullptr,
+            .waitSemaphoreCount = (uint32_t)render_finished.size(),
+            .pWaitSemaphores    = render_finished.data(),
+            .swapchainCount     = (uint32_t)swapchains.size(),
+            .pSwapchains        = swapchains.data(),
+            .pImageIndices      = image_indices.data(),
+            .pResults           = results.data(),
         };
 
-        bool should_recreate_swapchain = false;
+        // Each swapchain's result is still written if one of them is out of date
         try {
-            should_recreate_swapchain = m_present_queue.presentKHR(present) == vk::Result::eSuboptimalKHR;
-        } catch (vk::OutOfDateKHRError) {
-            should_recreate_swapchain = true;
-        }
+            (void)backends[0]->m_present_queue.presentKHR(present);
+        } catch (vk::OutOfDateKHRError) { }
 
-        if (should_recreate_swapchain || m_framebuffer_resized) {
+        for (size_t i = 0; i < count; ++i)
+            backends[i]->advance_frame(results[i] == vk::Result::eSuboptimalKHR
+                                       || results[i] == vk::Result::eErrorOutOfDateKHR);
+    }
+
+    void VulkanBackend::advance_frame(bool out_of_date)
+    {
+        if (out_of_date || m_framebuffer_resized || m_policy_changed) {
             m_framebuffer_resized = false;
+            m_policy_changed      = false;
             recreate_swapchain();
         }
 
-        m_frame_index = ++m_frame_index % MAX_IN_FLIGHT;
+        m_pipelines.end_frame();
+
+        m_frame_index = ++m_frame_index % m_frames_in_flight;
+
+        bool measured   = m_balance_ready;
+        m_balance_ready = false;
+
+        if (auto_frames_in_flight && measured && m_balance.recommended != m_frames_in_flight) {
+            m_logger->info("Frames in flight: {} -> {} (CPU {:.2f} ms of {:.2f} ms, jitter {:.2f})",
+                           m_frames_in_flight, m_balance.recommended, m_balance.cpu_ms, m_balance.frame_ms,
+                           m_balance.cpu_jitter);
+            m_requested_frames = m_balance.recommended;
+        }
+
+        if (m_requested_frames != m_frames_in_flight)
+            resize_frames_in_flight(m_requested_frames);
+    }
+
+    uint32_t VulkanBackend::frames_in_flight() const noexcept
+    {
+        return m_frames_in_flight;
+    }
+
+    void VulkanBackend::set_frames_in_flight(uint32_t count)
+    {
+        m_requested_frames = clamp<uint32_t>(count, 1, MAX_IN_FLIGHT);
+    }
+
+    void VulkanBackend::resize_frames_in_flight(uint32_t count)
+    {
+        // Every frame set and uniform may be in use until then
+        wait_idle();
+
+        grow_frame_sets(count);
+        m_vp_uniform = TypedHostVisibleBufferAllocation<ViewProjectionUniform[]>(
+            m_allocator, count, vk::BufferUsageFlagBits::eUniformBuffer);
+
+        m_frames_in_flight = count;
+        m_frame_index      = 0;
+
+        // Frames finished while the device was drained, so their latency is unknown. Their GPU time is dropped too,
+        // since the frame sets are renumbered.
+        for (auto &set : m_frame_sets) {
+            set.pending = false;
+            set.timed   = false;
+        }
+
+        // The balance changes with the number of frames in flight, so it is measured again
+        m_window_sums   = {};
+        m_frame_start   = {};
+        m_balance_ready = false;
+    }
+
+    FrameBalance VulkanBackend::frame_balance() const noexcept
+    {
+        return m_balance;
+    }
+
+    PresentPolicy VulkanBackend::present_policy() const noexcept
+    {
+        return m_present_policy;
+    }
+
+    void VulkanBackend::set_present_policy(PresentPolicy policy)
+    {
+        if (policy == m_present_policy)
+            return;
+
+        PresentSettings settings = present_settings(policy);
+
+        m_present_policy   = policy;
+        m_policy_changed   = true;
+        m_requested_frames = clamp(m_frames_in_flight, settings.min_frames, settings.max_frames);
+    }
+
+    vk::PresentModeKHR VulkanBackend::present_mode() const noexcept
+    {
+        return m_swapchain.configuration.present_mode;
+    }
+
+    double VulkanBackend::present_latency(PresentPolicy policy) const noexcept
+    {
+        return m_latency_ms[size_t(policy)];
+    }
+
+    void VulkanBackend::finish_frame(FrameSet &set, steady_clock::time_point now)
+    {
+        m_retired.collect(m_device_manager->timeline.completed());
+
+        double  sample  = Milliseconds(now - set.started).count();
+        double &latency = m_latency_ms[size_t(set.started_policy)];
+
+        latency     = latency == 0.0 ? sample : latency + (sample - latency) * LATENCY_SMOOTHING;
+        set.pending = false;
+
+        if (!set.timed)
+            return;
+
+        set.timed = false;
+
+        // The frame has finished, so its timestamps are available without waiting
+        uint32_t first  = uint32_t(&set - m_frame_sets.data()) * 2;
+        auto     result = m_device.getQueryPoolResults<uint64_t>(m_timestamps, first, 2, 2 * sizeof(uint64_t),
+                                                                 sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (result.result != vk::Result::eSuccess)
+            return;
+
+        uint64_t ticks = (result.value[1] - result.value[0]) & m_timestamp_mask;
+        dynamic_resolution.update(double(ticks) * m_timestamp_period / 1e6);
+    }
+
+    void VulkanBackend::measure_frame(steady_clock::time_point start, steady_clock::duration wait)
+    {
+        // The wait at the start of a frame belongs to the period which it starts
+        if (m_frame_start != steady_clock::time_point {}) {
+            double frame_ms = Milliseconds(start - m_frame_start).count();
+            double wait_ms  = Milliseconds(m_frame_wait).count();
+            double cpu_ms   = std::max(frame_ms - wait_ms, 0.0);
+
+            m_window_sums.frames    += 1;
+            m_window_sums.frame_ms  += frame_ms;
+            m_window_sums.wait_ms   += wait_ms;
+            m_window_sums.cpu_ms    += cpu_ms;
+            m_window_sums.cpu_ms_sq += cpu_ms * cpu_ms;
+        }
+
+        m_frame_start = start;
+        m_frame_wait  = wait;
+
+        if (m_window_sums.frames < BALANCE_WINDOW)
+            return;
+
+        const BalanceWindow &sums = m_window_sums;
+
+        double n        = sums.frames;
+        double cpu_ms   = sums.cpu_ms / n;
+        double variance = std::max(sums.cpu_ms_sq / n - cpu_ms * cpu_ms, 0.0);
+
+        m_balance.frame_ms   = sums.frame_ms / n;
+        m_balance.wait_ms    = sums.wait_ms / n;
+        m_balance.cpu_ms     = cpu_ms;
+        m_balance.cpu_jitter = m_balance.frame_ms > 0.0 ? std::sqrt(variance) / m_balance.frame_ms : 0.0;
+
+        // Once at one frame in flight, the CPU time must grow further to leave it, so that it does not oscillate
+        double idle_fraction = m_frames_in_flight == 1 ? 0.2 : 0.1;
+
+        uint32_t recommended = 2;
+        if (m_balance.cpu_jitter > 0.25)
+            recommended = 4;
+        else if (m_balance.cpu_jitter > 0.1)
+            recommended = 3;
+        else if (cpu_ms < idle_fraction * m_balance.frame_ms)
+            recommended = 1;
+
+        PresentSettings settings = present_settings(m_present_policy);
+        m_balance.recommended    = clamp(recommended, settings.min_frames, settings.max_frames);
+
+        m_window_sums   = {};
+        m_balance_ready = true;
     }
 
-    void VulkanBackend::initialize_command_buffer(vk::CommandBuffer buffer, uint32_t image_index)
+    void VulkanBackend::initialize_command_buffer(vk::CommandBuffer buffer, uint32_t frame, vk::Extent2D extent)
     {
         vk::CommandBufferBeginInfo buffer_begin = {
             .flags            = {},
@@ -575,33 +957,26 @@ namespace engine
 
         buffer.begin(buffer_begin);
 
-        std::array<vk::ClearValue, 2> clear_values;
-        clear_values[0].color.setFloat32({0.0, 0.0, 0.0, 1.0});
-        clear_values[1].depthStencil = {1.0, 0};
-
-        vk::RenderPassBeginInfo render_pass_begin = {
-            .renderPass      = m_swapchain.render_pass,
-            .framebuffer     = m_swapchain[image_index],
-            .renderArea      = {.offset = {0, 0}, .extent = m_swapchain.configuration.extent},
-            .clearValueCount = clear_values.size(),
-            .pClearValues    = clear_values.data(),
-        };
-
         vk::Viewport viewport = {
             .x        = 0.0,
             .y        = 0.0,
-            .width    = (float)m_swapchain.configuration.extent.width,
-            .height   = (float)m_swapchain.configuration.extent.height,
+            .width    = (float)extent.width,
+            .height   = (float)extent.height,
             .minDepth = 0.0,
             .maxDepth = 1.0,
         };
 
         vk::Rect2D scissor = {
             .offset = {0, 0},
-            .extent = m_swapchain.configuration.extent,
+            .extent = extent,
         };
 
-        buffer.beginRenderPass(render_pass_begin, vk::SubpassContents::eInline);
+        if (m_timestamps) {
+            buffer.resetQueryPool(m_timestamps, frame * 2, 2);
+            buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_timestamps, frame * 2);
+        }
+
+        m_swapchain.begin_rendering(buffer, frame, extent, false);
         buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_gouraud_pipeline);
         buffer.setViewport(0, viewport);
         buffer.setScissor(0, scissor);
@@ -610,15 +985,8 @@ namespace engine
     void GpuSync::init(vk::Device device)
     {
         vk::SemaphoreCreateInfo sem = {};
-        vk::FenceCreateInfo     fen = {
-                .flags = vk::FenceCreateFlagBits::eSignaled,
-        };
 
         image_available = device.createSemaphore(sem);
-
-        render_finished = device.createSemaphore(sem);
-
-        in_flight = device.createFence(fen);
     }
 
     void GpuSync::destroy(vk::Device device)
@@ -626,15 +994,7 @@ namespace engine
         if (image_available)
             device.destroySemaphore(image_available);
 
-        if (render_finished)
-            device.destroySemaphore(render_finished);
-
-        if (in_flight)
-            device.destroyFence(in_flight);
-
         image_available = nullptr;
-        render_finished = nullptr;
-        in_flight       = nullptr;
     }
 
     void VulkanBackend::update_fov(float fov)
@@ -659,6 +1019,8 @@ namespace engine
 
         BufferAllocation allocation(m_allocator, total_bytes, BUFFER_USAGE);
 
+        Timeline &timeline = m_device_manager->timeline;
+
         // Transferring must be performed such that the writing buffer does not overflow.
 
         size_t buffer_off = 0; // Buffer offset
@@ -666,15 +1028,14 @@ namespace engine
 
         // Transfer vertex buffer
         while (rdbuff_off < vbuf_bytes) {
-            m_staging_buffer.wait(m_device);
-            m_staging_buffer.reset(m_device); // Lock fence
+            m_staging_buffer.wait(timeline);
 
             size_t bytes = std::min(vbuf_bytes - rdbuff_off, (size_t)StagingBuffer::SIZE);
             memcpy(m_staging_buffer, vertices.data() + rdbuff_off, bytes);
             rdbuff_off += bytes;
 
             m_staging_buffer.flush(*m_allocator, 0, bytes);
-            m_staging_buffer.transfer(allocation.buffer, m_graphics_queue, 0, buffer_off, bytes);
+            m_staging_buffer.transfer(allocation.buffer, timeline, m_graphics_queue, 0, buffer_off, bytes);
             buffer_off += bytes;
         }
 
@@ -682,21 +1043,27 @@ namespace engine
 
         // Transfer index buffer
         while (rdbuff_off < ibuf_bytes) {
-            m_staging_buffer.wait(m_device);
-            m_staging_buffer.reset(m_device); // Lock fence
+            m_staging_buffer.wait(timeline);
 
             size_t bytes = std::min(ibuf_bytes - rdbuff_off, (size_t)StagingBuffer::SIZE);
             memcpy(m_staging_buffer, indices.data() + rdbuff_off, bytes);
             rdbuff_off += bytes;
 
             m_staging_buffer.flush(*m_allocator, 0, bytes);
-            m_staging_buffer.transfer(allocation.buffer, m_graphics_queue, 0, buffer_off, bytes);
+            m_staging_buffer.transfer(allocation.buffer, timeline, m_graphics_queue, 0, buffer_off, bytes);
             buffer_off += bytes;
         }
 
-        m_staging_buffer.wait(m_device); // Wait for final transfer
+        m_staging_buffer.wait(timeline); // Wait for final transfer
+
+        // A single level of detail, bounded by every vertex
+        Aabb bounds = {};
+        for (const primitives::GouraudVertex &vertex : vertices)
+            bounds.expand(vertex.position);
 
-        return shared_ptr<GouraudMesh>(new GouraudMesh(std::move(allocation), 0, vbuf_bytes, indices.size()));
+        vector<MeshLod> lods = {MeshLod {.first = 0, .count = (uint32_t)indices.size()}};
+
+        return shared_ptr<GouraudMesh>(new GouraudMesh(std::move(allocation), 0, vbuf_bytes, std::move(lods), bounds));
     }
 
     VulkanBackend::StagingBuffer::operator uint8_t *()
@@ -704,7 +1071,7 @@ namespace engine
         return (uint8_t *)p_mapping;
     }
 
-    void VulkanBackend::StagingBuffer::init(VmaAllocator allocator, vk::CommandBuffer cmd, vk::Fence fence)
+    void VulkanBackend::StagingBuffer::init(VmaAllocator allocator, vk::CommandBuffer cmd)
     {
         vk::BufferCreateInfo bufc = {
             .size  = SIZE,
@@ -730,9 +1097,9 @@ namespace engine
         } else
             is_coherent = true;
 
-        p_mapping      = alloc_info.pMappedData;
-        this->cmd      = cmd;
-        transfer_fence = fence;
+        p_mapping = alloc_info.pMappedData;
+        this->cmd = cmd;
+        last_use  = 0;
     }
 
     void VulkanBackend::StagingBuffer::flush(VmaAllocator allocator, vk::DeviceSize offset, vk::DeviceSize length)
@@ -741,27 +1108,21 @@ namespace engine
             vmaFlushAllocation(allocator, alloc, offset, length);
     }
 
-    void VulkanBackend::StagingBuffer::transfer(vk::Buffer dst, vk::Queue queue, uint32_t src_offset,
-                                                uint32_t dst_offset, uint32_t size)
+    void VulkanBackend::StagingBuffer::transfer(vk::Buffer dst, Timeline &timeline, vk::Queue queue,
+                                                uint32_t src_offset, uint32_t dst_offset, uint32_t size)
     {
         cmd.reset();
         cmd.begin(vk::CommandBufferBeginInfo {});
         cmd.copyBuffer(buffer, dst, vk::BufferCopy {.srcOffset = src_offset, .dstOffset = dst_offset, .size = size});
         cmd.end();
 
-        queue.submit(vk::SubmitInfo {.commandBufferCount = 1, .pCommandBuffers = &cmd}, transfer_fence);
+        vk::SubmitInfo submit = {.commandBufferCount = 1, .pCommandBuffers = &cmd};
+        last_use              = timeline.submit(queue, span(&submit, 1));
     }
 
-    void VulkanBackend::StagingBuffer::reset(vk::Device device)
+    void VulkanBackend::StagingBuffer::wait(Timeline &timeline)
     {
-        device.resetFences(transfer_fence);
-    }
-
-    void VulkanBackend::StagingBuffer::wait(vk::Device device)
-    {
-        vk::Result result = device.waitForFences(transfer_fence, true, std::numeric_limits<uint64_t>::max());
-        if (result != vk::Result::eSuccess)
-            throw VulkanException((uint32_t)result, "Failed to wait on transfer fence");
+        timeline.wait(last_use);
     }
 
     void VulkanBackend::StagingBuffer::deinit(vk::Device device, vk::CommandPool cmd_pool, VmaAllocator allocator)
@@ -769,14 +1130,13 @@ namespace engine
         if (!buffer)
             return;
 
-        device.destroyFence(transfer_fence);
         device.freeCommandBuffers(cmd_pool, cmd);
         vmaDestroyBuffer(allocator, buffer, alloc);
-        transfer_fence = nullptr;
-        cmd            = nullptr;
-        buffer         = nullptr;
-        alloc          = nullptr;
-        is_coherent    = false;
-        p_mapping      = nullptr;
+        cmd         = nullptr;
+        buffer      = nullptr;
+        alloc       = nullptr;
+        last_use    = 0;
+        is_coherent = false;
+        p_mapping   = nullptr;
     }
 } // namespace engine
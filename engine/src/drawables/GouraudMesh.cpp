@@ -1,26 +1,71 @@
 #include "drawables/GouraudMesh.hpp"
 #include "backend/vulkan_backend.hpp"
 #include "drawables/drawing_context.hpp"
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <limits>
 
-using std::array;
+using std::array, std::vector;
 
 namespace engine
 {
-    GouraudMesh::GouraudMesh(BufferAllocation allocation, vk::DeviceSize vtx_off, vk::DeviceSize idx_off, uint32_t count)
+    /// Radius in pixels of the bounding sphere of `bounds` once transformed by `model`
+    static float projected_radius(const DrawingContext &context, const Aabb &bounds, const glm::mat4 &model)
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center(), 1.0f));
+        float     scale  = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+                                     glm::length(glm::vec3(model[2]))});
+        float     radius = glm::length(bounds.extent()) * 0.5f * scale;
+
+        float distance = glm::distance(center, context.camera_position);
+        if (distance <= radius)
+            return std::numeric_limits<float>::infinity();
+
+        // Measured in the pixels the scene is drawn at, so that lower resolutions pick coarser levels of detail
+        float half_height = context.render_extent.height * 0.5f;
+        return radius / (distance * std::tan(glm::radians(context.backend->m_fov) * 0.5f)) * half_height;
+    }
+
+    GouraudMesh::GouraudMesh(BufferAllocation allocation, vk::DeviceSize vtx_off, vk::DeviceSize idx_off,
+                             vector<MeshLod> lods, Aabb bounds)
         : allocation(std::move(allocation))
-        , model_matrix(this->allocation.allocator, vk::BufferUsageFlagBits::eUniformBuffer)
         , vtx_offset(vtx_off)
         , idx_offset(idx_off)
-        , count(count)
+        , lods(std::move(lods))
+        , bounds(bounds)
+        , transform()
+        , lod_tolerance(1.0f)
+        , lod_hysteresis(0.25f)
     { }
 
-    void GouraudMesh::draw(DrawingContext &context, const glm::mat4 &parent_transform)
+    void GouraudMesh::draw(DrawingContext &context, MeshInstance &instance, PipelineId pipeline, const glm::mat4 &model,
+                           uint64_t version)
     {
-        model_matrix[context.frame_index] = parent_transform * transform.get_transform_matrix();
-        model_matrix.flush();
+        if (lods.empty() || !context.backend->bind_pipeline(context, pipeline))
+            return;
+
+        glm::mat4 placed = model * glm::mat4(transform);
 
-        vk::DescriptorSet descriptor = context.descriptors[context.used_descriptors++];
+        vk::DescriptorSet descriptor = context.backend->next_descriptor(context);
+        if (!descriptor)
+            return;
+
+        instance.lod = select_lod(lods, projected_radius(context, bounds, placed), instance.lod, lod_tolerance,
+                                  lod_hysteresis);
+
+        const MeshLod &lod = lods[instance.lod];
+
+        auto &model_matrix = instance.model_matrix;
+        if (!model_matrix.buffer)
+            model_matrix = TypedHostVisibleBufferAllocation<glm::mat4[MAX_IN_FLIGHT]>(
+                context.backend->m_allocator, vk::BufferUsageFlagBits::eUniformBuffer);
+
+        if (version == 0 || instance.model_versions[context.frame_index] != version) {
+            model_matrix[context.frame_index] = placed;
+            model_matrix.flush();
+            instance.model_versions[context.frame_index] = version;
+        }
 
         array<vk::DescriptorBufferInfo, 2> dbi = {
             context.vp_buffer_info,
@@ -42,12 +87,27 @@ namespace engine
 
         context.backend->m_device.updateDescriptorSets(wds, {});
 
-        // context.cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, context.backend->m_gouraud_pipeline);
+        // The culler records the draw in both of its phases, and the GPU skips it while the mesh is occluded
+        if (context.occlusion) {
+            IndexedDraw draw = {
+                .pipeline      = context.bound_pipeline,
+                .descriptor    = descriptor,
+                .buffer        = allocation.buffer,
+                .vertex_offset = vtx_offset,
+                .index_offset  = idx_offset,
+                .index_count   = lod.count,
+                .first_index   = lod.first,
+            };
+
+            context.occlusion->draw_indexed(context, draw);
+            return;
+        }
+
         context.cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, context.backend->m_pipeline_layout, 0,
                                        descriptor, {});
         context.cmd.bindVertexBuffers(0, allocation.buffer, vtx_offset);
         context.cmd.bindIndexBuffer(allocation.buffer, idx_offset, vk::IndexType::eUint32);
-        context.cmd.drawIndexed(count, 1, 0, 0, 0);
+        context.cmd.drawIndexed(lod.count, 1, lod.first, 0, 0);
     }
 
     GouraudMesh::~GouraudMesh() { }
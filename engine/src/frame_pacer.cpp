@@ -0,0 +1,135 @@
+#include "frame_pacer.hpp"
+#include <algorithm>
+#include <thread>
+
+using std::chrono::duration_cast;
+using namespace std::chrono_literals;
+
+namespace engine
+{
+    /// Frames averaged by each measurement
+    static constexpr uint32_t STATISTICS_WINDOW = 120;
+    /// Weight of each new sample in the averages of frame durations and oversleeps
+    static constexpr double   SMOOTHING         = 0.1;
+    /// Spinning starts this many typical oversleeps before a deadline
+    static constexpr double   SPIN_MARGIN       = 2.0;
+    /// Spinning starts at least this long before a deadline
+    static constexpr auto     MIN_SPIN          = 200us;
+    /// With latency reduction, frames start early enough for this many times their typical duration
+    static constexpr double   WORK_MARGIN       = 1.25;
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    using Clock        = FramePacer::Clock;
+
+    static void smooth(double &average, double sample)
+    {
+        average = average == 0.0 ? sample : average + (sample - average) * SMOOTHING;
+    }
+
+    void FramePacer::begin_frame(Clock::duration period)
+    {
+        if (reduce_latency && period > Clock::duration::zero() && m_deadline != Clock::time_point {})
+            wait_until(m_deadline - duration_cast<Clock::duration>(Milliseconds(m_work_ms * WORK_MARGIN)));
+
+        m_frame_start = Clock::now();
+    }
+
+    void FramePacer::end_frame(Clock::duration period)
+    {
+        Clock::time_point now = Clock::now();
+        smooth(m_work_ms, Milliseconds(now - m_frame_start).count());
+
+        if (period == Clock::duration::zero())
+            m_deadline = {};
+        else {
+            if (m_deadline == Clock::time_point {})
+                m_deadline = now;
+            else if (!reduce_latency)
+                wait_until(m_deadline);
+
+            // A late frame starts a new period, rather than letting the following frames run early to catch up
+            m_deadline = std::max(m_deadline, Clock::now()) + period;
+        }
+
+        measure(Clock::now());
+    }
+
+    void FramePacer::reset()
+    {
+        m_deadline    = {};
+        m_frame_start = Clock::now();
+        m_last_end    = {};
+        m_sums        = {};
+    }
+
+    void FramePacer::pause()
+    {
+        m_deadline = {};
+        m_last_end = {};
+    }
+
+    FramePacer::Statistics FramePacer::statistics() const noexcept
+    {
+        return m_statistics;
+    }
+
+    void FramePacer::wait_until(Clock::time_point deadline)
+    {
+        Clock::time_point start = Clock::now();
+        if (deadline <= start)
+            return;
+
+        auto margin = duration_cast<Clock::duration>(Milliseconds(m_oversleep_ms * SPIN_MARGIN));
+        auto spin   = std::max<Clock::duration>(MIN_SPIN, margin);
+
+        if (deadline - start > spin) {
+            Clock::time_point wake = deadline - spin;
+            std::this_thread::sleep_until(wake);
+            smooth(m_oversleep_ms, std::max(Milliseconds(Clock::now() - wake).count(), 0.0));
+        }
+
+        Clock::time_point spin_start = Clock::now();
+        while (Clock::now() < deadline)
+            std::this_thread::yield();
+
+        Clock::time_point end = Clock::now();
+
+        m_sums.wait_ms += Milliseconds(end - start).count();
+        m_sums.spin_ms += Milliseconds(end - spin_start).count();
+    }
+
+    void FramePacer::measure(Clock::time_point end)
+    {
+        if (m_last_end != Clock::time_point {}) {
+            double frame_ms = Milliseconds(end - m_last_end).count();
+
+            m_sums.min_frame_ms = m_sums.frames == 0 ? frame_ms : std::min(m_sums.min_frame_ms, frame_ms);
+            m_sums.max_frame_ms = std::max(m_sums.max_frame_ms, frame_ms);
+
+            m_sums.frames      += 1;
+            m_sums.frame_ms    += frame_ms;
+            m_sums.frame_ms_sq += frame_ms * frame_ms;
+        }
+
+        m_last_end = end;
+
+        if (m_sums.frames < STATISTICS_WINDOW)
+            return;
+
+        double n    = m_sums.frames;
+        double mean = m_sums.frame_ms / n;
+
+        m_statistics = Statistics {
+            .frames         = m_sums.frames,
+            .frame_ms       = mean,
+            .frame_variance = std::max(m_sums.frame_ms_sq / n - mean * mean, 0.0),
+            .min_frame_ms   = m_sums.min_frame_ms,
+            .max_frame_ms   = m_sums.max_frame_ms,
+            .wait_ms        = m_sums.wait_ms / n,
+            .spin_ms        = m_sums.spin_ms / n,
+            .oversleep_ms   = m_oversleep_ms,
+        };
+
+        m_sums = {};
+    }
+} // namespace engine
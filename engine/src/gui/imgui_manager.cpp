@@ -18,6 +18,7 @@ namespace engine
         : m_device_manager(nullptr)
         , m_descriptor_pool()
         , mp_context(nullptr)
+        , m_formats()
     { }
 
     ImGuiManager::ImGuiManager(VulkanBackend &vk_backend, GLFWwindow *p_window)
@@ -32,12 +33,16 @@ namespace engine
 
     void ImGuiManager::init(VulkanBackend &backend, GLFWwindow *p_window)
     {
-        m_device_manager = backend.m_device_manager;
-        // Descriptor pool as used by imgui needs the `FreeDescriptorSet` flag bit set.
-        m_descriptor_pool.init(backend.m_device_manager, 64, vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
+        init_context(p_window);
+        init_renderer(backend);
+    }
 
+    void ImGuiManager::init_context(GLFWwindow *p_window)
+    {
         IMGUI_CHECKVERSION();
-        mp_context  = ImGui::CreateContext();
+        mp_context = ImGui::CreateContext();
+        make_current();
+
         ImGuiIO &io = ImGui::GetIO();
         io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
@@ -45,6 +50,19 @@ namespace engine
             io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;
 
         ImGui_ImplGlfw_InitForVulkan(p_window, true);
+    }
+
+    void ImGuiManager::init_renderer(VulkanBackend &backend)
+    {
+        // The renderer keeps its state in the current context
+        make_current();
+
+        m_device_manager = backend.m_device_manager;
+        // Descriptor pool as used by imgui needs the `FreeDescriptorSet` flag bit set.
+        m_descriptor_pool.init(backend.m_device_manager, 64, vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
+
+        m_formats = backend.m_swapchain.overlay_formats();
+
         ImGui_ImplVulkan_InitInfo init = {
             .Instance        = m_device_manager->instance_manager->instance,
             .PhysicalDevice  = m_device_manager->physical_device,
@@ -52,7 +70,7 @@ namespace engine
             .QueueFamily     = m_device_manager->graphics_queue.index,
             .Queue           = m_device_manager->graphics_queue.handle,
             .DescriptorPool  = m_descriptor_pool.get_pool(),
-            .RenderPass      = backend.m_swapchain.render_pass,
+            .RenderPass      = nullptr,
             .MinImageCount   = MAX_IN_FLIGHT,
             .ImageCount      = MAX_IN_FLIGHT + 1,
             .MSAASamples     = VK_SAMPLE_COUNT_1_BIT,
@@ -61,6 +79,12 @@ namespace engine
             .Allocator       = nullptr,
             .CheckVkResultFn = nullptr,
         };
+        init.UseDynamicRendering         = true;
+        init.PipelineRenderingCreateInfo = vk::PipelineRenderingCreateInfo {
+            .colorAttachmentCount    = 1,
+            .pColorAttachmentFormats = &m_formats.color,
+            .depthAttachmentFormat   = m_formats.depth,
+        };
         ImGui_ImplVulkan_Init(&init);
     }
 
@@ -98,9 +122,16 @@ namespace engine
         ImGui::EndFrame();
     }
 
+    bool ImGuiManager::active()
+    {
+        make_current();
+        return ImGui::IsAnyItemActive();
+    }
+
     void ImGuiManager::update_platform_windows()
     {
         if constexpr (ENABLE_MULTIVIEWPORTS) {
+            make_current();
             ImGui::UpdatePlatformWindows();
             ImGui::RenderPlatformWindowsDefault();
         }
@@ -112,6 +143,8 @@ namespace engine
         ImGui::Render();
         ImDrawData *draw_data = ImGui::GetDrawData();
 
+        // The interface is drawn at full resolution, over the upscaled scene
+        context.backend->begin_overlay(context);
         ImGui_ImplVulkan_RenderDrawData(draw_data, context.cmd);
     }
 
@@ -0,0 +1,181 @@
+#include "jobs/job_system.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <exception>
+#include <limits>
+
+using std::shared_ptr, std::make_shared, std::function, std::unique_lock, std::lock_guard, std::mutex, std::atomic,
+    std::min, std::max;
+
+namespace engine
+{
+    class JobSystem::Deleter
+    {
+      public:
+        void operator()(JobSystem *ptr) { delete ptr; }
+    };
+
+    JobSystem::Shared JobSystem::new_shared(uint32_t worker_count)
+    {
+        if (worker_count == 0)
+            worker_count = max(std::thread::hardware_concurrency(), 2u) - 1;
+
+        return {new JobSystem(worker_count), Deleter()};
+    }
+
+    JobSystem::JobSystem(uint32_t worker_count)
+        : m_logger(get_logger())
+    {
+        m_workers.reserve(worker_count);
+        for (uint32_t i = 0; i < worker_count; ++i)
+            m_workers.emplace_back(&JobSystem::worker_main, this);
+
+        m_logger->info("Started job system with {} workers", worker_count);
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+
+        for (auto &worker : m_workers)
+            worker.join();
+
+        m_workers.clear();
+        m_queue = {};
+
+        m_logger->info("Stopped job system");
+    }
+
+    void JobSystem::submit(Job job, JobPriority priority)
+    {
+        {
+            lock_guard lock(m_mutex);
+            m_queue.push(QueuedJob {.priority = priority, .sequence = m_sequence++, .job = std::move(job)});
+        }
+        m_wake.notify_one();
+    }
+
+    bool JobSystem::try_run_one()
+    {
+        Job job;
+
+        {
+            lock_guard lock(m_mutex);
+            if (m_queue.empty())
+                return false;
+
+            job = std::move(const_cast<QueuedJob &>(m_queue.top()).job);
+            m_queue.pop();
+        }
+
+        run(job);
+        return true;
+    }
+
+    void JobSystem::parallel_for(size_t count, size_t batch, const function<void(size_t, size_t)> &function)
+    {
+        if (count == 0)
+            return;
+
+        batch          = max<size_t>(batch, 1);
+        size_t batches = (count + batch - 1) / batch;
+
+        if (batches == 1 || m_workers.empty()) {
+            function(0, count);
+            return;
+        }
+
+        // Helpers may start after the caller has finished every batch, so the state must outlive this call.
+        struct State
+        {
+            atomic<size_t>          next      = 0;
+            atomic<size_t>          completed = 0;
+            atomic<bool>            failed    = false;
+            std::exception_ptr      error     = {};
+            std::mutex              mutex     = {};
+            std::condition_variable done      = {};
+        };
+
+        auto state = make_shared<State>();
+
+        auto work = [state, count, batch, batches, &function]() {
+            size_t finished = 0;
+
+            // A failed batch still counts as finished, so the caller is never left waiting. Once one batch has
+            // failed, the remaining ones are skipped.
+            for (size_t i = state->next++; i < batches; i = state->next++) {
+                size_t begin = i * batch;
+
+                try {
+                    if (!state->failed)
+                        function(begin, min(begin + batch, count));
+                } catch (...) {
+                    lock_guard lock(state->mutex);
+                    if (!state->failed.exchange(true))
+                        state->error = std::current_exception();
+                }
+
+                ++finished;
+            }
+
+            if (finished && (state->completed += finished) == batches) {
+                lock_guard lock(state->mutex);
+                state->done.notify_all();
+            }
+        };
+
+        // `function` is only referenced by helpers which still have batches to run, and those are waited on below.
+        size_t helpers = min<size_t>(m_workers.size(), batches - 1);
+        for (size_t i = 0; i < helpers; ++i)
+            submit(work, std::numeric_limits<JobPriority>::max());
+
+        work();
+
+        unique_lock lock(state->mutex);
+        state->done.wait(lock, [&]() { return state->completed == batches; });
+
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+    uint32_t JobSystem::worker_count() const noexcept
+    {
+        return (uint32_t)m_workers.size();
+    }
+
+    void JobSystem::worker_main()
+    {
+        while (true) {
+            Job job;
+
+            {
+                unique_lock lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_stopping || !m_queue.empty(); });
+
+                if (m_stopping)
+                    return;
+
+                job = std::move(const_cast<QueuedJob &>(m_queue.top()).job);
+                m_queue.pop();
+            }
+
+            run(job);
+        }
+    }
+
+    void JobSystem::run(Job &job)
+    {
+        try {
+            job();
+        } catch (Exception &e) {
+            e.log();
+        } catch (std::exception &e) {
+            m_logger->error("Unhandled exception in job: {}", e.what());
+        }
+    }
+} // namespace engine
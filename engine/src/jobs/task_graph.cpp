@@ -0,0 +1,129 @@
+#include "jobs/task_graph.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+using std::string_view, std::initializer_list, std::vector, std::atomic, std::mutex, std::lock_guard, std::unique_lock,
+    std::exception_ptr, std::stringstream, std::chrono::steady_clock;
+
+namespace engine
+{
+    TaskGraph::Node TaskGraph::add(string_view name, Task task, initializer_list<Node> dependencies)
+    {
+        Node node = m_nodes.size();
+
+        m_nodes.push_back(TaskNode {
+            .name         = std::string(name),
+            .task         = std::move(task),
+            .dependents   = {},
+            .dependencies = dependencies.size(),
+        });
+
+        for (Node dependency : dependencies)
+            m_nodes[dependency].dependents.push_back(node);
+
+        return node;
+    }
+
+    void TaskGraph::run(JobSystem &jobs)
+    {
+        struct State
+        {
+            vector<atomic<size_t>>  remaining;
+            vector<atomic<bool>>    skipped;
+            atomic<size_t>          completed = 0;
+            exception_ptr           error     = nullptr;
+            mutex                   guard     = {};
+            std::condition_variable done      = {};
+            steady_clock::time_point start    = steady_clock::now();
+
+            State(size_t count)
+                : remaining(count)
+                , skipped(count)
+            { }
+        };
+
+        State state(m_nodes.size());
+        for (Node i = 0; i < m_nodes.size(); ++i)
+            state.remaining[i] = m_nodes[i].dependencies;
+
+        // `execute` is only referenced by queued jobs, all of which finish before this function returns.
+        std::function<void(Node)> execute = [&](Node node) {
+            TaskNode &task = m_nodes[node];
+
+            task.timing.start = steady_clock::now() - state.start;
+            if (!state.skipped[node]) {
+                try {
+                    task.task();
+                } catch (...) {
+                    lock_guard lock(state.guard);
+                    if (!state.error)
+                        state.error = std::current_exception();
+                    state.skipped[node] = true;
+                }
+            }
+            task.timing.end = steady_clock::now() - state.start;
+            task.skipped    = state.skipped[node];
+
+            for (Node dependent : task.dependents) {
+                if (task.skipped)
+                    state.skipped[dependent] = true;
+
+                if (--state.remaining[dependent] == 0)
+                    jobs.submit([&execute, dependent]() { execute(dependent); });
+            }
+
+            lock_guard lock(state.guard);
+            if (++state.completed == m_nodes.size())
+                state.done.notify_all();
+        };
+
+        for (Node i = 0; i < m_nodes.size(); ++i)
+            if (m_nodes[i].dependencies == 0)
+                jobs.submit([&execute, i]() { execute(i); });
+
+        // Help out until every task has run. The final wait also ensures no task still holds the lock.
+        while (state.completed < m_nodes.size())
+            if (!jobs.try_run_one()) {
+                unique_lock lock(state.guard);
+                state.done.wait_for(lock, std::chrono::microseconds(100),
+                                    [&]() { return state.completed == m_nodes.size(); });
+            }
+
+        unique_lock lock(state.guard);
+
+        m_elapsed = steady_clock::now() - state.start;
+
+        if (state.error)
+            std::rethrow_exception(state.error);
+    }
+
+    const TaskGraph::Timing &TaskGraph::timing(Node node) const
+    {
+        return m_nodes[node].timing;
+    }
+
+    TaskGraph::Duration TaskGraph::elapsed() const noexcept
+    {
+        return m_elapsed;
+    }
+
+    void TaskGraph::log_timeline(spdlog::logger &logger, string_view title) const
+    {
+        stringstream ss     = {};
+        Duration     serial = {};
+
+        for (const auto &node : m_nodes) {
+            Duration length = node.timing.end - node.timing.start;
+            serial += length;
+
+            ss << fmt::format("\n\t[{:8.2f} ms - {:8.2f} ms] {:8.2f} ms  {}{}", node.timing.start.count(),
+                              node.timing.end.count(), length.count(), node.name, node.skipped ? " (skipped)" : "");
+        }
+
+        logger.info("{} took {:.2f} ms ({:.2f} ms of work):{}", title, m_elapsed.count(), serial.count(), ss.str());
+    }
+} // namespace engine
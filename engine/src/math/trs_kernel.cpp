@@ -0,0 +1,262 @@
+#include "math/trs_kernel.hpp"
+#include "exceptions.hpp"
+#include "transform.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fmt/format.h>
+#include <random>
+#include <vector>
+
+#if ENGINE_TRS_X86 && defined(_MSC_VER)
+#    include <immintrin.h>
+#    include <intrin.h>
+#endif
+
+using std::span, std::string_view, std::vector, std::chrono::steady_clock;
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "The transform kernel requires packed vec3s");
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "The transform kernel requires packed mat4s");
+static_assert(sizeof(glm::quat) == 4 * sizeof(float), "The transform kernel requires packed quaternions");
+
+namespace engine::math
+{
+    namespace detail
+    {
+#if ENGINE_TRS_X86
+        size_t compose_sse41(const float *locations, const float *rotations, const float *scales, float *out,
+                             size_t count);
+        size_t compose_avx2(const float *locations, const float *rotations, const float *scales, float *out,
+                            size_t count);
+        size_t compose_avx512(const float *locations, const float *rotations, const float *scales, float *out,
+                              size_t count);
+        size_t compose_quat_sse41(const float *locations, const float *orientations, const float *scales, float *out,
+                                  size_t count);
+        size_t compose_quat_avx2(const float *locations, const float *orientations, const float *scales, float *out,
+                                 size_t count);
+        size_t compose_quat_avx512(const float *locations, const float *orientations, const float *scales,
+                                   float *out, size_t count);
+#endif
+
+        /// Reference path, also used for the elements which do not fill a block
+        static void compose_scalar(const glm::vec3 *locations, const glm::vec3 *rotations, const glm::vec3 *scales,
+                                   glm::mat4 *out, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) {
+                float sa = std::sin(rotations[i].x), ca = std::cos(rotations[i].x);
+                float sb = std::sin(rotations[i].y), cb = std::cos(rotations[i].y);
+                float sc = std::sin(rotations[i].z), cc = std::cos(rotations[i].z);
+
+                const glm::vec3 &s = scales[i];
+
+                out[i][0] = glm::vec4(ca * cc + sa * sb * sc, cb * sc, ca * sb * sc - sa * cc, 0.0f) * s.x;
+                out[i][1] = glm::vec4(sa * sb * cc - ca * sc, cb * cc, sa * sc + ca * sb * cc, 0.0f) * s.y;
+                out[i][2] = glm::vec4(sa * cb, -sb, ca * cb, 0.0f) * s.z;
+                out[i][3] = glm::vec4(locations[i], 1.0f);
+            }
+        }
+
+        static void compose_scalar(const glm::vec3 *locations, const glm::quat *orientations, const glm::vec3 *scales,
+                                   glm::mat4 *out, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+                out[i] = QuatTransform {locations[i], orientations[i], scales[i]}.get_transform_matrix();
+        }
+
+        /// Run the widest block kernel available, then the scalar path on the remainder
+        template<class Rotation, class Kernel>
+        static void dispatch(span<const glm::vec3> locations, span<const Rotation> rotations,
+                             span<const glm::vec3> scales, span<glm::mat4> out, SimdLevel level, Kernel sse41,
+                             Kernel avx2, Kernel avx512)
+        {
+            size_t count = out.size();
+            if (locations.size() != count || rotations.size() != count || scales.size() != count)
+                throw Exception(fmt::format("Transform inputs of sizes {}, {} and {} do not match {} outputs",
+                                            locations.size(), rotations.size(), scales.size(), count));
+
+            size_t done = 0;
+
+#if ENGINE_TRS_X86
+            auto loc = reinterpret_cast<const float *>(locations.data());
+            auto rot = reinterpret_cast<const float *>(rotations.data());
+            auto scl = reinterpret_cast<const float *>(scales.data());
+            auto dst = reinterpret_cast<float *>(out.data());
+
+            switch (std::min(level, detect_simd_level())) {
+            case SimdLevel::AVX512:
+                done = avx512(loc, rot, scl, dst, count);
+                break;
+            case SimdLevel::AVX2:
+                done = avx2(loc, rot, scl, dst, count);
+                break;
+            case SimdLevel::SSE41:
+                done = sse41(loc, rot, scl, dst, count);
+                break;
+            default:
+                break;
+            }
+#endif
+
+            compose_scalar(locations.data() + done, rotations.data() + done, scales.data() + done, out.data() + done,
+                           count - done);
+        }
+
+        static SimdLevel detect() noexcept
+        {
+#if ENGINE_TRS_X86 && (defined(__GNUC__) || defined(__clang__))
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return SimdLevel::AVX512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                return SimdLevel::AVX2;
+            if (__builtin_cpu_supports("sse4.1"))
+                return SimdLevel::SSE41;
+#elif ENGINE_TRS_X86 && defined(_MSC_VER)
+            int info[4] = {};
+            __cpuid(info, 0);
+            int max_leaf = info[0];
+
+            __cpuid(info, 1);
+            bool sse41   = info[2] & (1 << 19);
+            bool fma     = info[2] & (1 << 12);
+            bool osxsave = info[2] & (1 << 27);
+
+            // The OS must save the YMM and ZMM registers for AVX to be usable
+            uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+            bool     ymm  = (xcr0 & 0x06) == 0x06;
+            bool     zmm  = (xcr0 & 0xE6) == 0xE6;
+
+            bool avx2 = false, avx512 = false;
+            if (max_leaf >= 7) {
+                __cpuidex(info, 7, 0);
+                avx2   = info[1] & (1 << 5);
+                avx512 = info[1] & (1 << 16);
+            }
+
+            if (avx512 && zmm)
+                return SimdLevel::AVX512;
+            if (avx2 && fma && ymm)
+                return SimdLevel::AVX2;
+            if (sse41)
+                return SimdLevel::SSE41;
+#endif
+            return SimdLevel::Scalar;
+        }
+    } // namespace detail
+
+    string_view to_string(SimdLevel level)
+    {
+        switch (level) {
+        case SimdLevel::Scalar:
+            return "Scalar";
+        case SimdLevel::SSE41:
+            return "SSE4.1";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::AVX512:
+            return "AVX-512";
+        default:
+            return "Unknown";
+        }
+    }
+
+    SimdLevel detect_simd_level() noexcept
+    {
+        static const SimdLevel level = detail::detect();
+        return level;
+    }
+
+    string_view to_string(RotationMode mode)
+    {
+        switch (mode) {
+        case RotationMode::Euler:
+            return "Euler";
+        case RotationMode::Quaternion:
+            return "Quaternion";
+        default:
+            return "Unknown";
+        }
+    }
+
+    void compose_transforms(span<const glm::vec3> locations, span<const glm::vec3> rotations,
+                            span<const glm::vec3> scales, span<glm::mat4> out, SimdLevel level)
+    {
+#if ENGINE_TRS_X86
+        detail::dispatch(locations, rotations, scales, out, level, detail::compose_sse41, detail::compose_avx2,
+                         detail::compose_avx512);
+#else
+        detail::dispatch(locations, rotations, scales, out, level, nullptr, nullptr, nullptr);
+#endif
+    }
+
+    void compose_transforms(span<const glm::vec3> locations, span<const glm::quat> orientations,
+                            span<const glm::vec3> scales, span<glm::mat4> out, SimdLevel level)
+    {
+#if ENGINE_TRS_X86
+        detail::dispatch(locations, orientations, scales, out, level, detail::compose_quat_sse41,
+                         detail::compose_quat_avx2, detail::compose_quat_avx512);
+#else
+        detail::dispatch(locations, orientations, scales, out, level, nullptr, nullptr, nullptr);
+#endif
+    }
+
+    TrsBenchmark benchmark_compose_transforms(size_t count, SimdLevel level, RotationMode mode)
+    {
+        std::mt19937                          rng(count);
+        std::uniform_real_distribution<float> location(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> angle(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+
+        vector<glm::vec3> locations(count), rotations(count), scales(count);
+        for (size_t i = 0; i < count; ++i) {
+            locations[i] = {location(rng), location(rng), location(rng)};
+            rotations[i] = {angle(rng), angle(rng), angle(rng)};
+            scales[i]    = {scale(rng), scale(rng), scale(rng)};
+        }
+
+        vector<glm::quat> orientations(count);
+        for (size_t i = 0; i < count; ++i)
+            orientations[i] = euler_to_quat(rotations[i]);
+
+        vector<glm::mat4> expected(count), actual(count);
+
+        auto start = steady_clock::now();
+        if (mode == RotationMode::Quaternion)
+            for (size_t i = 0; i < count; ++i)
+                expected[i] = QuatTransform {locations[i], orientations[i], scales[i]}.get_transform_matrix();
+        else
+            for (size_t i = 0; i < count; ++i)
+                expected[i] = Transform {locations[i], rotations[i], scales[i]}.get_transform_matrix();
+        std::chrono::duration<double> baseline = steady_clock::now() - start;
+
+        start = steady_clock::now();
+        if (mode == RotationMode::Quaternion)
+            compose_transforms(locations, orientations, scales, actual, level);
+        else
+            compose_transforms(locations, rotations, scales, actual, level);
+        std::chrono::duration<double> kernel = steady_clock::now() - start;
+
+        TrsBenchmark result = {};
+        result.level        = std::min(level, detect_simd_level());
+        result.mode         = mode;
+        result.count        = count;
+
+        if (baseline.count() > 0.0)
+            result.baseline_per_second = count / baseline.count();
+        if (kernel.count() > 0.0)
+            result.matrices_per_second = count / kernel.count();
+
+        for (size_t i = 0; i < count; ++i)
+            for (int column = 0; column < 4; ++column)
+                for (int row = 0; row < 4; ++row) {
+                    float e          = expected[i][column][row];
+                    float error      = std::abs(actual[i][column][row] - e) / std::max(1.0f, std::abs(e));
+                    result.max_error = std::max(result.max_error, error);
+                }
+
+        result.within_epsilon = result.max_error <= TRS_EPSILON;
+
+        return result;
+    }
+} // namespace engine::math
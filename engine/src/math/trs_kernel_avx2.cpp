@@ -0,0 +1,81 @@
+#include "math/trs_kernel.hpp"
+
+#if ENGINE_TRS_X86
+#    include "trs_kernel_impl.hpp"
+#    include <immintrin.h>
+
+namespace engine::math::detail
+{
+    struct Avx2
+    {
+        static constexpr size_t LANES = 8;
+
+        __m256 v;
+
+        static inline Avx2 set1(float value) { return {_mm256_set1_ps(value)}; }
+        static inline Avx2 add(Avx2 a, Avx2 b) { return {_mm256_add_ps(a.v, b.v)}; }
+        static inline Avx2 sub(Avx2 a, Avx2 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+        static inline Avx2 mul(Avx2 a, Avx2 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+        static inline Avx2 floor(Avx2 a) { return {_mm256_floor_ps(a.v)}; }
+        static inline Avx2 abs(Avx2 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+
+        static inline Avx2 xor_sign(Avx2 v, Avx2 x)
+        {
+            return {_mm256_xor_ps(v.v, _mm256_and_ps(x.v, _mm256_set1_ps(-0.0f)))};
+        }
+
+        static inline void load3(const float *p, Avx2 &x, Avx2 &y, Avx2 &z)
+        {
+            const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+            x.v = _mm256_i32gather_ps(p + 0, stride, 4);
+            y.v = _mm256_i32gather_ps(p + 1, stride, 4);
+            z.v = _mm256_i32gather_ps(p + 2, stride, 4);
+        }
+
+        static inline void load4(const float *p, Avx2 &c0, Avx2 &c1, Avx2 &c2, Avx2 &c3)
+        {
+            const __m256i stride = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+
+            c0.v = _mm256_i32gather_ps(p + 0, stride, 4);
+            c1.v = _mm256_i32gather_ps(p + 1, stride, 4);
+            c2.v = _mm256_i32gather_ps(p + 2, stride, 4);
+            c3.v = _mm256_i32gather_ps(p + 3, stride, 4);
+        }
+
+        static inline void store16(float *out, const Avx2 (&m)[16])
+        {
+            for (size_t column = 0; column < 4; ++column) {
+                // Rows `r` of each matrix, interleaved: t0 = (r0 r1 of matrices 0, 1 | 4, 5) and so on
+                __m256 t0 = _mm256_unpacklo_ps(m[4 * column + 0].v, m[4 * column + 1].v);
+                __m256 t1 = _mm256_unpackhi_ps(m[4 * column + 0].v, m[4 * column + 1].v);
+                __m256 t2 = _mm256_unpacklo_ps(m[4 * column + 2].v, m[4 * column + 3].v);
+                __m256 t3 = _mm256_unpackhi_ps(m[4 * column + 2].v, m[4 * column + 3].v);
+
+                // Whole columns: c0 holds matrices 0 and 4, c1 matrices 1 and 5, ...
+                __m256 c0 = _mm256_shuffle_ps(t0, t2, 0x44);
+                __m256 c1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+                __m256 c2 = _mm256_shuffle_ps(t1, t3, 0x44);
+                __m256 c3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+
+                const __m256 columns[4] = {c0, c1, c2, c3};
+                for (size_t i = 0; i < 4; ++i) {
+                    _mm_storeu_ps(out + i * 16 + 4 * column, _mm256_castps256_ps128(columns[i]));
+                    _mm_storeu_ps(out + (i + 4) * 16 + 4 * column, _mm256_extractf128_ps(columns[i], 1));
+                }
+            }
+        }
+    };
+
+    size_t compose_avx2(const float *locations, const float *rotations, const float *scales, float *out, size_t count)
+    {
+        return compose<Avx2, 3>(locations, rotations, scales, out, count);
+    }
+
+    size_t compose_quat_avx2(const float *locations, const float *orientations, const float *scales, float *out,
+                             size_t count)
+    {
+        return compose<Avx2, 4>(locations, orientations, scales, out, count);
+    }
+} // namespace engine::math::detail
+#endif
@@ -0,0 +1,94 @@
+#include "math/trs_kernel.hpp"
+
+#if ENGINE_TRS_X86
+#    include "trs_kernel_impl.hpp"
+#    include <immintrin.h>
+
+namespace engine::math::detail
+{
+    // Only AVX-512F is required, so bitwise operations go through the integer domain
+    struct Avx512
+    {
+        static constexpr size_t LANES = 16;
+
+        __m512 v;
+
+        static inline __m512 bits_and(__m512 a, __m512 b)
+        {
+            return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+        }
+
+        static inline __m512 bits_xor(__m512 a, __m512 b)
+        {
+            return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+        }
+
+        static inline Avx512 set1(float value) { return {_mm512_set1_ps(value)}; }
+        static inline Avx512 add(Avx512 a, Avx512 b) { return {_mm512_add_ps(a.v, b.v)}; }
+        static inline Avx512 sub(Avx512 a, Avx512 b) { return {_mm512_sub_ps(a.v, b.v)}; }
+        static inline Avx512 mul(Avx512 a, Avx512 b) { return {_mm512_mul_ps(a.v, b.v)}; }
+        static inline Avx512 floor(Avx512 a) { return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF)}; }
+        static inline Avx512 abs(Avx512 a) { return {_mm512_abs_ps(a.v)}; }
+
+        static inline Avx512 xor_sign(Avx512 v, Avx512 x)
+        {
+            return {bits_xor(v.v, bits_and(x.v, _mm512_set1_ps(-0.0f)))};
+        }
+
+        static inline void load3(const float *p, Avx512 &x, Avx512 &y, Avx512 &z)
+        {
+            const __m512i stride = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+
+            x.v = _mm512_i32gather_ps(stride, p + 0, 4);
+            y.v = _mm512_i32gather_ps(stride, p + 1, 4);
+            z.v = _mm512_i32gather_ps(stride, p + 2, 4);
+        }
+
+        static inline void load4(const float *p, Avx512 &c0, Avx512 &c1, Avx512 &c2, Avx512 &c3)
+        {
+            const __m512i stride = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60);
+
+            c0.v = _mm512_i32gather_ps(stride, p + 0, 4);
+            c1.v = _mm512_i32gather_ps(stride, p + 1, 4);
+            c2.v = _mm512_i32gather_ps(stride, p + 2, 4);
+            c3.v = _mm512_i32gather_ps(stride, p + 3, 4);
+        }
+
+        static inline void store16(float *out, const Avx512 (&m)[16])
+        {
+            for (size_t column = 0; column < 4; ++column) {
+                // Same transpose as AVX2, with four matrices per vector: c0 holds matrices 0, 4, 8 and 12
+                __m512 t0 = _mm512_unpacklo_ps(m[4 * column + 0].v, m[4 * column + 1].v);
+                __m512 t1 = _mm512_unpackhi_ps(m[4 * column + 0].v, m[4 * column + 1].v);
+                __m512 t2 = _mm512_unpacklo_ps(m[4 * column + 2].v, m[4 * column + 3].v);
+                __m512 t3 = _mm512_unpackhi_ps(m[4 * column + 2].v, m[4 * column + 3].v);
+
+                __m512 c0 = _mm512_shuffle_ps(t0, t2, 0x44);
+                __m512 c1 = _mm512_shuffle_ps(t0, t2, 0xEE);
+                __m512 c2 = _mm512_shuffle_ps(t1, t3, 0x44);
+                __m512 c3 = _mm512_shuffle_ps(t1, t3, 0xEE);
+
+                const __m512 columns[4] = {c0, c1, c2, c3};
+                for (size_t i = 0; i < 4; ++i) {
+                    _mm_storeu_ps(out + i * 16 + 4 * column, _mm512_extractf32x4_ps(columns[i], 0));
+                    _mm_storeu_ps(out + (i + 4) * 16 + 4 * column, _mm512_extractf32x4_ps(columns[i], 1));
+                    _mm_storeu_ps(out + (i + 8) * 16 + 4 * column, _mm512_extractf32x4_ps(columns[i], 2));
+                    _mm_storeu_ps(out + (i + 12) * 16 + 4 * column, _mm512_extractf32x4_ps(columns[i], 3));
+                }
+            }
+        }
+    };
+
+    size_t compose_avx512(const float *locations, const float *rotations, const float *scales, float *out,
+                          size_t count)
+    {
+        return compose<Avx512, 3>(locations, rotations, scales, out, count);
+    }
+
+    size_t compose_quat_avx512(const float *locations, const float *orientations, const float *scales, float *out,
+                               size_t count)
+    {
+        return compose<Avx512, 4>(locations, orientations, scales, out, count);
+    }
+} // namespace engine::math::detail
+#endif
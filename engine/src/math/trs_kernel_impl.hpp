@@ -0,0 +1,197 @@
+#pragma once
+#include <cstddef>
+#include <glm/gtc/quaternion.hpp>
+
+// Shared by the translation units of every instruction set. Each one includes this file with its own compiler flags and
+// instantiates `compose_block` with a wrapper providing the arithmetic for its vector width:
+//
+//  - `LANES`, the number of floats per vector
+//  - `set1`, `add`, `sub`, `mul`, `floor`, `abs`
+//  - `xor_sign(v, x)`, which negates `v` wherever `x` is negative
+//  - `load3`, which de-interleaves `LANES` packed vec3s into three vectors
+//  - `load4`, which de-interleaves `LANES` packed quaternions into four vectors, in storage order
+//  - `store16`, which transposes sixteen vectors into `LANES` column-major mat4s
+
+namespace engine::math::detail
+{
+    // Cody-Waite reduction constants and minimax polynomials from Cephes' `sinf` and `cosf`
+    constexpr float FOUR_OVER_PI = 1.27323954473516f;
+    constexpr float DP1          = 0.78515625f;
+    constexpr float DP2          = 2.4187564849853515625e-4f;
+    constexpr float DP3          = 3.77489497744594108e-8f;
+    constexpr float COS_P0       = 2.443315711809948e-5f;
+    constexpr float COS_P1       = -1.388731625493765e-3f;
+    constexpr float COS_P2       = 4.166664568298827e-2f;
+    constexpr float SIN_P0       = -1.9515295891e-4f;
+    constexpr float SIN_P1       = 8.3321608736e-3f;
+    constexpr float SIN_P2       = -1.6666654611e-1f;
+
+    // Place of each component in a `glm::quat`. GLM 1.0 stores w first unless `GLM_FORCE_QUAT_DATA_XYZW` is defined,
+    // while earlier versions store it last.
+    constexpr size_t QUAT_X = offsetof(glm::quat, x) / sizeof(float);
+    constexpr size_t QUAT_Y = offsetof(glm::quat, y) / sizeof(float);
+    constexpr size_t QUAT_Z = offsetof(glm::quat, z) / sizeof(float);
+    constexpr size_t QUAT_W = offsetof(glm::quat, w) / sizeof(float);
+
+    /// `a` where `flag` is one, `b` where it is zero
+    template<class V>
+    inline V select(V flag, V a, V b)
+    {
+        return V::add(V::mul(a, flag), V::mul(b, V::sub(V::set1(1.0f), flag)));
+    }
+
+    /// Bit of weight `weight` of the integers in `v`, as 0 or 1
+    template<class V>
+    inline V bit(V v, float weight)
+    {
+        V shifted = V::floor(V::mul(v, V::set1(1.0f / weight)));
+        return V::sub(shifted, V::mul(V::floor(V::mul(shifted, V::set1(0.5f))), V::set1(2.0f)));
+    }
+
+    template<class V>
+    inline void sincos(V x, V &sin, V &cos)
+    {
+        V ax = V::abs(x);
+
+        // Octant, rounded up to even, so that the reduced argument lies in [-pi/4, pi/4]
+        V j = V::floor(V::mul(V::add(V::floor(V::mul(ax, V::set1(FOUR_OVER_PI))), V::set1(1.0f)), V::set1(0.5f)));
+        j   = V::mul(j, V::set1(2.0f));
+
+        V r = V::sub(ax, V::mul(j, V::set1(DP1)));
+        r   = V::sub(r, V::mul(j, V::set1(DP2)));
+        r   = V::sub(r, V::mul(j, V::set1(DP3)));
+        V z = V::mul(r, r);
+
+        V cp = V::add(V::mul(V::set1(COS_P0), z), V::set1(COS_P1));
+        cp   = V::add(V::mul(cp, z), V::set1(COS_P2));
+        cp   = V::mul(V::mul(cp, z), z);
+        cp   = V::add(V::sub(cp, V::mul(z, V::set1(0.5f))), V::set1(1.0f));
+
+        V sp = V::add(V::mul(V::set1(SIN_P0), z), V::set1(SIN_P1));
+        sp   = V::add(V::mul(sp, z), V::set1(SIN_P2));
+        sp   = V::add(V::mul(V::mul(sp, z), r), r);
+
+        // Bit 1 of the octant swaps the polynomials, bit 2 flips the sine, and bit 2 of `j - 2` keeps the cosine
+        // positive
+        V swap     = bit(j, 2.0f);
+        V sin_flip = bit(j, 4.0f);
+        V cos_keep = bit(V::add(j, V::set1(6.0f)), 4.0f);
+
+        sin = select(swap, cp, sp);
+        cos = select(swap, sp, cp);
+
+        sin = V::xor_sign(V::mul(sin, V::sub(V::set1(1.0f), V::mul(sin_flip, V::set1(2.0f)))), x);
+        cos = V::mul(cos, V::sub(V::mul(cos_keep, V::set1(2.0f)), V::set1(1.0f)));
+    }
+
+    /// Compose `V::LANES` matrices as `Transform::get_transform_matrix` does
+    template<class V>
+    inline void compose_block(const float *locations, const float *rotations, const float *scales, float *out)
+    {
+        V lx, ly, lz, rx, ry, rz, sx, sy, sz;
+        V::load3(locations, lx, ly, lz);
+        V::load3(rotations, rx, ry, rz);
+        V::load3(scales, sx, sy, sz);
+
+        // Rotation about Y by `rx`, then X by `ry`, then Z by `rz`
+        V sa, ca, sb, cb, sc, cc;
+        sincos(rx, sa, ca);
+        sincos(ry, sb, cb);
+        sincos(rz, sc, cc);
+
+        V sa_sb = V::mul(sa, sb);
+        V ca_sb = V::mul(ca, sb);
+        V zero  = V::set1(0.0f);
+
+        V m[16] = {
+            V::mul(V::add(V::mul(ca, cc), V::mul(sa_sb, sc)), sx),
+            V::mul(V::mul(cb, sc), sx),
+            V::mul(V::sub(V::mul(ca_sb, sc), V::mul(sa, cc)), sx),
+            zero,
+
+            V::mul(V::sub(V::mul(sa_sb, cc), V::mul(ca, sc)), sy),
+            V::mul(V::mul(cb, cc), sy),
+            V::mul(V::add(V::mul(sa, sc), V::mul(ca_sb, cc)), sy),
+            zero,
+
+            V::mul(V::mul(sa, cb), sz),
+            V::mul(V::sub(zero, sb), sz),
+            V::mul(V::mul(ca, cb), sz),
+            zero,
+
+            lx,
+            ly,
+            lz,
+            V::set1(1.0f),
+        };
+
+        V::store16(out, m);
+    }
+
+    /// Compose `V::LANES` matrices from unit quaternions, as `QuatTransform` does
+    template<class V>
+    inline void compose_quat_block(const float *locations, const float *orientations, const float *scales, float *out)
+    {
+        V lx, ly, lz, q[4], sx, sy, sz;
+        V::load3(locations, lx, ly, lz);
+        V::load4(orientations, q[0], q[1], q[2], q[3]);
+        V::load3(scales, sx, sy, sz);
+
+        V x = q[QUAT_X], y = q[QUAT_Y], z = q[QUAT_Z], w = q[QUAT_W];
+
+        V two = V::set1(2.0f);
+        V one = V::set1(1.0f);
+
+        V x2 = V::mul(x, two), y2 = V::mul(y, two), z2 = V::mul(z, two);
+        V xx = V::mul(x, x2), yy = V::mul(y, y2), zz = V::mul(z, z2);
+        V xy = V::mul(x, y2), xz = V::mul(x, z2), yz = V::mul(y, z2);
+        V wx = V::mul(w, x2), wy = V::mul(w, y2), wz = V::mul(w, z2);
+
+        V zero = V::set1(0.0f);
+
+        V m[16] = {
+            V::mul(V::sub(one, V::add(yy, zz)), sx),
+            V::mul(V::add(xy, wz), sx),
+            V::mul(V::sub(xz, wy), sx),
+            zero,
+
+            V::mul(V::sub(xy, wz), sy),
+            V::mul(V::sub(one, V::add(xx, zz)), sy),
+            V::mul(V::add(yz, wx), sy),
+            zero,
+
+            V::mul(V::add(xz, wy), sz),
+            V::mul(V::sub(yz, wx), sz),
+            V::mul(V::sub(one, V::add(xx, yy)), sz),
+            zero,
+
+            lx,
+            ly,
+            lz,
+            one,
+        };
+
+        V::store16(out, m);
+    }
+
+    /// Compose every full block of `V::LANES` matrices, returning the number of matrices written.
+    ///
+    /// `ROTATION` is the number of floats per rotation: 3 for Euler angles, 4 for quaternions.
+    template<class V, size_t ROTATION>
+    inline size_t compose(const float *locations, const float *rotations, const float *scales, float *out,
+                          size_t count)
+    {
+        size_t blocks = count / V::LANES;
+
+        for (size_t b = 0; b < blocks; ++b) {
+            size_t i = b * V::LANES;
+
+            if constexpr (ROTATION == 4)
+                compose_quat_block<V>(locations + 3 * i, rotations + 4 * i, scales + 3 * i, out + 16 * i);
+            else
+                compose_block<V>(locations + 3 * i, rotations + 3 * i, scales + 3 * i, out + 16 * i);
+        }
+
+        return blocks * V::LANES;
+    }
+} // namespace engine::math::detail
@@ -0,0 +1,71 @@
+#include "math/trs_kernel.hpp"
+
+#if ENGINE_TRS_X86
+#    include "trs_kernel_impl.hpp"
+#    include <smmintrin.h>
+
+namespace engine::math::detail
+{
+    struct Sse41
+    {
+        static constexpr size_t LANES = 4;
+
+        __m128 v;
+
+        static inline Sse41 set1(float value) { return {_mm_set1_ps(value)}; }
+        static inline Sse41 add(Sse41 a, Sse41 b) { return {_mm_add_ps(a.v, b.v)}; }
+        static inline Sse41 sub(Sse41 a, Sse41 b) { return {_mm_sub_ps(a.v, b.v)}; }
+        static inline Sse41 mul(Sse41 a, Sse41 b) { return {_mm_mul_ps(a.v, b.v)}; }
+        static inline Sse41 floor(Sse41 a) { return {_mm_floor_ps(a.v)}; }
+        static inline Sse41 abs(Sse41 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+
+        static inline Sse41 xor_sign(Sse41 v, Sse41 x)
+        {
+            return {_mm_xor_ps(v.v, _mm_and_ps(x.v, _mm_set1_ps(-0.0f)))};
+        }
+
+        static inline void load3(const float *p, Sse41 &x, Sse41 &y, Sse41 &z)
+        {
+            x.v = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+            y.v = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+            z.v = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+        }
+
+        static inline void load4(const float *p, Sse41 &c0, Sse41 &c1, Sse41 &c2, Sse41 &c3)
+        {
+            c0.v = _mm_loadu_ps(p + 0);
+            c1.v = _mm_loadu_ps(p + 4);
+            c2.v = _mm_loadu_ps(p + 8);
+            c3.v = _mm_loadu_ps(p + 12);
+            _MM_TRANSPOSE4_PS(c0.v, c1.v, c2.v, c3.v);
+        }
+
+        static inline void store16(float *out, const Sse41 (&m)[16])
+        {
+            for (size_t column = 0; column < 4; ++column) {
+                __m128 c0 = m[4 * column + 0].v;
+                __m128 c1 = m[4 * column + 1].v;
+                __m128 c2 = m[4 * column + 2].v;
+                __m128 c3 = m[4 * column + 3].v;
+                _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+                _mm_storeu_ps(out + 0 * 16 + 4 * column, c0);
+                _mm_storeu_ps(out + 1 * 16 + 4 * column, c1);
+                _mm_storeu_ps(out + 2 * 16 + 4 * column, c2);
+                _mm_storeu_ps(out + 3 * 16 + 4 * column, c3);
+            }
+        }
+    };
+
+    size_t compose_sse41(const float *locations, const float *rotations, const float *scales, float *out, size_t count)
+    {
+        return compose<Sse41, 3>(locations, rotations, scales, out, count);
+    }
+
+    size_t compose_quat_sse41(const float *locations, const float *orientations, const float *scales, float *out,
+                              size_t count)
+    {
+        return compose<Sse41, 4>(locations, orientations, scales, out, count);
+    }
+} // namespace engine::math::detail
+#endif
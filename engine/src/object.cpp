@@ -4,16 +4,57 @@ using namespace engine::reflection;
 
 namespace engine
 {
+    using Vec3Getter = glm::vec3 (TransformRef::*)() const;
+    using Vec3Setter = void (TransformRef::*)(const glm::vec3 &);
+
+    /// Field reading and writing a vector of the object's transform through the registry
+    template<Vec3Getter GET, Vec3Setter SET>
+    static constexpr Field transform_field(const char *name)
+    {
+        return Field(
+            name, FieldTypeBits::Float32 | FieldTypeBits::Vec3,
+            [](const void *object, void *value) { *(glm::vec3 *)value = (((const Object *)object)->transform.*GET)(); },
+            [](void *object, const void *value) { (((Object *)object)->transform.*SET)(*(const glm::vec3 *)value); });
+    }
+
     static const Field OBJECT_FIELDS[] = {
-        Field("location", FieldTypeBits::Float32 | FieldTypeBits::Vec3, offsetof(Object, transform.location)),
-        Field("rotation", FieldTypeBits::Float32 | FieldTypeBits::Vec3, offsetof(Object, transform.rotation)),
-        Field("scale", FieldTypeBits::Float32 | FieldTypeBits::Vec3, offsetof(Object, transform.scale)),
+        transform_field<&TransformRef::location, &TransformRef::set_location>("location"),
+        Field(
+            "orientation", FieldTypeBits::Quat32,
+            [](const void *object, void *value) {
+                *(glm::quat *)value = ((const Object *)object)->transform.orientation();
+            },
+            [](void *object, const void *value) {
+                ((Object *)object)->transform.set_orientation(*(const glm::quat *)value);
+            }),
+        transform_field<&TransformRef::scale, &TransformRef::set_scale>("scale"),
+        Field(
+            "visible", FieldTypeBits::Boolean,
+            [](const void *object, void *value) { *(bool *)value = ((const Object *)object)->transform.visible(); },
+            [](void *object, const void *value) { ((Object *)object)->transform.set_visible(*(const bool *)value); }),
         Field("name", FieldTypeBits::String, offsetof(Object, name)),
     };
 
     const Datastructure OBJECT_REP = Datastructure("Object", OBJECT_FIELDS);
 
-    Object::~Object() = default;
+    Object::Object(TransformRegistry &registry)
+        : transform(registry, registry.create())
+    { }
+
+    Object::~Object()
+    {
+        transform.registry().destroy(transform.entity());
+    }
+
+    Aabb Object::local_bounds() const
+    {
+        return Aabb {glm::vec3(0.0f), glm::vec3(0.0f)};
+    }
+
+    size_t Object::resource_bytes() const
+    {
+        return 0;
+    }
 
     void Object::process(double delta) { }
 
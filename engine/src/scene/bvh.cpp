@@ -0,0 +1,500 @@
+#include "scene/bvh.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <mutex>
+#include <numeric>
+#include <queue>
+
+using std::span, std::vector, std::optional, std::nullopt, std::string_view;
+
+namespace engine
+{
+    static constexpr uint32_t NO_NODE = ~uint32_t(0);
+
+    /// Ranges smaller than this are reduced on the calling thread
+    static constexpr size_t REDUCE_BATCH = 16384;
+
+    /// Accumulate `[begin, end)` into a `T`, in parallel for large ranges
+    template<class T, class Accumulate, class Merge>
+    static T reduce(JobSystem &jobs, size_t begin, size_t end, Accumulate &&accumulate, Merge &&merge)
+    {
+        T total = {};
+
+        if (end - begin <= REDUCE_BATCH) {
+            for (size_t i = begin; i < end; ++i)
+                accumulate(total, i);
+            return total;
+        }
+
+        std::mutex mutex = {};
+        jobs.parallel_for(end - begin, REDUCE_BATCH, [&](size_t first, size_t last) {
+            T local = {};
+            for (size_t i = begin + first; i < begin + last; ++i)
+                accumulate(local, i);
+
+            std::lock_guard lock(mutex);
+            merge(total, local);
+        });
+
+        return total;
+    }
+
+    struct Bin
+    {
+        Aabb     bounds    = {};
+        Aabb     centroids = {};
+        uint32_t count     = 0;
+    };
+
+    using Bins = std::array<std::array<Bin, Bvh::BIN_COUNT>, 3>;
+
+    string_view Bvh::name() const
+    {
+        return "BVH";
+    }
+
+    void Bvh::build(span<const Aabb> bounds, JobSystem &jobs)
+    {
+        uint32_t count = (uint32_t)bounds.size();
+
+        m_bounds.assign(bounds.begin(), bounds.end());
+        m_items.resize(count);
+        m_item_leaf.assign(count, NO_NODE);
+        m_depths.clear();
+
+        m_build.resize(count);
+        jobs.parallel_for(count, REDUCE_BATCH, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                m_build[i] = BuildItem {.bounds = m_bounds[i], .centroid = m_bounds[i].center(), .item = uint32_t(i)};
+        });
+
+        // A binary tree with at least one item per leaf has at most 2n - 1 nodes
+        m_nodes.assign(std::max<size_t>(2 * size_t(count), 1) - 1, Node {});
+        m_node_count = count > 0 ? 1 : 0;
+
+        if (count > 0)
+            build_node(0, 0, count, 0, range_bounds(0, count, jobs), jobs);
+
+        m_nodes.resize(m_node_count);
+        m_dirty.assign(m_nodes.size(), 0);
+
+        for (uint32_t i = 0; i < count; ++i)
+            m_items[i] = m_build[i].item;
+        m_build = {};
+
+        for (uint32_t i = 0; i < m_nodes.size(); ++i) {
+            const Node &node = m_nodes[i];
+
+            if (m_depths.size() <= node.depth)
+                m_depths.resize(node.depth + 1);
+            m_depths[node.depth].push_back(i);
+
+            for (uint32_t item = node.first; item < node.first + node.count; ++item)
+                m_item_leaf[m_items[item]] = i;
+        }
+
+        m_built_cost = cost();
+    }
+
+    Bvh::RangeBounds Bvh::range_bounds(uint32_t begin, uint32_t end, JobSystem &jobs) const
+    {
+        return reduce<RangeBounds>(
+            jobs, begin, end,
+            [&](RangeBounds &local, size_t i) {
+                local.bounds.expand(m_build[i].bounds);
+                local.centroids.expand(m_build[i].centroid);
+            },
+            [](RangeBounds &total, const RangeBounds &local) {
+                total.bounds.expand(local.bounds);
+                total.centroids.expand(local.centroids);
+            });
+    }
+
+    void Bvh::build_node(uint32_t index, uint32_t begin, uint32_t end, uint32_t depth, const RangeBounds &range,
+                         JobSystem &jobs)
+    {
+        Node    &node  = m_nodes[index];
+        uint32_t count = end - begin;
+
+        node.bounds = range.bounds;
+        node.depth  = depth;
+        node.first  = begin;
+        node.count  = count;
+
+        if (count <= 2)
+            return;
+
+        glm::vec3 extent = range.centroids.extent();
+        glm::vec3 scale  = glm::vec3(BIN_COUNT) / glm::max(extent, glm::vec3(1e-20f));
+
+        auto bin_of = [&](const BuildItem &item, int axis) {
+            float offset = (item.centroid[axis] - range.centroids.min[axis]) * scale[axis];
+            return std::min(uint32_t(std::max(offset, 0.0f)), BIN_COUNT - 1);
+        };
+
+        Bins bins = reduce<Bins>(
+            jobs, begin, end,
+            [&](Bins &local, size_t i) {
+                const BuildItem &item = m_build[i];
+                for (int axis = 0; axis < 3; ++axis) {
+                    Bin &bin = local[axis][bin_of(item, axis)];
+                    bin.bounds.expand(item.bounds);
+                    bin.centroids.expand(item.centroid);
+                    ++bin.count;
+                }
+            },
+            [](Bins &total, const Bins &local) {
+                for (int axis = 0; axis < 3; ++axis)
+                    for (uint32_t b = 0; b < BIN_COUNT; ++b) {
+                        total[axis][b].bounds.expand(local[axis][b].bounds);
+                        total[axis][b].centroids.expand(local[axis][b].centroids);
+                        total[axis][b].count += local[axis][b].count;
+                    }
+            });
+
+        // Cost of splitting before each bin, from a sweep in each direction. Costs are relative to the node's area.
+        float    best_cost  = std::numeric_limits<float>::infinity();
+        int      best_axis  = -1;
+        uint32_t best_split = 0;
+
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] <= 0.0f)
+                continue;
+
+            std::array<float, BIN_COUNT> left_cost = {};
+            Aabb                         left      = {};
+            uint32_t                     left_n    = 0;
+            for (uint32_t b = 0; b + 1 < BIN_COUNT; ++b) {
+                left.expand(bins[axis][b].bounds);
+                left_n           += bins[axis][b].count;
+                left_cost[b + 1]  = left.surface_area() * left_n;
+            }
+
+            Aabb     right   = {};
+            uint32_t right_n = 0;
+            for (uint32_t b = BIN_COUNT - 1; b > 0; --b) {
+                right.expand(bins[axis][b].bounds);
+                right_n += bins[axis][b].count;
+
+                float split_cost = left_cost[b] + right.surface_area() * right_n;
+                if (right_n < count && split_cost < best_cost) {
+                    best_cost  = split_cost;
+                    best_axis  = axis;
+                    best_split = b;
+                }
+            }
+        }
+
+        // Traversing a node costs about as much as testing an item
+        float area      = std::max(node.bounds.surface_area(), 1e-20f);
+        float leaf_cost = float(count);
+        best_cost       = 1.0f + best_cost / area;
+
+        if (best_axis >= 0 && best_cost >= leaf_cost && count <= MAX_LEAF_SIZE)
+            return;
+
+        BuildItem *items = m_build.data();
+        uint32_t   mid   = begin;
+        if (best_axis >= 0)
+            mid = uint32_t(std::partition(items + begin, items + end,
+                                          [&](const BuildItem &item) { return bin_of(item, best_axis) < best_split; })
+                           - items);
+
+        // The children's bounds follow from the bins on each side of the split
+        RangeBounds left = {}, right = {};
+        if (best_axis >= 0)
+            for (uint32_t b = 0; b < BIN_COUNT; ++b) {
+                RangeBounds &side = b < best_split ? left : right;
+                side.bounds.expand(bins[best_axis][b].bounds);
+                side.centroids.expand(bins[best_axis][b].centroids);
+            }
+
+        // Items with coincident centroids cannot be separated by bins, so split them down the middle
+        if (mid == begin || mid == end) {
+            if (count <= MAX_LEAF_SIZE)
+                return;
+
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            mid      = begin + count / 2;
+            std::nth_element(items + begin, items + mid, items + end, [&](const BuildItem &a, const BuildItem &b) {
+                return a.centroid[axis] < b.centroid[axis];
+            });
+
+            left  = range_bounds(begin, mid, jobs);
+            right = range_bounds(mid, end, jobs);
+        }
+
+        uint32_t first = m_node_count.fetch_add(2);
+        node.first     = first;
+        node.count     = 0;
+
+        m_nodes[first].parent     = index;
+        m_nodes[first + 1].parent = index;
+
+        if (count >= parallel_threshold) {
+            jobs.parallel_for(2, 1, [&](size_t child, size_t) {
+                if (child == 0)
+                    build_node(first, begin, mid, depth + 1, left, jobs);
+                else
+                    build_node(first + 1, mid, end, depth + 1, right, jobs);
+            });
+        } else {
+            build_node(first, begin, mid, depth + 1, left, jobs);
+            build_node(first + 1, mid, end, depth + 1, right, jobs);
+        }
+    }
+
+    void Bvh::update(span<const Aabb> bounds, JobSystem &jobs)
+    {
+        if (bounds.size() != m_bounds.size())
+            throw Exception(
+                fmt::format("BVH was built with {} items, but {} were given", m_bounds.size(), bounds.size()));
+
+        vector<uint8_t> moved(bounds.size(), 0);
+        jobs.parallel_for(bounds.size(), REDUCE_BATCH, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                if (m_bounds[i] != bounds[i]) {
+                    m_bounds[i] = bounds[i];
+                    moved[i]    = 1;
+                }
+        });
+
+        // Mark the path from each moved item's leaf to the root, stopping at paths already marked
+        for (size_t i = 0; i < moved.size(); ++i)
+            if (moved[i])
+                for (uint32_t node = m_item_leaf[i]; node != NO_NODE && !m_dirty[node]; node = m_nodes[node].parent)
+                    m_dirty[node] = 1;
+
+        // Children are always deeper than their parent, so each depth only reads bounds which are already final
+        for (size_t depth = m_depths.size(); depth-- > 0;) {
+            const vector<uint32_t> &nodes = m_depths[depth];
+
+            jobs.parallel_for(nodes.size(), 1024, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    uint32_t index = nodes[i];
+                    if (!m_dirty[index])
+                        continue;
+
+                    Node &node  = m_nodes[index];
+                    node.bounds = {};
+
+                    if (node.count > 0) {
+                        for (uint32_t item = node.first; item < node.first + node.count; ++item)
+                            node.bounds.expand(m_bounds[m_items[item]]);
+                    } else {
+                        node.bounds.expand(m_nodes[node.first].bounds);
+                        node.bounds.expand(m_nodes[node.first + 1].bounds);
+                    }
+
+                    m_dirty[index] = 0;
+                }
+            });
+        }
+    }
+
+    size_t Bvh::size() const noexcept
+    {
+        return m_bounds.size();
+    }
+
+    void Bvh::collect(uint32_t index, vector<uint32_t> &out) const
+    {
+        vector<uint32_t> stack = {index};
+
+        while (!stack.empty()) {
+            const Node &node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (node.count > 0) {
+                out.insert(out.end(), m_items.begin() + node.first, m_items.begin() + node.first + node.count);
+            } else {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+            }
+        }
+    }
+
+    void Bvh::query_frustum(const Frustum &frustum, vector<uint32_t> &out) const
+    {
+        if (m_nodes.empty())
+            return;
+
+        vector<uint32_t> stack = {0};
+        stack.reserve(64);
+
+        while (!stack.empty()) {
+            uint32_t    index = stack.back();
+            const Node &node  = m_nodes[index];
+            stack.pop_back();
+
+            Frustum::Containment containment = frustum.classify(node.bounds);
+            if (containment == Frustum::Containment::Outside)
+                continue;
+
+            // Everything below a node inside the frustum is visible
+            if (containment == Frustum::Containment::Inside) {
+                collect(index, out);
+            } else if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                    if (frustum.intersects(m_bounds[m_items[i]]))
+                        out.push_back(m_items[i]);
+            } else {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+            }
+        }
+    }
+
+    void Bvh::query_aabb(const Aabb &box, vector<uint32_t> &out) const
+    {
+        if (m_nodes.empty())
+            return;
+
+        vector<uint32_t> stack = {0};
+        stack.reserve(64);
+
+        while (!stack.empty()) {
+            const Node &node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (!node.bounds.overlaps(box))
+                continue;
+
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i)
+                    if (m_bounds[m_items[i]].overlaps(box))
+                        out.push_back(m_items[i]);
+            } else {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+            }
+        }
+    }
+
+    optional<RayHit> Bvh::raycast(const Ray &ray) const
+    {
+        if (m_nodes.empty())
+            return nullopt;
+
+        glm::vec3 inverse = 1.0f / ray.direction;
+        Ray       bounded = ray;
+
+        optional<RayHit> closest = nullopt;
+        float            entry   = 0.0f;
+        if (!bounded.intersect(m_nodes[0].bounds, inverse, entry))
+            return nullopt;
+
+        vector<std::pair<uint32_t, float>> stack = {{0, entry}};
+        stack.reserve(64);
+
+        while (!stack.empty()) {
+            auto [index, distance] = stack.back();
+            stack.pop_back();
+
+            // The closest hit may have moved since the node was pushed
+            if (distance > bounded.max_distance)
+                continue;
+
+            const Node &node = m_nodes[index];
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    float hit;
+                    if (bounded.intersect(m_bounds[m_items[i]], inverse, hit) && hit <= bounded.max_distance) {
+                        closest              = RayHit {.item = m_items[i], .distance = hit};
+                        bounded.max_distance = hit;
+                    }
+                }
+                continue;
+            }
+
+            float near_hit, far_hit;
+            bool  near = bounded.intersect(m_nodes[node.first].bounds, inverse, near_hit);
+            bool  far  = bounded.intersect(m_nodes[node.first + 1].bounds, inverse, far_hit);
+
+            // Visit the nearer child first
+            uint32_t near_index = node.first, far_index = node.first + 1;
+            if (near && far && far_hit < near_hit) {
+                std::swap(near_index, far_index);
+                std::swap(near_hit, far_hit);
+            } else if (!near && far) {
+                std::swap(near_index, far_index);
+                std::swap(near_hit, far_hit);
+                std::swap(near, far);
+            }
+
+            if (far)
+                stack.push_back({far_index, far_hit});
+            if (near)
+                stack.push_back({near_index, near_hit});
+        }
+
+        return closest;
+    }
+
+    void Bvh::query_nearest(const glm::vec3 &point, size_t k, vector<uint32_t> &out) const
+    {
+        if (m_nodes.empty() || k == 0)
+            return;
+
+        using Entry = std::pair<float, uint32_t>;
+
+        // Nodes by increasing distance, and the best items found so far with the furthest on top
+        std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> nodes = {};
+        std::priority_queue<Entry>                                     best  = {};
+
+        nodes.push({m_nodes[0].bounds.distance_squared(point), 0});
+
+        while (!nodes.empty()) {
+            auto [distance, index] = nodes.top();
+            nodes.pop();
+
+            if (best.size() == k && distance >= best.top().first)
+                break;
+
+            const Node &node = m_nodes[index];
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                    float item_distance = m_bounds[m_items[i]].distance_squared(point);
+
+                    if (best.size() < k) {
+                        best.push({item_distance, m_items[i]});
+                    } else if (item_distance < best.top().first) {
+                        best.pop();
+                        best.push({item_distance, m_items[i]});
+                    }
+                }
+            } else {
+                for (uint32_t child = node.first; child < node.first + 2; ++child)
+                    nodes.push({m_nodes[child].bounds.distance_squared(point), child});
+            }
+        }
+
+        size_t first = out.size();
+        out.resize(first + best.size());
+        for (size_t i = out.size(); i-- > first; best.pop())
+            out[i] = best.top().second;
+    }
+
+    float Bvh::cost() const
+    {
+        if (m_nodes.empty())
+            return 0.0f;
+
+        float total = 0.0f;
+        for (const Node &node : m_nodes)
+            total += node.bounds.surface_area() * (node.count > 0 ? float(node.count) : 1.0f);
+
+        return total / std::max(m_nodes[0].bounds.surface_area(), 1e-20f);
+    }
+
+    float Bvh::quality() const
+    {
+        return m_built_cost > 0.0f ? cost() / m_built_cost : 1.0f;
+    }
+
+    size_t Bvh::node_count() const noexcept
+    {
+        return m_nodes.size();
+    }
+} // namespace engine
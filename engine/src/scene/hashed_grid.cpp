@@ -0,0 +1,621 @@
+#include "scene/hashed_grid.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fmt/format.h>
+#include <queue>
+
+using std::span, std::vector, std::optional, std::nullopt, std::string_view;
+
+namespace engine
+{
+    static constexpr uint32_t NO_CELL = ~uint32_t(0);
+
+    /// Cell coordinates are clamped to this magnitude, so that they pack into 21 bits each
+    static constexpr int COORD_LIMIT = (1 << 20) - 1;
+
+    /// Items compared per job when looking for moved items
+    static constexpr size_t UPDATE_BATCH = 16384;
+
+    static constexpr uint64_t EMPTY_SLOT = ~uint64_t(0);
+    static constexpr size_t   MIN_SLOTS  = 64;
+
+    /// Entries reserved for a cell when it first grows
+    static constexpr uint32_t MIN_CELL_ENTRIES = 4;
+    /// Pools at most this large are not compacted, however much of them is released
+    static constexpr size_t   MIN_COMPACT      = 1024;
+
+    /// Ranges of at most this many cells are looked up cell by cell by frustum queries, rather than split further
+    static constexpr uint64_t FRUSTUM_LEAF_CELLS = 64;
+
+    static uint64_t cell_key(const glm::ivec3 &coord)
+    {
+        return (uint64_t(coord.x + COORD_LIMIT + 1) << 42) | (uint64_t(coord.y + COORD_LIMIT + 1) << 21)
+             | uint64_t(coord.z + COORD_LIMIT + 1);
+    }
+
+    static float max_half_extent(const Aabb &bounds)
+    {
+        glm::vec3 half = bounds.extent() * 0.5f;
+        return std::max({half.x, half.y, half.z});
+    }
+
+    HashedGrid::HashedGrid(float cell_size)
+        : m_cell_size(cell_size)
+        , m_inverse_cell(1.0f / cell_size)
+    {
+        if (!(cell_size > 0.0f))
+            throw Exception(fmt::format("Grid cell size must be positive, but {} was given", cell_size));
+    }
+
+    string_view HashedGrid::name() const
+    {
+        return "Hashed grid";
+    }
+
+    void HashedGrid::build(span<const Aabb> bounds, JobSystem &)
+    {
+        m_cells.clear();
+        rehash(MIN_SLOTS);
+        m_locations.assign(bounds.size(), {});
+        m_released = 0;
+
+        m_margin   = 0.0f;
+        m_min_cell = glm::ivec3(std::numeric_limits<int>::max());
+        m_max_cell = glm::ivec3(std::numeric_limits<int>::min());
+
+        // Count the items of each cell, then lay the cells out back to back in the pool
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            if (bounds[i].empty())
+                continue;
+
+            glm::ivec3 coord = cell_of(bounds[i].center());
+            uint32_t   index = acquire_cell(coord);
+            Cell      &cell  = m_cells[index];
+
+            cell.bounds.expand(bounds[i]);
+            ++cell.count;
+            m_locations[i].cell = index;
+            track(coord, bounds[i]);
+        }
+
+        uint32_t first = 0;
+        for (Cell &cell : m_cells) {
+            cell.first    = first;
+            cell.capacity = cell.count;
+            cell.count    = 0;
+            first += cell.capacity;
+        }
+
+        m_entries.assign(first, {});
+        for (size_t i = 0; i < bounds.size(); ++i) {
+            Location &location = m_locations[i];
+            if (location.cell == NO_CELL)
+                continue;
+
+            Cell &cell                            = m_cells[location.cell];
+            location.slot                         = cell.count++;
+            m_entries[cell.first + location.slot] = Entry {.bounds = bounds[i], .item = (uint32_t)i};
+        }
+    }
+
+    void HashedGrid::update(span<const Aabb> bounds, JobSystem &jobs)
+    {
+        if (bounds.size() != m_locations.size())
+            throw Exception(
+                fmt::format("Grid was built with {} items, but {} were given", m_locations.size(), bounds.size()));
+
+        vector<uint8_t> moved(bounds.size(), 0);
+        jobs.parallel_for(bounds.size(), UPDATE_BATCH, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const Location &location = m_locations[i];
+
+                if (location.cell == NO_CELL)
+                    moved[i] = !bounds[i].empty();
+                else
+                    moved[i] = m_entries[m_cells[location.cell].first + location.slot].bounds != bounds[i];
+            }
+        });
+
+        for (size_t i = 0; i < moved.size(); ++i)
+            if (moved[i])
+                move((uint32_t)i, bounds[i]);
+    }
+
+    size_t HashedGrid::size() const noexcept
+    {
+        return m_locations.size();
+    }
+
+    uint32_t HashedGrid::insert(const Aabb &bounds)
+    {
+        uint32_t item = (uint32_t)m_locations.size();
+        m_locations.push_back({});
+
+        if (!bounds.empty())
+            insert_entry(item, bounds);
+
+        return item;
+    }
+
+    void HashedGrid::move(uint32_t item, const Aabb &bounds)
+    {
+        if (item >= m_locations.size())
+            throw Exception(fmt::format("Grid has no item {}", item));
+
+        Location location = m_locations[item];
+        if (location.cell != NO_CELL) {
+            Cell &cell = m_cells[location.cell];
+
+            // Items staying in their cell only need their bounds replaced
+            if (!bounds.empty() && cell_of(bounds.center()) == cell.coord) {
+                m_entries[cell.first + location.slot].bounds = bounds;
+                cell.bounds.expand(bounds);
+                m_margin = std::max(m_margin, max_half_extent(bounds));
+                return;
+            }
+
+            remove_entry(item);
+        }
+
+        if (!bounds.empty())
+            insert_entry(item, bounds);
+    }
+
+    void HashedGrid::remove(uint32_t item)
+    {
+        move(item, Aabb {});
+    }
+
+    float HashedGrid::cell_size() const noexcept
+    {
+        return m_cell_size;
+    }
+
+    size_t HashedGrid::cell_count() const noexcept
+    {
+        return m_cells.size();
+    }
+
+    glm::ivec3 HashedGrid::cell_of(const glm::vec3 &point) const
+    {
+        auto coordinate = [&](float value) {
+            float cell = std::floor(value * m_inverse_cell);
+
+            // Written so that NaN maps to the lower limit
+            if (!(cell > float(-COORD_LIMIT)))
+                return -COORD_LIMIT;
+            return cell < float(COORD_LIMIT) ? int(cell) : COORD_LIMIT;
+        };
+
+        return {coordinate(point.x), coordinate(point.y), coordinate(point.z)};
+    }
+
+    Aabb HashedGrid::loose_bounds(const glm::ivec3 &low, const glm::ivec3 &high) const
+    {
+        return Aabb {glm::vec3(low) * m_cell_size - m_margin, glm::vec3(high + 1) * m_cell_size + m_margin};
+    }
+
+    const HashedGrid::Cell *HashedGrid::find(const glm::ivec3 &coord) const
+    {
+        if (m_slots.empty())
+            return nullptr;
+
+        uint64_t key  = cell_key(coord);
+        size_t   mask = m_slots.size() - 1;
+
+        for (size_t i = home_slot(key);; i = (i + 1) & mask) {
+            const Slot &slot = m_slots[i];
+            if (slot.key == key)
+                return &m_cells[slot.cell];
+            if (slot.key == EMPTY_SLOT)
+                return nullptr;
+        }
+    }
+
+    uint32_t HashedGrid::acquire_cell(const glm::ivec3 &coord)
+    {
+        if (const Cell *existing = find(coord))
+            return uint32_t(existing - m_cells.data());
+
+        uint32_t index = (uint32_t)m_cells.size();
+        m_cells.push_back(Cell {.coord = coord});
+
+        if (m_cells.size() * 2 > m_slots.size())
+            rehash(std::max(MIN_SLOTS, m_slots.size() * 2));
+        else
+            assign_slot(cell_key(coord), index);
+
+        return index;
+    }
+
+    void HashedGrid::track(const glm::ivec3 &coord, const Aabb &bounds)
+    {
+        m_margin   = std::max(m_margin, max_half_extent(bounds));
+        m_min_cell = glm::min(m_min_cell, coord);
+        m_max_cell = glm::max(m_max_cell, coord);
+    }
+
+    void HashedGrid::insert_entry(uint32_t item, const Aabb &bounds)
+    {
+        glm::ivec3 coord = cell_of(bounds.center());
+        uint32_t   index = acquire_cell(coord);
+        Cell      &cell  = m_cells[index];
+
+        if (cell.count == cell.capacity)
+            grow(cell);
+
+        cell.bounds.expand(bounds);
+        m_entries[cell.first + cell.count] = Entry {.bounds = bounds, .item = item};
+        m_locations[item]                  = Location {.cell = index, .slot = cell.count++};
+
+        track(coord, bounds);
+    }
+
+    void HashedGrid::remove_entry(uint32_t item)
+    {
+        Location location = m_locations[item];
+        Cell    &cell     = m_cells[location.cell];
+        Entry   *range    = m_entries.data() + cell.first;
+
+        range[location.slot]                        = range[--cell.count];
+        m_locations[range[location.slot].item].slot = location.slot;
+        m_locations[item]                           = {};
+
+        if (cell.count > 0)
+            return;
+
+        // Keep the cells dense by moving the last one into the emptied slot
+        uint32_t first = cell.first, capacity = cell.capacity;
+
+        erase_slot(cell_key(cell.coord));
+        if (location.cell != m_cells.size() - 1) {
+            cell = m_cells.back();
+            assign_slot(cell_key(cell.coord), location.cell);
+
+            for (const Entry &entry : entries(cell))
+                m_locations[entry.item].cell = location.cell;
+        }
+        m_cells.pop_back();
+
+        release(first, capacity);
+    }
+
+    span<const HashedGrid::Entry> HashedGrid::entries(const Cell &cell) const
+    {
+        return {m_entries.data() + cell.first, cell.count};
+    }
+
+    void HashedGrid::grow(Cell &cell)
+    {
+        uint32_t capacity = std::max(MIN_CELL_ENTRIES, cell.capacity * 2);
+
+        // The last range of the pool grows in place
+        if (cell.capacity > 0 && cell.first + cell.capacity == m_entries.size()) {
+            m_entries.resize(cell.first + capacity);
+            cell.capacity = capacity;
+            return;
+        }
+
+        uint32_t first = (uint32_t)m_entries.size();
+        m_entries.resize(first + capacity);
+        std::copy_n(m_entries.begin() + cell.first, cell.count, m_entries.begin() + first);
+
+        uint32_t old_first = cell.first, old_capacity = cell.capacity;
+        cell.first    = first;
+        cell.capacity = capacity;
+        release(old_first, old_capacity);
+    }
+
+    void HashedGrid::release(uint32_t first, uint32_t capacity)
+    {
+        // Trim the pool rather than leaving a released range at its end
+        if (first + capacity == m_entries.size()) {
+            m_entries.resize(first);
+            return;
+        }
+
+        m_released += capacity;
+        if (m_entries.size() > MIN_COMPACT && m_released * 2 > m_entries.size())
+            compact();
+    }
+
+    void HashedGrid::compact()
+    {
+        vector<Entry> packed = {};
+        packed.reserve(m_entries.size() - m_released);
+
+        // Cells keep their capacity, so that a cell being grown still has room once the pool is compacted
+        for (Cell &cell : m_cells) {
+            span<const Entry> used  = entries(cell);
+            uint32_t          first = (uint32_t)packed.size();
+
+            packed.insert(packed.end(), used.begin(), used.end());
+            packed.resize(first + cell.capacity);
+            cell.first = first;
+        }
+
+        m_entries  = std::move(packed);
+        m_released = 0;
+    }
+
+    size_t HashedGrid::home_slot(uint64_t key) const
+    {
+        // Fibonacci hashing spreads the packed coordinates of neighbouring cells over the table
+        return size_t((key * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+
+    void HashedGrid::assign_slot(uint64_t key, uint32_t cell)
+    {
+        size_t mask = m_slots.size() - 1;
+        size_t i    = home_slot(key);
+
+        while (m_slots[i].key != key && m_slots[i].key != EMPTY_SLOT)
+            i = (i + 1) & mask;
+
+        m_slots[i] = Slot {.key = key, .cell = cell};
+    }
+
+    void HashedGrid::erase_slot(uint64_t key)
+    {
+        size_t mask = m_slots.size() - 1;
+        size_t hole = home_slot(key);
+
+        while (m_slots[hole].key != key)
+            hole = (hole + 1) & mask;
+
+        // Shift back the following slots which may no longer be reached past the hole, so no tombstones are needed
+        for (size_t i = (hole + 1) & mask; m_slots[i].key != EMPTY_SLOT; i = (i + 1) & mask) {
+            size_t home = home_slot(m_slots[i].key);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                m_slots[hole] = m_slots[i];
+                hole          = i;
+            }
+        }
+
+        m_slots[hole] = {};
+    }
+
+    void HashedGrid::rehash(size_t capacity)
+    {
+        m_slots.assign(capacity, {});
+        m_shift = 64 - std::countr_zero(capacity);
+
+        for (size_t i = 0; i < m_cells.size(); ++i)
+            assign_slot(cell_key(m_cells[i].coord), (uint32_t)i);
+    }
+
+    template<class Visit>
+    void HashedGrid::visit_cells(glm::ivec3 low, glm::ivec3 high, Visit &&visit) const
+    {
+        low  = glm::max(low, m_min_cell);
+        high = glm::min(high, m_max_cell);
+        if (m_cells.empty() || glm::any(glm::greaterThan(low, high)))
+            return;
+
+        // Look up the cells in the range, unless there are fewer occupied cells than that to scan
+        glm::ivec3 span = high - low + 1;
+        if (uint64_t(span.x) * uint64_t(span.y) * uint64_t(span.z) > m_cells.size()) {
+            for (const Cell &cell : m_cells)
+                if (glm::all(glm::lessThanEqual(low, cell.coord)) && glm::all(glm::lessThanEqual(cell.coord, high)))
+                    visit(cell);
+            return;
+        }
+
+        for (int x = low.x; x <= high.x; ++x)
+            for (int y = low.y; y <= high.y; ++y)
+                for (int z = low.z; z <= high.z; ++z)
+                    if (const Cell *cell = find({x, y, z}))
+                        visit(*cell);
+    }
+
+    void HashedGrid::visit_frustum(const Frustum &frustum, const glm::ivec3 &low, const glm::ivec3 &high, bool inside,
+                                   vector<uint32_t> &out) const
+    {
+        // Ranges are classified by the bounds their items may have, so whole blocks of the grid are skipped or
+        // accepted without looking up their cells
+        if (!inside) {
+            Frustum::Containment containment = frustum.classify(loose_bounds(low, high));
+            if (containment == Frustum::Containment::Outside)
+                return;
+            inside = containment == Frustum::Containment::Inside;
+        }
+
+        glm::ivec3 span = high - low + 1;
+        if (inside || uint64_t(span.x) * uint64_t(span.y) * uint64_t(span.z) <= FRUSTUM_LEAF_CELLS) {
+            visit_cells(low, high, [&](const Cell &cell) {
+                auto containment = inside ? Frustum::Containment::Inside : frustum.classify(cell.bounds);
+
+                if (containment == Frustum::Containment::Inside) {
+                    for (const Entry &entry : entries(cell))
+                        out.push_back(entry.item);
+                } else if (containment == Frustum::Containment::Intersecting) {
+                    for (const Entry &entry : entries(cell))
+                        if (frustum.intersects(entry.bounds))
+                            out.push_back(entry.item);
+                }
+            });
+            return;
+        }
+
+        // Halve the range along its longest axis
+        int axis = span.x >= span.y ? (span.x >= span.z ? 0 : 2) : (span.y >= span.z ? 1 : 2);
+        int mid  = low[axis] + span[axis] / 2;
+
+        glm::ivec3 split_high = high;
+        glm::ivec3 split_low  = low;
+        split_high[axis]      = mid - 1;
+        split_low[axis]       = mid;
+
+        visit_frustum(frustum, low, split_high, false, out);
+        visit_frustum(frustum, split_low, high, false, out);
+    }
+
+    void HashedGrid::query_frustum(const Frustum &frustum, vector<uint32_t> &out) const
+    {
+        if (!m_cells.empty())
+            visit_frustum(frustum, m_min_cell, m_max_cell, false, out);
+    }
+
+    void HashedGrid::query_aabb(const Aabb &box, vector<uint32_t> &out) const
+    {
+        if (box.empty())
+            return;
+
+        visit_cells(cell_of(box.min - m_margin), cell_of(box.max + m_margin), [&](const Cell &cell) {
+            if (!cell.bounds.overlaps(box))
+                return;
+
+            for (const Entry &entry : entries(cell))
+                if (entry.bounds.overlaps(box))
+                    out.push_back(entry.item);
+        });
+    }
+
+    optional<RayHit> HashedGrid::raycast(const Ray &ray) const
+    {
+        if (m_cells.empty())
+            return nullopt;
+
+        // An item hit at a point has its center within this many cells of the point's cell
+        int        reach = (int)std::ceil(m_margin * m_inverse_cell);
+        glm::ivec3 low   = m_min_cell - reach;
+        glm::ivec3 high  = m_max_cell + reach;
+
+        glm::vec3 inverse = 1.0f / ray.direction;
+        Ray       bounded = ray;
+
+        // Clip the ray to the cells which may hold a hit
+        Aabb  region = {glm::vec3(low) * m_cell_size, glm::vec3(high + 1) * m_cell_size};
+        float enter  = 0.0f;
+        if (!bounded.intersect(region, inverse, enter))
+            return nullopt;
+
+        optional<RayHit> closest = nullopt;
+
+        auto test = [&](const Cell &cell) {
+            float hit;
+            if (!bounded.intersect(cell.bounds, inverse, hit) || hit > bounded.max_distance)
+                return;
+
+            for (const Entry &entry : entries(cell))
+                if (bounded.intersect(entry.bounds, inverse, hit) && hit <= bounded.max_distance) {
+                    closest              = RayHit {.item = entry.item, .distance = hit};
+                    bounded.max_distance = hit;
+                }
+        };
+
+        glm::ivec3 cell  = glm::clamp(cell_of(ray.origin + ray.direction * enter), low, high);
+        glm::ivec3 step  = {};
+        glm::vec3  next  = {};
+        glm::vec3  delta = {};
+
+        for (int axis = 0; axis < 3; ++axis) {
+            float direction = ray.direction[axis];
+            step[axis]      = direction > 0.0f ? 1 : direction < 0.0f ? -1 : 0;
+
+            if (step[axis] == 0) {
+                next[axis]  = std::numeric_limits<float>::infinity();
+                delta[axis] = std::numeric_limits<float>::infinity();
+            } else {
+                float boundary = float(cell[axis] + (step[axis] > 0 ? 1 : 0)) * m_cell_size;
+                next[axis]     = (boundary - ray.origin[axis]) * inverse[axis];
+                delta[axis]    = std::abs(m_cell_size * inverse[axis]);
+            }
+        }
+
+        visit_cells(cell - reach, cell + reach, test);
+
+        // Walk the cells along the ray. Each step only exposes the slab of neighbours on the far side of the step,
+        // since the rest of the neighbourhood was tested by earlier cells.
+        while (true) {
+            int   axis     = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+            float distance = next[axis];
+
+            if (distance > bounded.max_distance || !std::isfinite(distance))
+                break;
+
+            cell[axis] += step[axis];
+            next[axis] += delta[axis];
+            if (cell[axis] < low[axis] || cell[axis] > high[axis])
+                break;
+
+            glm::ivec3 from = cell - reach;
+            glm::ivec3 to   = cell + reach;
+            from[axis]      = cell[axis] + step[axis] * reach;
+            to[axis]        = from[axis];
+            visit_cells(from, to, test);
+        }
+
+        return closest;
+    }
+
+    void HashedGrid::query_nearest(const glm::vec3 &point, size_t k, vector<uint32_t> &out) const
+    {
+        if (m_cells.empty() || k == 0)
+            return;
+
+        using Candidate = std::pair<float, uint32_t>;
+
+        // The best items found so far, with the furthest on top
+        std::priority_queue<Candidate> best = {};
+
+        auto test = [&](int x, int y, int z) {
+            const Cell *cell = find({x, y, z});
+            if (!cell || (best.size() == k && cell->bounds.distance_squared(point) >= best.top().first))
+                return;
+
+            for (const Entry &entry : entries(*cell)) {
+                float distance = entry.bounds.distance_squared(point);
+
+                if (best.size() < k) {
+                    best.push({distance, entry.item});
+                } else if (distance < best.top().first) {
+                    best.pop();
+                    best.push({distance, entry.item});
+                }
+            }
+        };
+
+        // Search rings of cells around the point's cell, starting with the first ring to reach an occupied cell
+        glm::ivec3 center = cell_of(point);
+        glm::ivec3 gap    = glm::max(glm::max(m_min_cell - center, center - m_max_cell), glm::ivec3(0));
+
+        for (int ring = std::max({gap.x, gap.y, gap.z});; ++ring) {
+            // Items of this ring and beyond are at least this far from the point
+            float reach = std::max(0.0f, float(ring - 1) * m_cell_size - m_margin);
+            if (best.size() == k && reach * reach >= best.top().first)
+                break;
+
+            glm::ivec3 from = glm::max(center - ring, m_min_cell);
+            glm::ivec3 to   = glm::min(center + ring, m_max_cell);
+
+            for (int x = from.x; x <= to.x; ++x)
+                for (int y = from.y; y <= to.y; ++y) {
+                    if (std::abs(x - center.x) == ring || std::abs(y - center.y) == ring) {
+                        for (int z = from.z; z <= to.z; ++z)
+                            test(x, y, z);
+                        continue;
+                    }
+
+                    for (int z : {center.z - ring, center.z + ring}) {
+                        if (z >= from.z && z <= to.z)
+                            test(x, y, z);
+                        if (ring == 0)
+                            break;
+                    }
+                }
+
+            // Stop once the ring covers every occupied cell
+            if (glm::all(glm::lessThanEqual(center - ring, m_min_cell))
+                && glm::all(glm::greaterThanEqual(center + ring, m_max_cell)))
+                break;
+        }
+
+        size_t first = out.size();
+        out.resize(first + best.size());
+        for (size_t i = out.size(); i-- > first; best.pop())
+            out[i] = best.top().second;
+    }
+} // namespace engine
@@ -0,0 +1,169 @@
+#include "scene/object_store.hpp"
+#include "exceptions.hpp"
+#include <array>
+#include <chrono>
+#include <fmt/format.h>
+#include <numeric>
+
+using std::vector, std::shared_ptr, std::chrono::steady_clock;
+
+namespace engine
+{
+    /// Passes over the objects timed by the benchmark, of which the fastest is kept
+    static constexpr int BENCHMARK_PASSES = 8;
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    ObjectStore::ObjectStore() = default;
+
+    ObjectStore::~ObjectStore() = default;
+
+    void ObjectStore::erase(uint32_t index)
+    {
+        if (index >= m_objects.size())
+            throw Exception(fmt::format("Object {} does not exist", index));
+
+        Entry entry = m_objects[index];
+        m_buckets[entry.bucket]->erase(entry.slot);
+
+        if (index + 1 != m_objects.size()) {
+            m_objects[index] = m_objects.back();
+
+            const Entry &moved                           = m_objects[index];
+            m_buckets[moved.bucket]->indices[moved.slot] = index;
+        }
+        m_objects.pop_back();
+        ++m_version;
+    }
+
+    void ObjectStore::clear()
+    {
+        m_objects.clear();
+        m_buckets.clear();
+        ++m_version;
+    }
+
+    size_t ObjectStore::size() const noexcept
+    {
+        return m_objects.size();
+    }
+
+    bool ObjectStore::empty() const noexcept
+    {
+        return m_objects.empty();
+    }
+
+    uint64_t ObjectStore::version() const noexcept
+    {
+        return m_version;
+    }
+
+    Object &ObjectStore::operator[](uint32_t index) noexcept
+    {
+        return *m_objects[index].object;
+    }
+
+    const Object &ObjectStore::operator[](uint32_t index) const noexcept
+    {
+        return *m_objects[index].object;
+    }
+
+    ObjectStore::Key ObjectStore::key(uint32_t index) const noexcept
+    {
+        return Key {.bucket = m_objects[index].bucket, .slot = m_objects[index].slot};
+    }
+
+    uint32_t ObjectStore::index(Key key) const noexcept
+    {
+        return m_buckets[key.bucket]->indices[key.slot];
+    }
+
+    void ObjectStore::draw(DrawingContext &context)
+    {
+        for (auto &bucket : m_buckets)
+            bucket->draw_all(context);
+    }
+
+    void ObjectStore::draw(DrawingContext &context, std::span<const uint32_t> indices)
+    {
+        for (uint32_t i = 0; i < indices.size(); ++i) {
+            const Entry &entry = m_objects[indices[i]];
+            m_buckets[entry.bucket]->pending.push_back({.slot = entry.slot, .item = i});
+        }
+
+        for (auto &bucket : m_buckets)
+            if (!bucket->pending.empty())
+                bucket->draw_pending(context);
+    }
+
+    /// Smallest object which does some work when drawn, so that the loops cannot be removed
+    class BenchmarkObject final : public Object
+    {
+      public:
+        BenchmarkObject(TransformRegistry &registry)
+            : Object(registry)
+        { }
+
+        void draw(DrawingContext &context) override
+        {
+            context.occlusion_item += 1;
+        }
+    };
+
+    /// Time the fastest of a few passes of `pass`
+    template<class Pass>
+    static double time_passes(Pass &&pass)
+    {
+        double best = 0.0;
+        for (int i = 0; i < BENCHMARK_PASSES; ++i) {
+            auto start = steady_clock::now();
+            pass();
+            double ms = Milliseconds(steady_clock::now() - start).count();
+            best      = i == 0 ? ms : std::min(best, ms);
+        }
+        return best;
+    }
+
+    ObjectStoreBenchmark benchmark_object_store(size_t count)
+    {
+        TransformRegistry registry;
+
+        std::array<vk::DescriptorSet, MAX_DESCRIPTORS> descriptors = {};
+        DrawingContext                                 context     = {.descriptors = descriptors};
+
+        ObjectStoreBenchmark result = {};
+        result.count                = count;
+
+        {
+            vector<shared_ptr<Object>> objects = {};
+            objects.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+                objects.push_back(std::make_shared<BenchmarkObject>(registry));
+
+            result.pointer_ms = time_passes([&]() {
+                for (auto &object : objects)
+                    if (object->transform.visible())
+                        object->draw(context);
+            });
+
+            result.copy_ms = time_passes([&]() {
+                for (shared_ptr<Object> object : objects)
+                    if (object->transform.visible())
+                        object->draw(context);
+            });
+        }
+
+        ObjectStore store;
+        for (size_t i = 0; i < count; ++i)
+            store.emplace<BenchmarkObject>(registry);
+
+        result.store_ms = time_passes([&]() { store.draw(context); });
+
+        vector<uint32_t> indices(count);
+        std::iota(indices.begin(), indices.end(), 0);
+
+        result.store_set_ms = time_passes([&]() { store.draw(context, indices); });
+
+        return result;
+    }
+} // namespace engine
@@ -0,0 +1,91 @@
+#include "scene/spatial_index.hpp"
+#include <chrono>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+
+using std::vector, std::chrono::steady_clock;
+
+namespace engine
+{
+    /// Queries of each kind timed by the benchmark
+    static constexpr size_t BENCHMARK_QUERIES = 256;
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    SpatialBenchmark benchmark_spatial_index(SpatialIndex &index, size_t count, JobSystem &jobs)
+    {
+        // Keep the density constant, so that queries find about as many items at any count
+        float world = 4.0f * std::cbrt(float(count));
+
+        std::mt19937                          rng(count);
+        std::uniform_real_distribution<float> position(0.0f, world);
+        std::uniform_real_distribution<float> size(0.25f, 2.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        vector<Aabb> bounds(count);
+        for (Aabb &box : bounds) {
+            glm::vec3 min = {position(rng), position(rng), position(rng)};
+            box           = Aabb {min, min + glm::vec3(size(rng), size(rng), size(rng))};
+        }
+
+        SpatialBenchmark result = {};
+        result.index            = index.name();
+        result.count            = count;
+
+        auto start      = steady_clock::now();
+        index.build(bounds, jobs);
+        result.build_ms = Milliseconds(steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < count; i += 10) {
+            glm::vec3 offset = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.5f;
+            bounds[i]        = Aabb {bounds[i].min + offset, bounds[i].max + offset};
+        }
+
+        start            = steady_clock::now();
+        index.update(bounds, jobs);
+        result.update_ms = Milliseconds(steady_clock::now() - start).count();
+
+        auto random_point = [&]() { return glm::vec3(position(rng), position(rng), position(rng)); };
+
+        vector<Frustum>   frustums(BENCHMARK_QUERIES);
+        vector<Aabb>      boxes(BENCHMARK_QUERIES);
+        vector<Ray>       rays(BENCHMARK_QUERIES);
+        vector<glm::vec3> points(BENCHMARK_QUERIES);
+
+        glm::mat4 projection = glm::perspectiveZO(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+        for (size_t i = 0; i < BENCHMARK_QUERIES; ++i) {
+            glm::vec3 eye = random_point();
+            frustums[i]   = Frustum::from_matrix(projection * glm::lookAt(eye, random_point(), glm::vec3(0, 0, 1)));
+
+            glm::vec3 corner = random_point();
+            boxes[i]         = Aabb {corner, corner + glm::vec3(4.0f)};
+            rays[i]          = Ray {.origin = random_point(), .direction = glm::normalize(random_point() - eye)};
+            points[i]        = random_point();
+        }
+
+        vector<uint32_t> found = {};
+        found.reserve(count);
+
+        auto time = [&](auto &&query) {
+            auto begin = steady_clock::now();
+            for (size_t i = 0; i < BENCHMARK_QUERIES; ++i) {
+                found.clear();
+                query(i);
+            }
+            return std::chrono::duration<double, std::micro>(steady_clock::now() - begin).count() / BENCHMARK_QUERIES;
+        };
+
+        size_t frustum_hits = 0;
+        result.frustum_us   = time([&](size_t i) {
+            index.query_frustum(frustums[i], found);
+            frustum_hits += found.size();
+        });
+        result.aabb_us      = time([&](size_t i) { index.query_aabb(boxes[i], found); });
+        result.raycast_us   = time([&](size_t i) { (void)index.raycast(rays[i]); });
+        result.nearest_us   = time([&](size_t i) { index.query_nearest(points[i], 8, found); });
+        result.frustum_hits = frustum_hits / BENCHMARK_QUERIES;
+
+        return result;
+    }
+} // namespace engine
@@ -0,0 +1,325 @@
+#include "scene/transform_registry.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <numeric>
+
+using std::span, std::vector;
+
+namespace engine
+{
+    template<class T>
+    static void permute(vector<T> &values, const vector<uint32_t> &order)
+    {
+        vector<T> sorted = {};
+        sorted.reserve(values.size());
+
+        for (uint32_t i : order)
+            sorted.push_back(std::move(values[i]));
+
+        values = std::move(sorted);
+    }
+
+    Entity TransformRegistry::create()
+    {
+        Entity entity;
+        if (!m_free.empty()) {
+            entity = m_free.back();
+            m_free.pop_back();
+        } else {
+            entity = (Entity)m_sparse.size();
+            m_sparse.push_back(NO_INDEX);
+            m_children.push_back(0);
+        }
+
+        m_sparse[entity] = (uint32_t)m_entities.size();
+
+        m_entities.push_back(entity);
+        m_locations.push_back({0.0, 0.0, 0.0});
+        m_orientations.push_back({1.0, 0.0, 0.0, 0.0});
+        m_scales.push_back({1.0, 1.0, 1.0});
+        m_flags.push_back(TransformFlags::Visible | TransformFlags::LocalDirty);
+        m_parents.push_back(NULL_ENTITY);
+        m_parent_ix.push_back(NO_INDEX);
+        m_local.push_back(glm::mat4 {1.0});
+        m_world.push_back(glm::mat4 {1.0});
+        m_versions.push_back(0);
+
+        // Roots only break the depth order if they follow a deeper level
+        if (m_levels.size() > 2)
+            m_unsorted = true;
+        else
+            m_levels = {0, m_entities.size()};
+
+        return entity;
+    }
+
+    void TransformRegistry::destroy(Entity entity)
+    {
+        uint32_t removed = index(entity);
+
+        if (m_parents[removed] != NULL_ENTITY)
+            --m_children[m_parents[removed]];
+
+        for (size_t i = 0; m_children[entity] > 0 && i < m_entities.size(); ++i)
+            if (m_parents[i] == entity) {
+                m_parents[i] = NULL_ENTITY;
+                m_flags[i] |= TransformFlags::WorldDirty;
+                --m_children[entity];
+            }
+
+        // Swap with the last entity and pop
+        uint32_t last = (uint32_t)m_entities.size() - 1;
+        if (removed != last) {
+            m_sparse[m_entities[last]] = removed;
+
+            m_entities[removed]     = m_entities[last];
+            m_locations[removed]    = m_locations[last];
+            m_orientations[removed] = m_orientations[last];
+            m_scales[removed]       = m_scales[last];
+            m_flags[removed]        = m_flags[last];
+            m_parents[removed]      = m_parents[last];
+            m_local[removed]        = m_local[last];
+            m_world[removed]        = m_world[last];
+            m_versions[removed]     = m_versions[last];
+        }
+
+        m_entities.pop_back();
+        m_locations.pop_back();
+        m_orientations.pop_back();
+        m_scales.pop_back();
+        m_flags.pop_back();
+        m_parents.pop_back();
+        m_parent_ix.pop_back();
+        m_local.pop_back();
+        m_world.pop_back();
+        m_versions.pop_back();
+
+        m_sparse[entity] = NO_INDEX;
+        m_free.push_back(entity);
+        m_unsorted = true;
+    }
+
+    bool TransformRegistry::contains(Entity entity) const noexcept
+    {
+        return entity < m_sparse.size() && m_sparse[entity] != NO_INDEX;
+    }
+
+    size_t TransformRegistry::size() const noexcept
+    {
+        return m_entities.size();
+    }
+
+    void TransformRegistry::set_parent(Entity entity, Entity parent)
+    {
+        uint32_t i = index(entity);
+
+        for (Entity ancestor = parent; ancestor != NULL_ENTITY; ancestor = m_parents[index(ancestor)])
+            if (ancestor == entity)
+                throw Exception(fmt::format("Entity {} cannot be parented to its descendant {}", entity, parent));
+
+        if (m_parents[i] != NULL_ENTITY)
+            --m_children[m_parents[i]];
+        if (parent != NULL_ENTITY)
+            ++m_children[parent];
+
+        m_parents[i] = parent;
+        m_unsorted   = true;
+        m_flags[i] |= TransformFlags::WorldDirty;
+    }
+
+    Entity TransformRegistry::parent(Entity entity) const
+    {
+        return m_parents[index(entity)];
+    }
+
+    glm::vec3 TransformRegistry::location(Entity entity) const
+    {
+        return m_locations[index(entity)];
+    }
+
+    glm::vec3 TransformRegistry::rotation(Entity entity) const
+    {
+        return quat_to_euler(m_orientations[index(entity)]);
+    }
+
+    glm::quat TransformRegistry::orientation(Entity entity) const
+    {
+        return m_orientations[index(entity)];
+    }
+
+    glm::vec3 TransformRegistry::scale(Entity entity) const
+    {
+        return m_scales[index(entity)];
+    }
+
+    TransformFlags TransformRegistry::flags(Entity entity) const
+    {
+        return m_flags[index(entity)];
+    }
+
+    glm::mat4 TransformRegistry::world(Entity entity) const
+    {
+        return m_world[index(entity)];
+    }
+
+    uint64_t TransformRegistry::version(Entity entity) const
+    {
+        return m_versions[index(entity)];
+    }
+
+    void TransformRegistry::set_location(Entity entity, const glm::vec3 &location)
+    {
+        uint32_t i = index(entity);
+        if (m_locations[i] == location)
+            return;
+
+        m_locations[i] = location;
+        m_flags[i] |= TransformFlags::LocalDirty;
+    }
+
+    void TransformRegistry::set_rotation(Entity entity, const glm::vec3 &rotation)
+    {
+        set_orientation(entity, euler_to_quat(rotation));
+    }
+
+    void TransformRegistry::set_orientation(Entity entity, const glm::quat &orientation)
+    {
+        uint32_t  i          = index(entity);
+        glm::quat normalized = glm::normalize(orientation);
+        if (m_orientations[i] == normalized)
+            return;
+
+        m_orientations[i] = normalized;
+        m_flags[i] |= TransformFlags::LocalDirty;
+    }
+
+    void TransformRegistry::set_scale(Entity entity, const glm::vec3 &scale)
+    {
+        uint32_t i = index(entity);
+        if (m_scales[i] == scale)
+            return;
+
+        m_scales[i] = scale;
+        m_flags[i] |= TransformFlags::LocalDirty;
+    }
+
+    void TransformRegistry::set_flags(Entity entity, TransformFlags flags)
+    {
+        uint32_t i = index(entity);
+        m_flags[i] = (flags & ~TransformFlags::Internal) | (m_flags[i] & TransformFlags::Internal);
+    }
+
+    void TransformRegistry::sort()
+    {
+        if (!m_unsorted)
+            return;
+
+        size_t count = m_entities.size();
+
+        // Depths are resolved by walking up to the nearest ancestor with a known depth
+        constexpr uint32_t UNKNOWN = ~uint32_t(0);
+        vector<uint32_t>   depths(count, UNKNOWN);
+        vector<uint32_t>   chain = {};
+
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t node = i;
+            while (depths[node] == UNKNOWN && m_parents[node] != NULL_ENTITY) {
+                chain.push_back(node);
+                node = m_sparse[m_parents[node]];
+            }
+
+            if (depths[node] == UNKNOWN)
+                depths[node] = 0;
+
+            for (uint32_t depth = depths[node] + 1; !chain.empty(); chain.pop_back())
+                depths[chain.back()] = depth++;
+        }
+
+        vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+
+        permute(m_entities, order);
+        permute(m_locations, order);
+        permute(m_orientations, order);
+        permute(m_scales, order);
+        permute(m_flags, order);
+        permute(m_parents, order);
+        permute(m_local, order);
+        permute(m_world, order);
+        permute(m_versions, order);
+
+        m_levels.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            m_sparse[m_entities[i]] = i;
+
+            while (m_levels.size() <= depths[order[i]])
+                m_levels.push_back(i);
+        }
+        m_levels.push_back(count);
+
+        for (uint32_t i = 0; i < count; ++i)
+            m_parent_ix[i] = m_parents[i] == NULL_ENTITY ? NO_INDEX : m_sparse[m_parents[i]];
+
+        m_unsorted = false;
+    }
+
+    span<const Entity> TransformRegistry::entities() const noexcept
+    {
+        return m_entities;
+    }
+
+    span<const glm::vec3> TransformRegistry::locations() const noexcept
+    {
+        return m_locations;
+    }
+
+    span<const glm::quat> TransformRegistry::orientations() const noexcept
+    {
+        return m_orientations;
+    }
+
+    span<const glm::vec3> TransformRegistry::scales() const noexcept
+    {
+        return m_scales;
+    }
+
+    span<TransformFlags> TransformRegistry::flags() noexcept
+    {
+        return m_flags;
+    }
+
+    span<const uint32_t> TransformRegistry::parent_indices() const noexcept
+    {
+        return m_parent_ix;
+    }
+
+    span<glm::mat4> TransformRegistry::local_matrices() noexcept
+    {
+        return m_local;
+    }
+
+    span<glm::mat4> TransformRegistry::world_matrices() noexcept
+    {
+        return m_world;
+    }
+
+    span<uint64_t> TransformRegistry::versions() noexcept
+    {
+        return m_versions;
+    }
+
+    span<const size_t> TransformRegistry::levels() const noexcept
+    {
+        return m_levels;
+    }
+
+    uint32_t TransformRegistry::index(Entity entity) const
+    {
+        if (!contains(entity))
+            throw Exception(fmt::format("Entity {} does not exist", entity));
+
+        return m_sparse[entity];
+    }
+} // namespace engine
@@ -0,0 +1,75 @@
+#include "scene/transform_system.hpp"
+#include "math/trs_kernel.hpp"
+
+namespace engine
+{
+    void TransformSystem::update(TransformRegistry &registry, JobSystem &jobs)
+    {
+        constexpr TransformFlags DIRTY = TransformFlags::LocalDirty | TransformFlags::WorldDirty;
+
+        registry.sort();
+
+        auto levels       = registry.levels();
+        auto locations    = registry.locations();
+        auto orientations = registry.orientations();
+        auto scales       = registry.scales();
+        auto parents      = registry.parent_indices();
+        auto flags        = registry.flags();
+        auto local        = registry.local_matrices();
+        auto world        = registry.world_matrices();
+        auto versions     = registry.versions();
+
+        m_updated = 0;
+
+        // Local matrices only depend on their own transform, so they are all rebuilt up front, a dirty run at a time
+        jobs.parallel_for(local.size(), batch_size, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end;) {
+                if (!(flags[i] & TransformFlags::LocalDirty)) {
+                    ++i;
+                    continue;
+                }
+
+                size_t run = i;
+                while (i < end && !!(flags[i] & TransformFlags::LocalDirty))
+                    ++i;
+
+                size_t length = i - run;
+                math::compose_transforms(locations.subspan(run, length), orientations.subspan(run, length),
+                                         scales.subspan(run, length), local.subspan(run, length), simd_level);
+            }
+        });
+
+        // Parents are always in an earlier level, so a level only reads matrices and flags which are already final.
+        for (size_t level = 0; level + 1 < levels.size(); ++level) {
+            size_t first = levels[level];
+            size_t count = levels[level + 1] - first;
+
+            jobs.parallel_for(count, batch_size, [&](size_t begin, size_t end) {
+                size_t updated = 0;
+
+                for (size_t i = first + begin; i < first + end; ++i) {
+                    uint32_t parent         = parents[i];
+                    bool     parent_changed = parent != TransformRegistry::NO_INDEX
+                                       && !!(flags[parent] & TransformFlags::WorldChanged);
+
+                    if (!(flags[i] & DIRTY) && !parent_changed) {
+                        flags[i] &= ~TransformFlags::WorldChanged;
+                        continue;
+                    }
+
+                    world[i]    = parent == TransformRegistry::NO_INDEX ? local[i] : world[parent] * local[i];
+                    versions[i] += 1;
+                    flags[i]    = (flags[i] & ~DIRTY) | TransformFlags::WorldChanged;
+                    ++updated;
+                }
+
+                m_updated += updated;
+            });
+        }
+    }
+
+    size_t TransformSystem::updated() const noexcept
+    {
+        return m_updated;
+    }
+} // namespace engine
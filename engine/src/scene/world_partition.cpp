@@ -0,0 +1,444 @@
+#include "scene/world_partition.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+
+using std::string, std::string_view, std::vector, std::filesystem::path;
+using namespace engine::reflection;
+
+namespace engine
+{
+    /// Split a line into its first word and the rest, without the spaces around them
+    static std::pair<string_view, string_view> split_word(string_view line)
+    {
+        line.remove_prefix(std::min(line.find_first_not_of(' '), line.size()));
+
+        size_t end = line.find(' ');
+        if (end == string_view::npos)
+            return {line, {}};
+
+        size_t rest = line.find_first_not_of(' ', end);
+        return {line.substr(0, end), rest == string_view::npos ? string_view() : line.substr(rest)};
+    }
+
+    template<class T>
+    static bool parse_number(string_view &text, T &value)
+    {
+        size_t start = text.find_first_not_of(' ');
+        if (start == string_view::npos)
+            return false;
+
+        auto [end, error] = std::from_chars(text.data() + start, text.data() + text.size(), value);
+        if (error != std::errc())
+            return false;
+
+        text = text.substr(end - text.data());
+        return true;
+    }
+
+    /// Write `value` into the field, through its setter if it has one
+    static void store_field(Object &object, const Field &field, const void *value, size_t size)
+    {
+        if (field.has_accessors()) {
+            if (field.setter)
+                field.setter(&object, value);
+        } else {
+            memcpy((uint8_t *)&object + field.offset, value, size);
+        }
+    }
+
+    template<class T>
+    static bool read_numbers(Object &object, const Field &field, string_view text)
+    {
+        size_t components = (FieldTypeRep(field.type & FieldTypeBits::Vec4) >> 6) + 1;
+
+        T values[4] = {};
+        for (size_t i = 0; i < components; ++i)
+            if (!parse_number(text, values[i]))
+                return false;
+
+        store_field(object, field, values, sizeof(T) * components);
+        return true;
+    }
+
+    /// Set a reflected field from its text in a cell file. Returns `false` if the text does not fit the field.
+    static bool read_field(Object &object, const Field &field, string_view text)
+    {
+        switch (FieldTypeBits(field.type & (FieldTypeBits::TypeBits | FieldTypeBits::WidthBits))) {
+        case FieldTypeBits::Int8:
+            return read_numbers<int8_t>(object, field, text);
+        case FieldTypeBits::Int16:
+            return read_numbers<int16_t>(object, field, text);
+        case FieldTypeBits::Int32:
+            return read_numbers<int32_t>(object, field, text);
+        case FieldTypeBits::Int64:
+            return read_numbers<int64_t>(object, field, text);
+        case FieldTypeBits::Uint8:
+            return read_numbers<uint8_t>(object, field, text);
+        case FieldTypeBits::Uint16:
+            return read_numbers<uint16_t>(object, field, text);
+        case FieldTypeBits::Uint32:
+            return read_numbers<uint32_t>(object, field, text);
+        case FieldTypeBits::Uint64:
+            return read_numbers<uint64_t>(object, field, text);
+        case FieldTypeBits::Float32:
+            return read_numbers<float>(object, field, text);
+        case FieldTypeBits::Float64:
+            return read_numbers<double>(object, field, text);
+
+        case FieldTypeBits::Quat32: {
+            // Written as x, y, z, w whatever order GLM stores them in
+            glm::vec4 values = {};
+            for (size_t i = 0; i < 4; ++i)
+                if (!parse_number(text, values[i]))
+                    return false;
+
+            glm::quat value = glm::quat(values.w, values.x, values.y, values.z);
+            store_field(object, field, &value, sizeof(value));
+            return true;
+        }
+        case FieldTypeBits::Boolean: {
+            if (text != "true" && text != "false")
+                return false;
+
+            bool value = text == "true";
+            store_field(object, field, &value, sizeof(value));
+            return true;
+        }
+        case FieldTypeBits::String: {
+            string value = string(text);
+            if (field.has_accessors()) {
+                if (field.setter)
+                    field.setter(&object, &value);
+            } else {
+                *(string *)((uint8_t *)&object + field.offset) = std::move(value);
+            }
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    static const Field *find_field(const Datastructure *rep, string_view name)
+    {
+        for (; rep; rep = rep->supertype)
+            for (size_t i = 0; i < rep->field_count; ++i)
+                if (name == rep->fields[i].name)
+                    return &rep->fields[i];
+
+        return nullptr;
+    }
+
+    CellData read_cell(const path &file)
+    {
+        std::ifstream stream(file);
+        if (!stream)
+            throw Exception(fmt::format("Failed to open cell \"{}\"", file.string()));
+
+        CellData      data   = {};
+        ObjectRecord *object = nullptr;
+        string        line   = {};
+
+        for (size_t number = 1; std::getline(stream, line); ++number) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            auto [keyword, rest] = split_word(line);
+            if (keyword.empty() || keyword.front() == '#')
+                continue;
+
+            auto error = [&](string_view message) {
+                return Exception(fmt::format("{}:{}: {}", file.string(), number, message));
+            };
+
+            if (object) {
+                if (keyword == "end")
+                    object = nullptr;
+                else
+                    object->fields.emplace_back(keyword, rest);
+            } else if (keyword == "cell") {
+                if (!parse_number(rest, data.coord.x) || !parse_number(rest, data.coord.y))
+                    throw error("Expected the cell's coordinates");
+            } else if (keyword == "mesh") {
+                if (rest.empty())
+                    throw error("Expected a mesh path");
+                data.meshes.emplace_back(rest);
+            } else if (keyword == "object") {
+                if (rest.empty())
+                    throw error("Expected an object type");
+                object = &data.objects.emplace_back(ObjectRecord {.type = string(rest)});
+            } else {
+                throw error(fmt::format("Unexpected \"{}\"", keyword));
+            }
+        }
+
+        if (object)
+            throw Exception(fmt::format("{}: Object \"{}\" has no end", file.string(), object->type));
+
+        return data;
+    }
+
+    void write_cell(const path &file, const CellData &cell)
+    {
+        string text = fmt::format("cell {} {}\n", cell.coord.x, cell.coord.y);
+
+        for (const string &mesh : cell.meshes)
+            text += fmt::format("mesh {}\n", mesh);
+
+        for (const ObjectRecord &object : cell.objects) {
+            text += fmt::format("\nobject {}\n", object.type);
+            for (const auto &[name, value] : object.fields) {
+                if (value.find('\n') != string::npos)
+                    throw Exception(fmt::format("Field \"{}\" of a {} spans several lines", name, object.type));
+                text += fmt::format("    {} {}\n", name, value);
+            }
+            text += "end\n";
+        }
+
+        std::ofstream stream(file, std::ios::trunc);
+        if (!stream.write(text.data(), text.size()))
+            throw Exception(fmt::format("Failed to write cell \"{}\"", file.string()));
+    }
+
+    WorldPartition::WorldPartition(path directory, float cell_size, ObjectStore &objects, TransformRegistry &registry,
+                                   AssetManager &assets, JobSystem &jobs, Timeline &timeline)
+        : m_logger(get_logger())
+        , m_directory(std::move(directory))
+        , m_cell_size(cell_size)
+        , m_objects(&objects)
+        , m_registry(&registry)
+        , m_assets(&assets)
+        , m_jobs(&jobs)
+        , m_timeline(&timeline)
+    {
+        if (cell_size <= 0.0f)
+            throw Exception(fmt::format("Cell size must be positive, but {} was given", cell_size));
+        if (!std::filesystem::is_directory(m_directory))
+            throw Exception(fmt::format("World directory \"{}\" does not exist", m_directory.string()));
+
+        for (const auto &entry : std::filesystem::directory_iterator(m_directory)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".cell")
+                continue;
+
+            // Named `<x>_<y>.cell`
+            string    stem  = entry.path().stem().string();
+            size_t    split = stem.find('_');
+            CellCoord coord = {};
+
+            string_view x = string_view(stem).substr(0, split);
+            string_view y = split == string::npos ? string_view() : string_view(stem).substr(split + 1);
+            if (!parse_number(x, coord.x) || !parse_number(y, coord.y) || !x.empty() || !y.empty()) {
+                m_logger->warn("Ignoring cell \"{}\", which is not named after its coordinates", stem);
+                continue;
+            }
+
+            m_cells.push_back(Cell {.coord = coord, .path = entry.path(), .bytes = entry.file_size()});
+        }
+
+        m_logger->debug("Found {} cells in \"{}\"", m_cells.size(), m_directory.string());
+    }
+
+    WorldPartition::~WorldPartition() = default;
+
+    CellCoord WorldPartition::cell_of(const glm::vec3 &location) const noexcept
+    {
+        return CellCoord {
+            .x = int32_t(std::floor(location.x / m_cell_size)),
+            .y = int32_t(std::floor(location.y / m_cell_size)),
+        };
+    }
+
+    WorldPartition::Statistics WorldPartition::statistics() const noexcept
+    {
+        Statistics stats = {};
+        stats.cells      = uint32_t(m_cells.size());
+
+        for (const Cell &cell : m_cells) {
+            switch (cell.state) {
+            case CellState::Loaded:
+                stats.loaded  += 1;
+                stats.objects += cell.objects.size();
+                stats.bytes   += cost(cell);
+                break;
+            case CellState::Loading:
+                stats.loading += 1;
+                break;
+            case CellState::Unloading:
+                stats.unloading += 1;
+                break;
+            default:
+                break;
+            }
+        }
+
+        return stats;
+    }
+
+    size_t WorldPartition::cost(const Cell &cell) const
+    {
+        if (cell.state != CellState::Loaded && cell.state != CellState::Unloading)
+            return cell.bytes;
+
+        size_t total = cell.object_bytes;
+        for (ObjectStore::Key key : cell.objects)
+            total += (*m_objects)[m_objects->index(key)].resource_bytes();
+        for (const MeshHandle &mesh : cell.meshes)
+            total += mesh.bytes();
+        return total;
+    }
+
+    float WorldPartition::distance(const Cell &cell, const glm::vec3 &camera) const noexcept
+    {
+        glm::vec2 min     = glm::vec2(cell.coord.x, cell.coord.y) * m_cell_size;
+        glm::vec2 nearest = glm::clamp(glm::vec2(camera), min, min + m_cell_size);
+        return glm::distance(glm::vec2(camera), nearest);
+    }
+
+    void WorldPartition::update(const glm::vec3 &camera)
+    {
+        finish_loads(camera);
+        finish_unloads();
+
+        m_ranked.clear();
+        for (uint32_t i = 0; i < m_cells.size(); ++i) {
+            Cell &cell     = m_cells[i];
+            float distance = this->distance(cell, camera);
+            bool  resident = cell.state == CellState::Loading || cell.state == CellState::Loaded;
+
+            cell.wanted = false;
+            if (!cell.failed && (distance <= load_radius || (resident && distance <= unload_radius)))
+                m_ranked.emplace_back(distance, i);
+        }
+        std::sort(m_ranked.begin(), m_ranked.end());
+
+        // Nearer cells take the budget first
+        size_t used = 0;
+        for (size_t i = 0; i < m_ranked.size(); ++i) {
+            Cell  &cell = m_cells[m_ranked[i].second];
+            size_t cost = this->cost(cell);
+            if (i > 0 && used + cost > memory_budget)
+                break;
+
+            used        += cost;
+            cell.wanted  = true;
+        }
+
+        for (Cell &cell : m_cells)
+            if (cell.state == CellState::Loaded && !cell.wanted)
+                begin_unload(cell);
+
+        for (const auto &ranked : m_ranked) {
+            if (m_loading >= max_concurrent_loads)
+                break;
+
+            Cell &cell = m_cells[ranked.second];
+            if (cell.wanted && cell.state == CellState::Unloaded)
+                begin_load(cell);
+        }
+    }
+
+    void WorldPartition::finish_loads(const glm::vec3 &camera)
+    {
+        using namespace std::chrono_literals;
+
+        for (Cell &cell : m_cells) {
+            if (cell.state != CellState::Loading || cell.loading.wait_for(0s) != std::future_status::ready)
+                continue;
+
+            --m_loading;
+            cell.state = CellState::Unloaded;
+
+            try {
+                CellData data = cell.loading.get();
+
+                // The cell went out of range while it was being read
+                if (!cell.wanted)
+                    continue;
+
+                instantiate(cell, data, distance(cell, camera));
+                cell.state = CellState::Loaded;
+            } catch (Exception &e) {
+                e.log();
+                cell.failed = true;
+            } catch (std::exception &e) {
+                m_logger->error("Failed to load cell \"{}\": {}", cell.path.string(), e.what());
+                cell.failed = true;
+            }
+        }
+    }
+
+    void WorldPartition::finish_unloads()
+    {
+        for (Cell &cell : m_cells) {
+            if (cell.state != CellState::Unloading || !m_timeline->reached(cell.retire))
+                continue;
+
+            // Keep the measured cost to rank the cell when it is next in range
+            cell.bytes = cost(cell);
+
+            for (ObjectStore::Key key : cell.objects)
+                m_objects->erase(m_objects->index(key));
+
+            cell.objects.clear();
+            cell.meshes.clear();
+            cell.state = CellState::Unloaded;
+        }
+    }
+
+    void WorldPartition::begin_load(Cell &cell)
+    {
+        cell.loading = m_jobs->async([file = cell.path]() { return read_cell(file); });
+        cell.state   = CellState::Loading;
+        ++m_loading;
+    }
+
+    void WorldPartition::begin_unload(Cell &cell)
+    {
+        for (ObjectStore::Key key : cell.objects)
+            (*m_objects)[m_objects->index(key)].transform.set_visible(false);
+
+        // Frames already submitted may still draw the objects, while later ones skip them
+        cell.state  = CellState::Unloading;
+        cell.retire = m_timeline->submitted();
+    }
+
+    void WorldPartition::instantiate(Cell &cell, const CellData &data, float distance)
+    {
+        if (data.coord != cell.coord)
+            m_logger->warn("Cell \"{}\" is at ({}, {}), but is named after ({}, {})", cell.path.string(), data.coord.x,
+                           data.coord.y, cell.coord.x, cell.coord.y);
+
+        float priority = AssetManager::distance_priority(distance);
+        for (const string &mesh : data.meshes)
+            cell.meshes.push_back(m_assets->load_mesh(mesh, priority));
+
+        cell.object_bytes = 0;
+        for (const ObjectRecord &record : data.objects) {
+            auto factory = m_factories.find(record.type);
+            if (factory == m_factories.end()) {
+                m_logger->warn("Cell ({}, {}) has an object of unknown type \"{}\"", cell.coord.x, cell.coord.y,
+                               record.type);
+                continue;
+            }
+
+            Object &object = factory->second.create(*m_objects, *m_registry, *m_assets);
+            cell.objects.push_back(m_objects->key(uint32_t(m_objects->size() - 1)));
+            cell.object_bytes += factory->second.size;
+
+            for (const auto &[name, value] : record.fields) {
+                const Field *field = find_field(object.get_rep(), name);
+                if (!field || !read_field(object, *field, value))
+                    m_logger->warn("Cell ({}, {}): cannot set \"{}\" of a {} to \"{}\"", cell.coord.x, cell.coord.y,
+                                   name, record.type, value);
+            }
+        }
+    }
+} // namespace engine
@@ -1,27 +1,33 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.hpp>
 
+#include "assets/asset_manager.hpp"
 #include "backend/device_manager.hpp"
 #include "backend/vulkan_backend.hpp"
 #include "drawables/drawing_context.hpp"
 #include "exceptions.hpp"
 #include "logger.hpp"
 #include "window.hpp"
+#include <algorithm>
 #include <chrono>
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 #include <sstream>
 
 using std::string_view, std::stringstream, std::optional;
-using std::chrono::system_clock, std::chrono::time_point, std::chrono::duration, std::chrono::duration_cast,
+using std::chrono::steady_clock, std::chrono::time_point, std::chrono::duration, std::chrono::duration_cast,
     std::chrono::nanoseconds, std::chrono::seconds;
 using namespace std::chrono_literals;
 
 namespace engine
 {
+    /// Frames drawn after input when rendering on demand, so that ImGui's layout settles
+    static constexpr uint32_t INPUT_FRAMES = 3;
+
     Window::Window(string_view title, int32_t width, int32_t height, string_view application_name,
                    Version application_version)
         : m_logger(get_logger())
+        , m_creation_time(steady_clock::now())
     {
         if (!glfwInit())
             throw GlfwException("Failed to initialize GLFW");
@@ -33,13 +39,17 @@ namespace engine
         m_logger->info("Created window");
 
         set_glfw_callbacks();
+        m_imgui_manager.init_context(m_window);
 
-        m_backend = VulkanBackend::new_unique(application_name, application_version, m_window);
-        m_imgui_manager.init(*m_backend, m_window);
+        m_job_system    = JobSystem::new_shared();
+        m_backend       = VulkanBackend::new_unique(application_name, application_version, m_window, m_job_system,
+                                                    imgui_startup());
+        m_asset_manager = std::make_unique<AssetManager>(*m_backend, m_job_system);
     }
 
     Window::Window(string_view title, int32_t width, int32_t height, const Window &other)
         : m_logger(other.m_logger)
+        , m_creation_time(steady_clock::now())
     {
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
         m_window = glfwCreateWindow(width, height, title.data(), nullptr, nullptr);
@@ -48,9 +58,17 @@ namespace engine
         m_logger->info("Created window");
 
         set_glfw_callbacks();
+        m_imgui_manager.init_context(m_window);
+
+        m_job_system    = other.m_job_system;
+        m_backend       = VulkanBackend::new_from(*other.m_backend, m_window, imgui_startup());
+        m_asset_manager = std::make_unique<AssetManager>(*m_backend, m_job_system);
+    }
 
-        m_backend = VulkanBackend::new_from(*other.m_backend, m_window);
-        m_imgui_manager.init(*m_backend, m_window);
+    VulkanBackend::StartupTask Window::imgui_startup()
+    {
+        // The backend times it as part of its startup
+        return [this](VulkanBackend &backend) { m_imgui_manager.init_renderer(backend); };
     }
 
     void Window::show()
@@ -93,6 +111,41 @@ namespace engine
         return *m_backend;
     }
 
+    AssetManager &Window::get_asset_manager()
+    {
+        return *m_asset_manager;
+    }
+
+    JobSystem &Window::get_job_system()
+    {
+        return *m_job_system;
+    }
+
+    FramePacer &Window::get_frame_pacer()
+    {
+        return m_pacer;
+    }
+
+    const FramePacer &Window::active_frame_pacer() const
+    {
+        return m_group_pacer ? *m_group_pacer : m_pacer;
+    }
+
+    void Window::invalidate(uint32_t frames)
+    {
+        m_redraw_frames = std::max(m_redraw_frames, frames);
+    }
+
+    void Window::set_present_policy(PresentPolicy policy)
+    {
+        m_backend->set_present_policy(policy);
+    }
+
+    PresentPolicy Window::present_policy() const
+    {
+        return m_backend->present_policy();
+    }
+
     void Window::on_key_action(KeyboardKey key, ModifierKey modifiers, KeyAction action, int scancode) { }
 
     void Window::on_mouse_button_action(MouseButton button, ModifierKey modifiers, KeyAction action) { }
@@ -107,38 +160,37 @@ namespace engine
 
     void Window::run(double pproc_freq)
     {
-        time_point last_draw      = system_clock::now();
-        time_point next_physics   = last_draw;
-        duration   physics_period = duration<double, seconds::period>(1.0 / pproc_freq);
+        start_loop(pproc_freq);
 
         try {
-            while (!glfwWindowShouldClose(m_window)) {
-                time_point now          = system_clock::now();
-                duration   render_delta = duration_cast<duration<double>>(now - last_draw);
+            while (!should_close()) {
+                // Idle iterations are not frames, so they are neither paced nor measured
+                if (!wants_frame()) {
+                    m_pacer.pause();
+                    glfwWaitEventsTimeout(idle_timeout());
+                    update_frame();
+                    continue;
+                }
 
-                glfwPollEvents();
-                m_imgui_manager.new_frame();
-                process(render_delta.count());
+                auto period = frame_period();
 
-                if (now >= next_physics) {
-                    physics_process(physics_period.count());
-                    next_physics = next_physics + duration_cast<system_clock::duration>(physics_period);
-                }
-                m_imgui_manager.end_frame();
+                m_pacer.begin_frame(period);
+                auto start = steady_clock::now();
 
-                time_point start = system_clock::now();
+                glfwPollEvents();
+                update_frame();
 
                 if (optional<DrawingContext> ctx = m_backend->begin_draw()) {
                     handle_draw(ctx.value());
                     m_imgui_manager.render(ctx.value());
                     m_backend->end_draw(ctx.value());
+
+                    frame_submitted(start);
                 }
 
                 m_imgui_manager.update_platform_windows();
 
-                duration<double> dur = system_clock::now() - start;
-
-                last_draw = now;
+                m_pacer.end_frame(period);
             }
         } catch (vk::SystemError &error) {
             auto &code    = error.code();
@@ -150,10 +202,111 @@ namespace engine
         m_backend->wait_idle();
     }
 
+    bool Window::should_close() const
+    {
+        return glfwWindowShouldClose(m_window);
+    }
+
+    void Window::start_loop(double pproc_freq)
+    {
+        m_last_draw      = steady_clock::now();
+        m_next_physics   = m_last_draw;
+        m_physics_period = duration<double>(1.0 / pproc_freq);
+        m_pacer.reset();
+
+        // Windows rendering on demand still show something before their first event
+        invalidate();
+    }
+
+    void Window::update_frame()
+    {
+        time_point now          = steady_clock::now();
+        duration   render_delta = duration_cast<duration<double>>(now - m_last_draw);
+
+        m_imgui_manager.new_frame();
+        process(render_delta.count());
+
+        if (now >= m_next_physics) {
+            physics_process(m_physics_period.count());
+            m_next_physics = m_next_physics + duration_cast<steady_clock::duration>(m_physics_period);
+        }
+        m_imgui_manager.end_frame();
+
+        m_asset_manager->update();
+
+        m_last_draw = now;
+    }
+
+    void Window::log_first_frame()
+    {
+        if (!m_first_frame)
+            return;
+
+        duration<double, std::milli> elapsed = steady_clock::now() - m_creation_time;
+        m_logger->info("First frame submitted {:.2f} ms after window creation", elapsed.count());
+        m_first_frame = false;
+    }
+
+    bool Window::hidden() const
+    {
+        return m_iconified || m_framebuffer_empty || !glfwGetWindowAttrib(m_window, GLFW_VISIBLE);
+    }
+
+    bool Window::focused() const noexcept
+    {
+        return m_focused;
+    }
+
+    bool Window::wants_frame()
+    {
+        // Also keeps a window with an empty framebuffer from trying to recreate its swapchain every iteration
+        if (throttle.pause_hidden && hidden())
+            return false;
+
+        return !render_on_demand || m_redraw_frames > 0 || m_imgui_manager.active() || m_asset_manager->pending() > 0;
+    }
+
+    double Window::idle_timeout() const
+    {
+        duration<double> until_physics = m_next_physics - steady_clock::now();
+        return std::max(until_physics.count(), 0.0);
+    }
+
+    bool Window::frame_due(steady_clock::time_point now, steady_clock::duration slack) const
+    {
+        return now + slack >= m_next_frame;
+    }
+
+    void Window::frame_submitted(steady_clock::time_point start)
+    {
+        if (m_redraw_frames > 0)
+            --m_redraw_frames;
+
+        m_next_frame = start + frame_period();
+        log_first_frame();
+    }
+
+    steady_clock::duration Window::frame_period() const
+    {
+        // Rates of zero do not limit anything
+        auto lowest = [](double a, double b) { return a <= 0.0 ? b : b <= 0.0 ? a : std::min(a, b); };
+
+        double rate = lowest(present_settings(m_backend->present_policy()).frame_cap, m_pacer.frame_rate_limit);
+        if (!m_focused)
+            rate = lowest(rate, throttle.unfocused_rate);
+
+        if (rate <= 0.0)
+            return steady_clock::duration::zero();
+
+        return duration_cast<steady_clock::duration>(duration<double>(1.0 / rate));
+    }
+
     Window::~Window()
     {
         m_imgui_manager.destroy();
-        m_backend = nullptr;
+        m_asset_manager = nullptr;
+        m_backend       = nullptr;
+        m_job_system    = nullptr;
 
         if (m_window)
             glfwDestroyWindow(m_window);
@@ -168,21 +321,32 @@ namespace engine
         glfwPollEvents();
         glfwGetCursorPos(m_window, &last_mouse_x, &last_mouse_y);
 
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        m_framebuffer_empty = width == 0 || height == 0;
+        m_iconified         = glfwGetWindowAttrib(m_window, GLFW_ICONIFIED);
+
         glfwSetKeyCallback(m_window, key_callback);
         glfwSetMouseButtonCallback(m_window, mouse_button_callback);
         glfwSetCursorPosCallback(m_window, cursor_pos_callback);
         glfwSetScrollCallback(m_window, scroll_callback);
+        glfwSetWindowRefreshCallback(m_window, refresh_callback);
+        glfwSetFramebufferSizeCallback(m_window, framebuffer_resize_callback);
+        glfwSetWindowFocusCallback(m_window, focus_callback);
+        glfwSetWindowIconifyCallback(m_window, iconify_callback);
     }
 
     void Window::key_callback(GLFWwindow *p_wnd, int key, int scancode, int action, int mods)
     {
         Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
+        window->invalidate(INPUT_FRAMES);
         window->on_key_action(KeyboardKey(key), ModifierKey(mods), KeyAction(action), scancode);
     }
 
     void Window::mouse_button_callback(GLFWwindow *p_wnd, int button, int action, int mods)
     {
         Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
+        window->invalidate(INPUT_FRAMES);
         window->on_mouse_button_action(MouseButton(button), ModifierKey(mods), KeyAction(action));
     }
 
@@ -193,6 +357,7 @@ namespace engine
         double  dy           = ypos - window->last_mouse_y;
         window->last_mouse_x = xpos;
         window->last_mouse_y = ypos;
+        window->invalidate(INPUT_FRAMES);
         window->on_cursor_motion(xpos, ypos, dx, dy);
     }
 
@@ -200,13 +365,42 @@ namespace engine
     {
         Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
 
-        window->m_backend->m_framebuffer_resized = true;
+        window->m_framebuffer_empty = width == 0 || height == 0;
+        window->invalidate();
+
+        if (window->m_backend)
+            window->m_backend->m_framebuffer_resized = true;
     }
 
     void Window::scroll_callback(GLFWwindow *p_wnd, double xoff, double yoff)
     {
         Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
 
+        window->invalidate(INPUT_FRAMES);
         window->on_scroll(xoff, yoff);
     }
+
+    void Window::refresh_callback(GLFWwindow *p_wnd)
+    {
+        Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
+
+        // The window's contents were damaged, such as by a resize
+        window->invalidate();
+    }
+
+    void Window::focus_callback(GLFWwindow *p_wnd, int focused)
+    {
+        Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
+
+        window->m_focused = focused == GLFW_TRUE;
+        window->invalidate();
+    }
+
+    void Window::iconify_callback(GLFWwindow *p_wnd, int iconified)
+    {
+        Window *window = (Window *)glfwGetWindowUserPointer(p_wnd);
+
+        window->m_iconified = iconified == GLFW_TRUE;
+        window->invalidate();
+    }
 } // namespace engine
@@ -0,0 +1,174 @@
+#include "window_group.hpp"
+#include "backend/vulkan_backend.hpp"
+#include "drawables/drawing_context.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <optional>
+
+using std::initializer_list, std::vector, std::optional, std::exception_ptr, std::chrono::steady_clock;
+
+namespace engine
+{
+    WindowGroup::WindowGroup(initializer_list<Window *> windows)
+        : m_logger(get_logger())
+    {
+        for (Window *window : windows)
+            add(*window);
+    }
+
+    WindowGroup::~WindowGroup()
+    {
+        for (Window *window : m_windows)
+            leave(*window);
+    }
+
+    void WindowGroup::add(Window &window)
+    {
+        if (!m_windows.empty() && m_windows.front()->m_backend->m_device != window.m_backend->m_device)
+            throw Exception("Windows in a group must share a device");
+
+        m_windows.push_back(&window);
+        window.m_group_pacer = &m_pacer;
+    }
+
+    void WindowGroup::run(double pproc_freq)
+    {
+        for (Window *window : m_windows)
+            window->start_loop(pproc_freq);
+
+        vector<Window *>        drawing  = {};
+        vector<VulkanBackend *> backends = {};
+        vector<DrawingContext>  contexts = {};
+
+        m_pacer.reset();
+
+        try {
+            while (!m_windows.empty()) {
+                // When no window wants a frame, the group idles until the first event or physics tick of any window
+                auto wants_frame = [](Window *window) { return window->wants_frame(); };
+                if (std::none_of(m_windows.begin(), m_windows.end(), wants_frame)) {
+                    double timeout = std::numeric_limits<double>::max();
+                    for (Window *window : m_windows)
+                        timeout = std::min(timeout, window->idle_timeout());
+
+                    m_pacer.pause();
+                    glfwWaitEventsTimeout(timeout);
+
+                    if (remove_closed() && m_windows.empty())
+                        break;
+
+                    for (Window *window : m_windows)
+                        window->update_frame();
+                    continue;
+                }
+
+                auto period = frame_period();
+
+                auto reduce_latency    = [](Window *window) { return window->m_pacer.reduce_latency; };
+                m_pacer.reduce_latency = std::any_of(m_windows.begin(), m_windows.end(), reduce_latency);
+
+                m_pacer.begin_frame(period);
+                auto start = steady_clock::now();
+
+                glfwPollEvents();
+
+                if (remove_closed() && m_windows.empty())
+                    break;
+
+                drawing.clear();
+                backends.clear();
+                contexts.clear();
+
+                for (Window *window : m_windows) {
+                    window->update_frame();
+
+                    // Windows rendering on demand are skipped until something invalidates them, and windows capped
+                    // below the group's rate until their own period has passed
+                    if (!window->wants_frame() || !window->frame_due(start, period / 2))
+                        continue;
+
+                    if (optional<DrawingContext> ctx = window->m_backend->begin_draw()) {
+                        drawing.push_back(window);
+                        backends.push_back(window->m_backend.get());
+                        contexts.push_back(ctx.value());
+                    }
+                }
+
+                // Each window records into its own command buffer and descriptor sets
+                vector<exception_ptr> errors(drawing.size());
+                m_windows.front()->get_job_system().parallel_for(drawing.size(), 1, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i)
+                        try {
+                            drawing[i]->handle_draw(contexts[i]);
+                        } catch (...) {
+                            errors[i] = std::current_exception();
+                        }
+                });
+
+                for (auto &error : errors)
+                    if (error)
+                        std::rethrow_exception(error);
+
+                // ImGui's current context is global, so the interface is recorded serially
+                for (size_t i = 0; i < drawing.size(); ++i) {
+                    drawing[i]->m_imgui_manager.render(contexts[i]);
+                    backends[i]->finish_draw(contexts[i]);
+                }
+
+                VulkanBackend::submit_frames(backends, contexts);
+
+                for (Window *window : drawing)
+                    window->frame_submitted(start);
+
+                for (Window *window : m_windows)
+                    window->m_imgui_manager.update_platform_windows();
+
+                m_pacer.end_frame(period);
+            }
+        } catch (vk::SystemError &error) {
+            auto &code    = error.code();
+            auto  message = error.what();
+            m_logger->error("Error encountered when calling {}", message);
+            throw VulkanException(code.value(), message);
+        }
+    }
+
+    steady_clock::duration WindowGroup::frame_period() const
+    {
+        // The shortest period, so that no window runs below its limit
+        auto period = steady_clock::duration::max();
+        for (Window *window : m_windows)
+            period = std::min(period, window->frame_period());
+
+        return m_windows.empty() ? steady_clock::duration::zero() : period;
+    }
+
+    void WindowGroup::leave(Window &window)
+    {
+        if (window.m_group_pacer == &m_pacer)
+            window.m_group_pacer = nullptr;
+    }
+
+    bool WindowGroup::remove_closed()
+    {
+        if (std::none_of(m_windows.begin(), m_windows.end(), [](Window *window) { return window->should_close(); }))
+            return false;
+
+        // The closing windows' frames must finish before the windows can be destroyed
+        m_windows.front()->m_backend->wait_idle();
+
+        std::erase_if(m_windows, [this](Window *window) {
+            if (!window->should_close())
+                return false;
+
+            window->hide();
+            leave(*window);
+            return true;
+        });
+
+        return true;
+    }
+} // namespace engine
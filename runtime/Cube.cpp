@@ -54,27 +54,59 @@ static const std::array<uint32_t, 36> INDICES = {
     23, 21, 20, 22, 23, 20, // 20 21 22 23
 };
 
-Cube::Cube(engine::VulkanBackend &backend)
+/// Get the pipeline which draws back faces, compiling it on first use
+static engine::PipelineId double_sided_pipeline(engine::VulkanBackend &backend)
 {
-    auto vertices = VERTICES;
-    auto indices  = INDICES;
+    constexpr std::string_view NAME = "Gouraud (double sided)";
 
-    mesh = backend.load(vertices, indices);
+    if (auto existing = backend.m_pipelines.find(NAME))
+        return *existing;
+
+    engine::PipelineConfiguration config = backend.m_gouraud_configuration;
+    config.rasterizer.cullMode           = vk::CullModeFlagBits::eNone;
+
+    return backend.request_pipeline(NAME, config);
+}
+
+Cube::Cube(engine::TransformRegistry &registry, engine::AssetManager &assets)
+    : Object(registry)
+{
+    // Named, so that every cube shares a single mesh
+    mesh = assets.load_mesh(
+        []() {
+            return engine::MeshData {
+                .vertices = {VERTICES.begin(), VERTICES.end()},
+                .indices  = {INDICES.begin(), INDICES.end()},
+            };
+        },
+        0.0, "Cube");
 }
 
 void Cube::physics_process(double delta)
 {
     if (rotate)
-        transform.rotation.z = glm::mod<float>(transform.rotation.z + 180.0_deg * delta, 360.0_deg);
+        transform.set_orientation(transform.orientation() * glm::angleAxis<float>(180.0_deg * delta, engine::Z_AXIS));
+}
+
+void Cube::draw(engine::DrawingContext &context)
+{
+    auto resident = mesh.get();
+    if (!resident)
+        return;
+
+    engine::PipelineId pipeline =
+        double_sided ? double_sided_pipeline(*context.backend) : engine::VulkanBackend::GOURAUD_PIPELINE;
+    resident->draw(context, instance, pipeline, transform.world(), transform.version());
 }
 
-void Cube::draw(engine::DrawingContext &context, const glm::mat4 &parent)
+engine::Aabb Cube::local_bounds() const
 {
-    mesh->draw(context, parent * glm::mat4(transform));
+    return engine::Aabb {glm::vec3(-0.5f), glm::vec3(0.5f)};
 }
 
 const Field CUBE_FIELDS[] = {
     Field("rotate", FieldTypeBits::Boolean, offsetof(Cube, rotate)),
+    Field("double_sided", FieldTypeBits::Boolean, offsetof(Cube, double_sided)),
 };
 
 const Datastructure CUBE_REP = Datastructure("Cube", CUBE_FIELDS, &engine::OBJECT_REP);
@@ -1,4 +1,5 @@
 #pragma once
+#include <assets/asset_manager.hpp>
 #include <backend/vulkan_backend.hpp>
 #include <drawables/GouraudMesh.hpp>
 #include <object.hpp>
@@ -6,16 +7,21 @@
 class Cube : public engine::Object
 {
   public:
-    Cube(engine::VulkanBackend &backend);
+    Cube(engine::TransformRegistry &registry, engine::AssetManager &assets);
 
     void physics_process(double delta) override;
 
-    void draw(engine::DrawingContext &context, const glm::mat4 &parent) override;
+    void draw(engine::DrawingContext &context) override;
+
+    engine::Aabb local_bounds() const override;
 
     const engine::reflection::Datastructure *get_rep() const;
 
-    std::shared_ptr<engine::GouraudMesh> mesh;
-    bool                                 rotate = true;
+    engine::MeshHandle   mesh;
+    /// Per-object state of the mesh, which every cube shares
+    engine::MeshInstance instance;
+    bool                 rotate       = true;
+    bool                 double_sided = false;
 };
 
 extern const engine::reflection::Datastructure CUBE_REP;
\ No newline at end of file
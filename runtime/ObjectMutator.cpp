@@ -6,7 +6,7 @@
 using engine::Object;
 using namespace engine::reflection;
 
-ObjectMutator::ObjectMutator(std::vector<std::shared_ptr<engine::Object>> &objects)
+ObjectMutator::ObjectMutator(engine::ObjectStore &objects)
     : Applet("Object Mutator", false, true)
     , m_objects(&objects)
     , m_index(0)
@@ -37,10 +37,24 @@ static std::string get_object_name(Object &obj)
         return obj.name;
 }
 
-void field_mutator(Object *p_obj, const Field &field)
+/// Run `widget` on a field, copying it through the field's accessors if it has any
+template<class T, class Widget>
+static void edit_field(Object *p_obj, const Field &field, Widget &&widget)
 {
-    uint8_t *pfield = ((uint8_t *)p_obj) + field.offset;
+    if (!field.has_accessors()) {
+        widget((T *)((uint8_t *)p_obj + field.offset));
+        return;
+    }
+
+    T value = {};
+    field.getter(p_obj, &value);
+
+    if (widget(&value) && field.setter)
+        field.setter(p_obj, &value);
+}
 
+void field_mutator(Object *p_obj, const Field &field)
+{
     switch (FieldTypeBits(field.type & (FieldTypeBits::TypeBits | FieldTypeBits::WidthBits))) {
     case FieldTypeBits::Int8:
         break;
@@ -61,37 +75,65 @@ void field_mutator(Object *p_obj, const Field &field)
         break;
 
     case FieldTypeBits::Float32: {
-        if (field.type.contains(FieldTypeBits::Vec4))
-            ImGui::DragFloat4(field.name, (float *)pfield, 1.0);
-        else if (field.type.contains(FieldTypeBits::Vec3))
-            ImGui::DragFloat3(field.name, (float *)pfield, 1.0);
-        else if (field.type.contains(FieldTypeBits::Vec2))
-            ImGui::DragFloat2(field.name, (float *)pfield, 1.0);
-        else
-            ImGui::DragFloat(field.name, (float *)pfield, 1.0);
+        edit_field<glm::vec4>(p_obj, field, [&](glm::vec4 *v) {
+            float *f = (float *)v;
+
+            if (field.type.contains(FieldTypeBits::Vec4))
+                return ImGui::DragFloat4(field.name, f, 1.0);
+            else if (field.type.contains(FieldTypeBits::Vec3))
+                return ImGui::DragFloat3(field.name, f, 1.0);
+            else if (field.type.contains(FieldTypeBits::Vec2))
+                return ImGui::DragFloat2(field.name, f, 1.0);
+            else
+                return ImGui::DragFloat(field.name, f, 1.0);
+        });
         break;
     }
     case FieldTypeBits::Float64: {
-        std::string s;
-        float      *f = (float *)pfield;
-
-        if (field.type.contains(FieldTypeBits::Vec4))
-            s = fmt::format("[{:0.3f}, {:0.3f}, {:0.3f}, {:0.3f}]", f[0], f[1], f[2], f[3]);
-        else if (field.type.contains(FieldTypeBits::Vec3))
-            s = fmt::format("[{:0.3f}, {:0.3f}, {:0.3f}]", f[0], f[1], f[2]);
-        else if (field.type.contains(FieldTypeBits::Vec2))
-            s = fmt::format("[{:0.3f}, {:0.3f}]", f[0], f[1]);
-        else
-            s = fmt::format("[{:0.3f}]", f[0]);
-
-        ImGui::Text("%s", s.c_str());
+        edit_field<glm::dvec4>(p_obj, field, [&](glm::dvec4 *v) {
+            std::string s;
+            float      *f = (float *)v;
+
+            if (field.type.contains(FieldTypeBits::Vec4))
+                s = fmt::format("[{:0.3f}, {:0.3f}, {:0.3f}, {:0.3f}]", f[0], f[1], f[2], f[3]);
+            else if (field.type.contains(FieldTypeBits::Vec3))
+                s = fmt::format("[{:0.3f}, {:0.3f}, {:0.3f}]", f[0], f[1], f[2]);
+            else if (field.type.contains(FieldTypeBits::Vec2))
+                s = fmt::format("[{:0.3f}, {:0.3f}]", f[0], f[1]);
+            else
+                s = fmt::format("[{:0.3f}]", f[0]);
+
+            ImGui::Text("%s", s.c_str());
+            return false;
+        });
+        break;
+    }
+    case FieldTypeBits::Quat32: {
+        // Edited as a quaternion, since a round trip through Euler angles loses roll at +/-90 degrees of pitch
+        edit_field<glm::quat>(p_obj, field, [&](glm::quat *q) {
+            float     components[4] = {q->x, q->y, q->z, q->w};
+            glm::vec3 turn          = {0.0, 0.0, 0.0};
+
+            bool changed = ImGui::DragFloat4(field.name, components, 0.01f);
+            if (changed)
+                *q = glm::quat(components[3], components[0], components[1], components[2]);
+
+            // Degrees dragged this frame about the local X, Y and Z axes
+            std::string label = fmt::format("{} turn", field.name);
+            if (ImGui::DragFloat3(label.c_str(), &turn.x, 1.0)) {
+                *q      = *q * glm::quat(glm::radians(turn));
+                changed = true;
+            }
+
+            return changed;
+        });
         break;
     }
     case FieldTypeBits::String:
-        ImGui::InputText(field.name, (std::string *)pfield);
+        edit_field<std::string>(p_obj, field, [&](std::string *v) { return ImGui::InputText(field.name, v); });
         break;
     case FieldTypeBits::Boolean:
-        ImGui::Checkbox(field.name, (bool *)pfield);
+        edit_field<bool>(p_obj, field, [&](bool *v) { return ImGui::Checkbox(field.name, v); });
         break;
 
     default:
@@ -111,11 +153,11 @@ void ObjectMutator::populate(ImGuiViewport *viewport)
     std::string obj_name = "";
     std::string obj_ptr  = "";
     if (m_index < m_objects->size())
-        obj_name = get_object_name(*m_objects->at(m_index)), obj_ptr = get_object_ptr_str(*m_objects->at(m_index));
+        obj_name = get_object_name((*m_objects)[m_index]), obj_ptr = get_object_ptr_str((*m_objects)[m_index]);
 
     if (ImGui::BeginCombo("Object", obj_name.c_str())) {
-        for (size_t i = 0; i < m_objects->size(); ++i) {
-            Object &obj = *m_objects->at(i);
+        for (uint32_t i = 0; i < m_objects->size(); ++i) {
+            Object &obj = (*m_objects)[i];
 
             obj_name = get_object_name(obj);
             obj_ptr  = get_object_ptr_str(obj);
@@ -131,11 +173,11 @@ void ObjectMutator::populate(ImGuiViewport *viewport)
     }
     ImGui::SetItemTooltip("%s", obj_ptr.c_str());
 
-    auto ds = m_objects->at(m_index)->get_rep();
+    auto ds = (*m_objects)[m_index].get_rep();
     while (ds) {
         if (ImGui::CollapsingHeader(ds->name))
             for (size_t i = 0; i < ds->field_count; ++i)
-                field_mutator(m_objects->at(m_index).get(), ds->fields[i]);
+                field_mutator(&(*m_objects)[m_index], ds->fields[i]);
 
         ds = ds->supertype;
     }
@@ -1,14 +1,13 @@
 #pragma once
 #include <gui/applet.hpp>
 #include <object.hpp>
+#include <scene/object_store.hpp>
 #include <window.hpp>
 
 class ObjectMutator final : public engine::gui::Applet
 {
-    using ObjectsPtr = std::vector<std::shared_ptr<engine::Object>> *;
-
   public:
-    ObjectMutator(std::vector<std::shared_ptr<engine::Object>> &objects);
+    ObjectMutator(engine::ObjectStore &objects);
     ~ObjectMutator();
 
     void next();
@@ -18,6 +17,6 @@ class ObjectMutator final : public engine::gui::Applet
     void populate(ImGuiViewport *viewport) override;
 
   private:
-    ObjectsPtr m_objects;
-    size_t     m_index;
+    engine::ObjectStore *m_objects;
+    uint32_t             m_index;
 };
\ No newline at end of file
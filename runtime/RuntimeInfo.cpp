@@ -1,9 +1,26 @@
 #include "RuntimeInfo.hpp"
+#include <algorithm>
+#include <cmath>
 #include <fmt/format.h>
 #include <imgui_stdlib.h>
+#include <scene/bvh.hpp>
+#include <scene/hashed_grid.hpp>
 
-RuntimeInfo::RuntimeInfo()
+using engine::math::SimdLevel, engine::math::RotationMode, engine::math::TrsBenchmark;
+
+/// Number of transforms composed by the transform kernel benchmark
+static constexpr size_t TRS_BENCHMARK_COUNT = 1 << 20;
+/// Item counts indexed by the spatial index benchmark
+static constexpr size_t SPATIAL_BENCHMARK_COUNTS[] = {10'000, 100'000, 1'000'000};
+/// Objects drawn by the object store benchmark
+static constexpr size_t STORE_BENCHMARK_COUNT = 1'000'000;
+
+RuntimeInfo::RuntimeInfo(engine::Window &window, engine::JobSystem &jobs, const engine::WorldPartition &world)
     : Applet("Runtime Information", false, true)
+    , m_window(&window)
+    , m_backend(&window.get_render_backend())
+    , m_jobs(&jobs)
+    , m_world(&world)
 { }
 
 RuntimeInfo::~RuntimeInfo() { }
@@ -15,4 +32,203 @@ void RuntimeInfo::populate(ImGuiViewport *viewport)
 
     if (DEBUG_ASSERTIONS)
         ImGui::Text("Debugging enabled");
+
+    if (ImGui::CollapsingHeader("Presentation")) {
+        engine::PresentPolicy current = m_backend->present_policy();
+
+        if (ImGui::BeginCombo("Policy", engine::to_string(current).data())) {
+            for (size_t i = 0; i < engine::PRESENT_POLICY_COUNT; ++i) {
+                auto policy = engine::PresentPolicy(i);
+                if (ImGui::Selectable(engine::to_string(policy).data(), policy == current))
+                    m_backend->set_present_policy(policy);
+            }
+            ImGui::EndCombo();
+        }
+
+        ImGui::Text("Present mode: %s", vk::to_string(m_backend->present_mode()).c_str());
+
+        for (size_t i = 0; i < engine::PRESENT_POLICY_COUNT; ++i) {
+            auto   policy  = engine::PresentPolicy(i);
+            double latency = m_backend->present_latency(policy);
+
+            if (latency > 0.0)
+                ImGui::Text("%-13s %.2f ms", engine::to_string(policy).data(), latency);
+            else
+                ImGui::TextDisabled("%-13s not measured", engine::to_string(policy).data());
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Frame pacing")) {
+        // Settings are the window's own, while a group's pacer times the frames of every window in it
+        engine::FramePacer &pacer = m_window->get_frame_pacer();
+        auto                stats = m_window->active_frame_pacer().statistics();
+
+        float limit = (float)pacer.frame_rate_limit;
+        if (ImGui::DragFloat("Frame rate limit", &limit, 1.0f, 0.0f, 1000.0f, limit > 0.0f ? "%.0f fps" : "None"))
+            pacer.frame_rate_limit = std::max(limit, 0.0f);
+        ImGui::Checkbox("Reduce latency", &pacer.reduce_latency);
+        ImGui::Checkbox("Render on demand", &m_window->render_on_demand);
+
+        if (&m_window->active_frame_pacer() != &pacer)
+            ImGui::TextDisabled("Paced with the other windows of its group");
+
+        ImGui::Text("Frame: %.2f ms (%.2f to %.2f)", stats.frame_ms, stats.min_frame_ms, stats.max_frame_ms);
+        ImGui::Text("Deviation: %.3f ms", std::sqrt(stats.frame_variance));
+        ImGui::Text("Waiting: %.2f ms, spinning %.2f ms", stats.wait_ms, stats.spin_ms);
+        ImGui::Text("Oversleep: %.3f ms", stats.oversleep_ms);
+    }
+
+    if (ImGui::CollapsingHeader("Frames in flight")) {
+        auto balance = m_backend->frame_balance();
+
+        ImGui::Checkbox("Automatic", &m_backend->auto_frames_in_flight);
+
+        int frames = (int)m_backend->frames_in_flight();
+        if (ImGui::SliderInt("Frames", &frames, 1, (int)engine::MAX_IN_FLIGHT)) {
+            m_backend->auto_frames_in_flight = false;
+            m_backend->set_frames_in_flight(frames);
+        }
+
+        ImGui::Text("Frame: %.2f ms", balance.frame_ms);
+        ImGui::Text("CPU: %.2f ms, jitter %.2f", balance.cpu_ms, balance.cpu_jitter);
+        ImGui::Text("Waiting on the GPU: %.2f ms", balance.wait_ms);
+        ImGui::Text("Recommended: %u", balance.recommended);
+    }
+
+    if (ImGui::CollapsingHeader("Dynamic resolution")) {
+        engine::DynamicResolution &resolution = m_backend->dynamic_resolution;
+
+        auto stats  = resolution.statistics();
+        auto full   = m_backend->m_swapchain.configuration.extent;
+        auto extent = resolution.extent(full);
+
+        ImGui::Checkbox("Enabled", &resolution.enabled);
+
+        float budget = (float)resolution.budget_ms;
+        if (ImGui::DragFloat("GPU budget", &budget, 0.1f, 1.0f, 100.0f, "%.1f ms"))
+            resolution.budget_ms = budget;
+        ImGui::SliderFloat("Minimum scale", &resolution.min_scale, 0.25f, resolution.max_scale, "%.2f");
+
+        ImGui::Text("GPU: %.2f ms", stats.gpu_ms);
+        ImGui::Text("Scale: %.2f (%ux%u of %ux%u)", stats.scale, extent.width, extent.height, full.width, full.height);
+        ImGui::Text("Changes: %u", stats.changes);
+    }
+
+    if (ImGui::CollapsingHeader("Pipelines")) {
+        auto stats = m_backend->m_pipelines.statistics();
+
+        ImGui::Text("Compiled: %u", stats.compiled);
+        ImGui::Text("Compiling: %u", stats.pending);
+        ImGui::Text("Failed: %u", stats.failed);
+        ImGui::Text("Last compile: %.2f ms", stats.last_compile_ms);
+        ImGui::Text("Longest compile: %.2f ms", stats.max_compile_ms);
+        if (stats.compiled > 0)
+            ImGui::Text("Average compile: %.2f ms", stats.total_compile_ms / stats.compiled);
+        ImGui::Text("Hitch frames avoided: %llu", (unsigned long long)stats.hitch_frames_avoided);
+        ImGui::Text("Fallback draws: %llu", (unsigned long long)stats.fallback_draws);
+        ImGui::Text("Skipped draws: %llu", (unsigned long long)stats.skipped_draws);
+    }
+
+    if (ImGui::CollapsingHeader("Occlusion culling")) {
+        auto stats = m_backend->m_occlusion.statistics();
+
+        ImGui::Text("Tested: %u", stats.tested);
+        ImGui::Text("Occluded: %u", stats.occluded);
+        ImGui::Text("Revealed: %u", stats.revealed);
+    }
+
+    if (ImGui::CollapsingHeader("World partition")) {
+        auto stats = m_world->statistics();
+
+        ImGui::Text("Cells: %u loaded of %u", stats.loaded, stats.cells);
+        ImGui::Text("Loading: %u", stats.loading);
+        ImGui::Text("Unloading: %u", stats.unloading);
+        ImGui::Text("Objects: %zu", stats.objects);
+        ImGui::Text("Memory: %.1f of %.1f MiB", stats.bytes / 1048576.0, m_world->memory_budget / 1048576.0);
+    }
+
+    if (ImGui::CollapsingHeader("Benchmarks"))
+        benchmarks();
+}
+
+void RuntimeInfo::benchmarks()
+{
+    using namespace std::chrono_literals;
+
+    if (m_trs_running.valid() && m_trs_running.wait_for(0s) == std::future_status::ready)
+        m_trs_results = m_trs_running.get();
+
+    ImGui::Text("Transform kernel: %s", engine::math::to_string(engine::math::detect_simd_level()).data());
+
+    if (m_trs_running.valid()) {
+        ImGui::TextDisabled("Running...");
+    } else if (ImGui::Button("Run##transform_kernel")) {
+        m_trs_running = m_jobs->async([]() {
+            std::vector<TrsBenchmark> results = {};
+            for (RotationMode mode : {RotationMode::Euler, RotationMode::Quaternion})
+                for (int level = 0; level <= (int)engine::math::detect_simd_level(); ++level)
+                    results.push_back(
+                        engine::math::benchmark_compose_transforms(TRS_BENCHMARK_COUNT, SimdLevel(level), mode));
+            return results;
+        });
+    }
+
+    for (const TrsBenchmark &result : m_trs_results) {
+        double speedup = result.baseline_per_second > 0.0 ? result.matrices_per_second / result.baseline_per_second
+                                                          : 0.0;
+
+        ImGui::Text("%-10s %-8s %7.1f M/s (%.2fx), error %.2e%s", engine::math::to_string(result.mode).data(),
+                    engine::math::to_string(result.level).data(), result.matrices_per_second / 1e6, speedup,
+                    result.max_error,
+                    result.within_epsilon ? "" : " (exceeds epsilon)");
+    }
+
+    if (m_spatial_running.valid() && m_spatial_running.wait_for(0s) == std::future_status::ready)
+        m_spatial_results = m_spatial_running.get();
+
+    ImGui::Separator();
+    ImGui::Text("Spatial index");
+
+    if (m_spatial_running.valid()) {
+        ImGui::TextDisabled("Running...");
+    } else if (ImGui::Button("Run##spatial_index")) {
+        m_spatial_running = m_jobs->async([jobs = m_jobs]() {
+            std::vector<engine::SpatialBenchmark> results = {};
+            for (size_t count : SPATIAL_BENCHMARK_COUNTS) {
+                engine::Bvh        bvh;
+                engine::HashedGrid grid;
+                results.push_back(engine::benchmark_spatial_index(bvh, count, *jobs));
+                results.push_back(engine::benchmark_spatial_index(grid, count, *jobs));
+            }
+            return results;
+        });
+    }
+
+    for (const engine::SpatialBenchmark &result : m_spatial_results) {
+        ImGui::Text("%-12s %8zu items: build %.1f ms, update %.2f ms", result.index.data(), result.count,
+                    result.build_ms, result.update_ms);
+        ImGui::Text("    frustum %.1f us (%zu hits), box %.1f us, ray %.1f us, nearest %.1f us", result.frustum_us,
+                    result.frustum_hits, result.aabb_us, result.raycast_us, result.nearest_us);
+    }
+
+    if (m_store_running.valid() && m_store_running.wait_for(0s) == std::future_status::ready)
+        m_store_result = m_store_running.get();
+
+    ImGui::Separator();
+    ImGui::Text("Object storage");
+
+    if (m_store_running.valid()) {
+        ImGui::TextDisabled("Running...");
+    } else if (ImGui::Button("Run##object_store")) {
+        m_store_running = m_jobs->async([]() { return engine::benchmark_object_store(STORE_BENCHMARK_COUNT); });
+    }
+
+    if (m_store_result) {
+        const engine::ObjectStoreBenchmark &result = *m_store_result;
+
+        ImGui::Text("%zu objects", result.count);
+        ImGui::Text("    shared_ptr %.2f ms, copying pointers %.2f ms", result.pointer_ms, result.copy_ms);
+        ImGui::Text("    store %.2f ms (%.2fx), by index %.2f ms", result.store_ms,
+                    result.store_ms > 0.0 ? result.pointer_ms / result.store_ms : 0.0, result.store_set_ms);
+    }
 }
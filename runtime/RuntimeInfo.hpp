@@ -1,14 +1,39 @@
 #pragma once
+#include <backend/vulkan_backend.hpp>
+#include <frame_pacer.hpp>
+#include <future>
+#include <optional>
 #include <gui/applet.hpp>
+#include <jobs/job_system.hpp>
+#include <math/trs_kernel.hpp>
 #include <object.hpp>
+#include <scene/object_store.hpp>
+#include <scene/spatial_index.hpp>
+#include <scene/world_partition.hpp>
+#include <vector>
 #include <window.hpp>
 
 class RuntimeInfo final : public engine::gui::Applet
 {
   public:
-    RuntimeInfo();
+    RuntimeInfo(engine::Window &window, engine::JobSystem &jobs, const engine::WorldPartition &world);
     ~RuntimeInfo();
 
   protected:
     void populate(ImGuiViewport *viewport) override;
+
+  private:
+    void benchmarks();
+
+    engine::Window               *m_window;
+    engine::VulkanBackend        *m_backend;
+    engine::JobSystem            *m_jobs;
+    const engine::WorldPartition *m_world;
+
+    std::future<std::vector<engine::math::TrsBenchmark>> m_trs_running     = {};
+    std::vector<engine::math::TrsBenchmark>              m_trs_results     = {};
+    std::future<std::vector<engine::SpatialBenchmark>>   m_spatial_running = {};
+    std::vector<engine::SpatialBenchmark>                m_spatial_results = {};
+    std::future<engine::ObjectStoreBenchmark>            m_store_running   = {};
+    std::optional<engine::ObjectStoreBenchmark>          m_store_result    = {};
 };
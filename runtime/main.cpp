@@ -3,8 +3,14 @@
 #include <fmt/format.h>
 #include <glfw/glfw3.h>
 #include <imgui.h>
+#include <random>
+#include <filesystem>
 #include <memory>
 #include <object.hpp>
+#include <scene/hashed_grid.hpp>
+#include <scene/object_store.hpp>
+#include <scene/transform_system.hpp>
+#include <scene/world_partition.hpp>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <vertex.hpp>
 #include <vulkan/vulkan.hpp>
@@ -27,6 +33,47 @@ using engine::Object, engine::CameraTransform, engine::KeyboardKey, engine::KeyA
     engine::DEFAULT_FOV;
 using std::shared_ptr, std::initializer_list, engine::Window, std::string_view, std::vector, std::shared_ptr;
 
+/// Side of the cells of the demo world
+static constexpr float WORLD_CELL_SIZE = 16.0f;
+/// Cells along each side of the demo world, which is centered on the origin
+static constexpr int   WORLD_CELLS     = 32;
+static constexpr int   CUBES_PER_CELL  = 8;
+
+/// Generate the demo world in the temporary directory, replacing the cells of earlier runs, and get its directory
+static std::filesystem::path demo_world()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "grt_demo_world";
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    for (int x = -WORLD_CELLS / 2; x < WORLD_CELLS / 2; ++x)
+        for (int y = -WORLD_CELLS / 2; y < WORLD_CELLS / 2; ++y) {
+            std::mt19937                          rng(uint32_t(x * WORLD_CELLS + y));
+            std::uniform_real_distribution<float> offset(0.5f, WORLD_CELL_SIZE - 0.5f);
+            std::uniform_real_distribution<float> height(-4.0f, 4.0f);
+
+            engine::CellData cell = {.coord = {x, y}};
+            for (int i = 0; i < CUBES_PER_CELL; ++i) {
+                glm::vec3 location = {x * WORLD_CELL_SIZE + offset(rng), y * WORLD_CELL_SIZE + offset(rng),
+                                      height(rng)};
+
+                cell.objects.push_back(engine::ObjectRecord {
+                    .type   = "Cube",
+                    .fields = {
+                        {"location", fmt::format("{} {} {}", location.x, location.y, location.z)},
+                        {"name", fmt::format("Cube ({}, {}) {}", x, y, i)},
+                        {"rotate", i % 2 == 0 ? "true" : "false"},
+                    },
+                });
+            }
+
+            engine::write_cell(directory / fmt::format("{}_{}.cell", x, y), cell);
+        }
+
+    return directory;
+}
+
 class ExampleWindow : public Window
 {
   public:
@@ -42,23 +89,29 @@ class ExampleWindow : public Window
 
     ExampleWindow(string_view title, int width, int height)
         : Window(title, width, height, "Runtime", {0, 1, 0})
+        , world(demo_world(), WORLD_CELL_SIZE, objects, registry, get_asset_manager(), get_job_system(),
+                get_render_backend().m_device_manager->timeline)
         , cube_mutator(objects)
-        , runtime_info()
+        , runtime_info(*this, get_job_system(), world)
     {
+        world.register_type<Cube>("Cube");
+
         hint_box = HintBox(camera, fov, show_demo_window, cube_mutator, runtime_info, camera_mouse);
 
-        auto &rb = get_render_backend();
+        auto &rb     = get_render_backend();
+        auto &assets = get_asset_manager();
 
-        cube         = shared_ptr<Cube>(new Cube(rb));
+        cube         = &objects.emplace<Cube>(registry, assets);
         cube->name   = "Cube 1";
-        cube_2       = shared_ptr<Cube>(new Cube(rb));
+        cube_2       = &objects.emplace<Cube>(registry, assets);
         cube_2->name = "Cube 2";
-        objects.push_back(cube);
-        objects.push_back(cube_2);
 
         camera.location = {2.0, 2.0, 2.0};
         camera.rotation = {135.0_deg, -35.0_deg};
 
+        for (auto &c : {cube, cube_2})
+            c->mesh.set_priority(engine::AssetManager::distance_priority(camera.location, c->transform.location()));
+
         capture_mouse(camera_mouse);
 
         rb.update_view(camera);
@@ -100,11 +153,9 @@ class ExampleWindow : public Window
                 camera.rotation = {135.0_deg, -35.0_deg};
                 update_fov(fov = DEFAULT_FOV);
 
-                for (auto &object : objects) {
-                    object->transform.location = {0.0, 0.0, 0.0};
-                    object->transform.rotation = {0.0, 0.0, 0.0};
-                    object->transform.scale    = {1.0, 1.0, 1.0};
-                }
+                // Streamed objects keep the transforms of their cells
+                for (Cube *c : {cube, cube_2})
+                    c->transform.set(engine::Transform {});
             }
             break;
         default:
@@ -173,26 +224,73 @@ class ExampleWindow : public Window
             camera.location +=
                 glm::normalize(glm::vec3(camera.get_facing_matrix() * glm::vec4(transform, 1.0))) * magnitude;
         }
-        update_view(camera);
+        glm::mat4 view = camera;
+        update_view(view);
+        world.update(camera.location);
 
-        for (auto &object : objects)
-            object->physics_process(delta);
+        for (uint32_t i = 0; i < objects.size(); ++i)
+            objects[i].physics_process(delta);
+
+        // Before any frame starts recording, so that drawing only reads world matrices
+        transforms.update(registry, get_job_system());
+
+        // When rendering on demand, frames are only drawn once something in view may have changed
+        if (view != drawn_view || objects.version() != drawn_objects || transforms.updated() > 0)
+            invalidate();
+
+        drawn_view    = view;
+        drawn_objects = objects.version();
     }
 
     void handle_draw(struct engine::DrawingContext &ctx) override
     {
-        for (auto &obj : objects)
-            obj->draw(ctx);
+        auto &jobs = get_job_system();
+
+        world_bounds.resize(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i)
+            world_bounds[i] = objects[i].local_bounds().transformed(objects[i].transform.world());
+
+        if (scene_index->size() == world_bounds.size())
+            scene_index->update(world_bounds, jobs);
+        else
+            scene_index->build(world_bounds, jobs);
+
+        in_view.clear();
+        scene_index->query_frustum(engine::Frustum::from_matrix(ctx.view_projection), in_view);
+
+        in_view_bounds.resize(in_view.size());
+        for (size_t i = 0; i < in_view.size(); ++i)
+            in_view_bounds[i] = world_bounds[in_view[i]];
+
+        ctx.backend->m_occlusion.begin(ctx, in_view_bounds);
+        objects.draw(ctx, in_view);
+        ctx.backend->m_occlusion.end(ctx);
     }
 
-    CameraTransform            camera;
-    shared_ptr<Cube>           cube    = nullptr;
-    shared_ptr<Cube>           cube_2  = nullptr;
-    vector<shared_ptr<Object>> objects = {};
+    CameraTransform           camera;
+    engine::TransformRegistry registry;
+    /// Declared after the registry, which must outlive the objects
+    engine::ObjectStore       objects;
+    Cube                     *cube   = nullptr;
+    Cube                     *cube_2 = nullptr;
+    engine::TransformSystem   transforms;
+    /// Streams the cubes around the camera into `objects`
+    engine::WorldPartition    world;
+
+    /// Every cube moves each tick, which suits a grid better than a BVH
+    std::unique_ptr<engine::SpatialIndex> scene_index    = std::make_unique<engine::HashedGrid>();
+    vector<engine::Aabb>                  world_bounds   = {};
+    vector<uint32_t>                      in_view        = {};
+    /// Bounds of the objects in view, tested for occlusion
+    vector<engine::Aabb>                  in_view_bounds = {};
 
     bool  camera_mouse = true;
     float fov          = DEFAULT_FOV;
 
+    /// Camera and objects as of the last `process`, to tell when rendering on demand must draw again
+    glm::mat4 drawn_view    = glm::mat4(0.0f);
+    uint64_t  drawn_objects = 0;
+
     HintBox       hint_box;
     ObjectMutator cube_mutator;
     RuntimeInfo   runtime_info;
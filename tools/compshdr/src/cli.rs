@@ -7,6 +7,7 @@ pub enum ShaderType {
     Infer,
     Vertex,
     Fragment,
+    Compute,
 }
 
 impl ShaderType {
@@ -17,6 +18,7 @@ impl ShaderType {
             Infer => K::InferFromSource,
             Vertex => K::Vertex,
             Fragment => K::Fragment,
+            Compute => K::Compute,
         }
     }
 }